@@ -3,9 +3,18 @@ from esphome import automation
 from esphome import pins
 import esphome.codegen as cg
 import esphome.config_validation as cv
+from esphome.core import CORE
+from esphome.helpers import cpp_string_escape
 from esphome.components import uart
 from esphome.components.binary_sensor import BinarySensor
-from esphome.const import CONF_ID, CONF_TIME_ID, CONF_TRIGGER_ID, CONF_SENSOR_DATAPOINT
+from esphome.const import (
+    CONF_BAUD_RATE,
+    CONF_ID,
+    CONF_TIME_ID,
+    CONF_TRIGGER_ID,
+    CONF_SENSOR_DATAPOINT,
+    PLATFORM_HOST,
+)
 
 DEPENDENCIES = ["uart"]
 
@@ -16,9 +25,48 @@ CONF_DATAPOINT_TYPE = "datapoint_type"
 CONF_STATUS_PIN = "status_pin"
 CONF_ENABLE_SENSOR = "en_binary_sensor"
 CONF_TOTP_KEY = "totp_key_b32"
+CONF_RECEIVE_TIMEOUT = "receive_timeout"
+CONF_COMMAND_DELAY = "command_delay"
+CONF_MAX_RETRIES = "max_retries"
+CONF_LINE_IDLE_BYTES = "line_idle_bytes"
+CONF_CAPTURE_SIZE = "capture_size"
+CONF_WRITE_QUEUE_SIZE = "write_queue_size"
+CONF_JOURNAL_SIZE = "journal_size"
+CONF_TIME_PUSH_THRESHOLD = "time_push_threshold"
+CONF_PASSTHROUGH_UART_ID = "passthrough_uart_id"
+CONF_HOST_UART = "host_uart"
+CONF_DEVICE = "device"
+CONF_RX_TASK_CORE = "rx_task_core"
+CONF_ON_COMMAND = "on_command"
+CONF_COMMAND = "command"
+CONF_EXPECTS_RESPONSE = "expects_response"
+CONF_RETRANSMIT_WINDOW = "retransmit_window"
+CONF_MIN = "min"
+CONF_MAX = "max"
+CONF_EQUALS = "equals"
+CONF_IN = "in"
+CONF_CHANGED_ONLY = "changed_only"
+CONF_BITS_ALL = "bits_all"
+CONF_BITS_ANY = "bits_any"
+CONF_DATAPOINT_FILTERS = "datapoint_filters"
+CONF_DATAPOINT = "datapoint"
+CONF_DROP_UNCHANGED = "drop_unchanged"
+CONF_DEADBAND = "deadband"
+CONF_MIN_INTERVAL = "min_interval"
 
 tuya_ns = cg.esphome_ns.namespace("tuya_door_lock")
 TuyaDoorLock = tuya_ns.class_("TuyaDoorLock", cg.Component, uart.UARTDevice)
+TuyaDoorLockHostUART = tuya_ns.class_(
+    "TuyaDoorLockHostUART", uart.UARTComponent, cg.Component
+)
+TuyaDoorLockFrame = tuya_ns.struct("TuyaDoorLockFrame")
+TuyaDoorLockCommandTrigger = tuya_ns.class_(
+    "TuyaDoorLockCommandTrigger",
+    automation.Trigger.template(TuyaDoorLockFrame.operator("const").operator("ref")),
+)
+TuyaDoorLockDumpCaptureAction = tuya_ns.class_(
+    "TuyaDoorLockDumpCaptureAction", automation.Action
+)
 
 DPTYPE_ANY = "any"
 DPTYPE_RAW = "raw"
@@ -30,12 +78,14 @@ DPTYPE_ENUM = "enum"
 DPTYPE_BITMASK = "bitmask"
 
 DATAPOINT_TYPES = {
-    DPTYPE_ANY: tuya_ns.struct("TuyaDoorLockDatapoint"),
-    DPTYPE_RAW: cg.std_vector.template(cg.uint8),
+    DPTYPE_ANY: tuya_ns.struct("TuyaDoorLockDatapoint")
+    .operator("const")
+    .operator("ref"),
+    DPTYPE_RAW: cg.std_vector.template(cg.uint8).operator("const").operator("ref"),
     DPTYPE_BOOL: cg.bool_,
     DPTYPE_INT: cg.int_,
     DPTYPE_UINT: cg.uint32,
-    DPTYPE_STRING: cg.std_string,
+    DPTYPE_STRING: cg.std_string.operator("const").operator("ref"),
     DPTYPE_ENUM: cg.uint8,
     DPTYPE_BITMASK: cg.uint32,
 }
@@ -76,6 +126,21 @@ DATAPOINT_TRIGGERS = {
 }
 
 
+# Datapoint member the trigger conditions test, per datapoint_type
+CONDITION_FIELDS = {
+    DPTYPE_ANY: "value_int",
+    DPTYPE_BOOL: "value_bool",
+    DPTYPE_INT: "value_int",
+    DPTYPE_UINT: "value_uint",
+    DPTYPE_STRING: "value_string",
+    DPTYPE_ENUM: "value_enum",
+    DPTYPE_BITMASK: "value_bitmask",
+}
+NUMERIC_DPTYPES = [DPTYPE_ANY, DPTYPE_INT, DPTYPE_UINT, DPTYPE_ENUM, DPTYPE_BITMASK]
+UNSIGNED_DPTYPES = [DPTYPE_UINT, DPTYPE_ENUM, DPTYPE_BITMASK]
+BITS_DPTYPES = [DPTYPE_ANY, DPTYPE_UINT, DPTYPE_BITMASK]
+
+
 def assign_declare_id(value):
     value = value.copy()
     value[CONF_TRIGGER_ID] = cv.declare_id(
@@ -84,18 +149,146 @@ def assign_declare_id(value):
     return value
 
 
+def validate_datapoint_conditions(value):
+    dptype = value[CONF_DATAPOINT_TYPE]
+    allowed = {
+        CONF_MIN: NUMERIC_DPTYPES,
+        CONF_MAX: NUMERIC_DPTYPES,
+        CONF_IN: NUMERIC_DPTYPES,
+        CONF_EQUALS: NUMERIC_DPTYPES + [DPTYPE_BOOL, DPTYPE_STRING],
+        CONF_BITS_ALL: BITS_DPTYPES,
+        CONF_BITS_ANY: BITS_DPTYPES,
+    }
+    for key, dptypes in allowed.items():
+        if key in value and dptype not in dptypes:
+            raise cv.Invalid(f"'{key}' cannot be used with datapoint_type {dptype}")
+    value = value.copy()
+    if CONF_EQUALS in value:
+        if dptype == DPTYPE_BOOL:
+            value[CONF_EQUALS] = cv.boolean(value[CONF_EQUALS])
+        elif dptype == DPTYPE_STRING:
+            value[CONF_EQUALS] = cv.string(value[CONF_EQUALS])
+        else:
+            value[CONF_EQUALS] = cv.int_(value[CONF_EQUALS])
+    if dptype in UNSIGNED_DPTYPES:
+        for key in (CONF_MIN, CONF_MAX, CONF_EQUALS):
+            if key in value and value[key] < 0:
+                raise cv.Invalid(f"'{key}' must be positive for datapoint_type {dptype}")
+        if any(v < 0 for v in value.get(CONF_IN, [])):
+            raise cv.Invalid(f"'{CONF_IN}' must be positive for datapoint_type {dptype}")
+    return value
+
+
+def datapoint_condition_expression(config):
+    """Compile the value tests of a trigger into a C++ lambda, None when there are none."""
+    dptype = config[CONF_DATAPOINT_TYPE]
+    field = f"dp.{CONDITION_FIELDS.get(dptype)}"
+    suffix = "u" if dptype in UNSIGNED_DPTYPES else ""
+    tests = []
+    if CONF_MIN in config:
+        tests.append(f"{field} >= {config[CONF_MIN]}{suffix}")
+    if CONF_MAX in config:
+        tests.append(f"{field} <= {config[CONF_MAX]}{suffix}")
+    if CONF_EQUALS in config:
+        if dptype == DPTYPE_BOOL:
+            tests.append(f"{field} == {str(config[CONF_EQUALS]).lower()}")
+        elif dptype == DPTYPE_STRING:
+            tests.append(f"{field} == {cpp_string_escape(config[CONF_EQUALS])}")
+        else:
+            tests.append(f"{field} == {config[CONF_EQUALS]}{suffix}")
+    if CONF_IN in config:
+        tests.append(
+            "("
+            + " || ".join(f"{field} == {v}{suffix}" for v in config[CONF_IN])
+            + ")"
+        )
+    if CONF_BITS_ALL in config:
+        tests.append(
+            f"(dp.value_uint & {config[CONF_BITS_ALL]:#x}u) == {config[CONF_BITS_ALL]:#x}u"
+        )
+    if CONF_BITS_ANY in config:
+        tests.append(f"(dp.value_uint & {config[CONF_BITS_ANY]:#x}u) != 0")
+    if not tests:
+        return None
+    return cg.RawExpression(
+        f"[]({DATAPOINT_TYPES[DPTYPE_ANY]} dp) -> bool {{ return {' && '.join(tests)}; }}"
+    )
+
+
+DATAPOINT_FILTER_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_DATAPOINT): cv.uint8_t,
+        cv.Optional(CONF_DROP_UNCHANGED, default=True): cv.boolean,
+        cv.Optional(CONF_DEADBAND, default=0): cv.uint32_t,
+        cv.Optional(
+            CONF_MIN_INTERVAL, default="0ms"
+        ): cv.positive_time_period_milliseconds,
+    }
+)
+
+
+def validate_datapoint_filters(value):
+    datapoints = [conf[CONF_DATAPOINT] for conf in value]
+    for dp in datapoints:
+        if datapoints.count(dp) > 1:
+            raise cv.Invalid(f"Datapoint {dp} has more than one filter")
+    return value
+
+
+HOST_UART_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(TuyaDoorLockHostUART),
+            cv.Required(CONF_DEVICE): cv.string,
+            cv.Optional(CONF_BAUD_RATE, default=9600): cv.int_range(min=1),
+        }
+    ).extend(cv.COMPONENT_SCHEMA),
+    cv.only_on(PLATFORM_HOST),
+)
+
 CONF_TUYA_ID = "tuya_id"
-CONFIG_SCHEMA = (
+CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(TuyaDoorLock),
             cv.Optional(CONF_TIME_ID): cv.use_id(time.RealTimeClock),
+            cv.Optional(
+                CONF_TIME_PUSH_THRESHOLD, default="30s"
+            ): cv.positive_time_period_seconds,
             cv.Optional(CONF_IGNORE_MCU_UPDATE_ON_DATAPOINTS): cv.ensure_list(
                 cv.uint8_t
             ),
+            cv.Optional(CONF_DATAPOINT_FILTERS): cv.All(
+                cv.ensure_list(DATAPOINT_FILTER_SCHEMA), validate_datapoint_filters
+            ),
             cv.Optional(CONF_STATUS_PIN): pins.gpio_output_pin_schema,
             cv.Optional(CONF_ENABLE_SENSOR): cv.use_id(BinarySensor),
             cv.Optional(CONF_TOTP_KEY): cv.string,
+            cv.Optional(
+                CONF_RECEIVE_TIMEOUT, default="300ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_COMMAND_DELAY, default="0ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_MAX_RETRIES, default=5): cv.int_range(min=1, max=255),
+            cv.Optional(CONF_LINE_IDLE_BYTES, default=4): cv.int_range(min=0, max=255),
+            cv.Optional(
+                CONF_RETRANSMIT_WINDOW, default="0ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_PASSTHROUGH_UART_ID): cv.use_id(uart.UARTComponent),
+            cv.Optional(CONF_HOST_UART): HOST_UART_SCHEMA,
+            cv.Optional(CONF_RX_TASK_CORE): cv.All(
+                cv.only_on_esp32, cv.int_range(min=0, max=1)
+            ),
+            cv.Optional(CONF_WRITE_QUEUE_SIZE, default=16): cv.int_range(
+                min=1, max=1024
+            ),
+            cv.Optional(CONF_CAPTURE_SIZE, default=256): cv.int_range(
+                min=0, max=65535
+            ),
+            cv.Optional(CONF_JOURNAL_SIZE, default=32): cv.int_range(
+                min=0, max=4096
+            ),
             cv.Optional(CONF_ON_DATAPOINT_UPDATE): automation.validate_automation(
                 {
                     cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(
@@ -105,24 +298,78 @@ CONFIG_SCHEMA = (
                     cv.Optional(CONF_DATAPOINT_TYPE, default=DPTYPE_ANY): cv.one_of(
                         *DATAPOINT_TRIGGERS, lower=True
                     ),
+                    cv.Optional(CONF_MIN): cv.int_,
+                    cv.Optional(CONF_MAX): cv.int_,
+                    cv.Optional(CONF_EQUALS): cv.valid,
+                    cv.Optional(CONF_IN): cv.ensure_list(cv.int_),
+                    cv.Optional(CONF_CHANGED_ONLY, default=False): cv.boolean,
+                    cv.Optional(CONF_BITS_ALL): cv.hex_uint32_t,
+                    cv.Optional(CONF_BITS_ANY): cv.hex_uint32_t,
                 },
-                extra_validators=assign_declare_id,
+                extra_validators=cv.All(
+                    assign_declare_id, validate_datapoint_conditions
+                ),
+            ),
+            cv.Optional(CONF_ON_COMMAND): automation.validate_automation(
+                {
+                    cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(
+                        TuyaDoorLockCommandTrigger
+                    ),
+                    cv.Required(CONF_COMMAND): cv.hex_uint8_t,
+                    cv.Optional(CONF_EXPECTS_RESPONSE, default=False): cv.boolean,
+                }
             ),
             # cv.Optional(CONF_REQUEST_REMOTE_TOTP): cv.use_id(text.Text),
         }
     )
     .extend(cv.COMPONENT_SCHEMA)
-    .extend(uart.UART_DEVICE_SCHEMA)
+    .extend(uart.UART_DEVICE_SCHEMA),
+    # The RX task only frames the MCU side, passthrough forwarding stays in loop()
+    cv.has_at_most_one_key(CONF_PASSTHROUGH_UART_ID, CONF_RX_TASK_CORE),
 )
 
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
+    # All locks of the board share one TX scheduler
+    if not CORE.data.setdefault("tuya_door_lock_tx_scheduler", False):
+        CORE.data["tuya_door_lock_tx_scheduler"] = True
+        scheduler = cg.RawExpression(
+            "tuya_door_lock::TuyaDoorLockTxScheduler::get_instance()"
+        )
+        cg.add(cg.App.register_component(scheduler))
+    if CONF_HOST_UART in config:
+        conf = config[CONF_HOST_UART]
+        host_uart = cg.new_Pvariable(conf[CONF_ID])
+        await cg.register_component(host_uart, conf)
+        cg.add(host_uart.set_device(conf[CONF_DEVICE]))
+        cg.add(host_uart.set_baud_rate(conf[CONF_BAUD_RATE]))
+        # All host serial ports share one epoll event loop
+        if not CORE.data.setdefault("tuya_door_lock_host_event_loop", False):
+            CORE.data["tuya_door_lock_host_event_loop"] = True
+            event_loop = cg.RawExpression(
+                "tuya_door_lock::TuyaDoorLockHostEventLoop::get_instance()"
+            )
+            cg.add(cg.App.register_component(event_loop))
     await uart.register_uart_device(var, config)
+    cg.add(var.set_receive_timeout(config[CONF_RECEIVE_TIMEOUT]))
+    cg.add(var.set_command_delay(config[CONF_COMMAND_DELAY]))
+    cg.add(var.set_max_retries(config[CONF_MAX_RETRIES]))
+    cg.add(var.set_line_idle_bytes(config[CONF_LINE_IDLE_BYTES]))
+    cg.add(var.set_retransmit_window(config[CONF_RETRANSMIT_WINDOW]))
+    cg.add(var.set_write_queue_size(config[CONF_WRITE_QUEUE_SIZE]))
+    cg.add(var.set_capture_size(config[CONF_CAPTURE_SIZE]))
+    cg.add(var.set_journal_size(config[CONF_JOURNAL_SIZE]))
+    if CONF_RX_TASK_CORE in config:
+        cg.add(var.set_rx_task_core(config[CONF_RX_TASK_CORE]))
+    if CONF_PASSTHROUGH_UART_ID in config:
+        passthrough_uart = await cg.get_variable(config[CONF_PASSTHROUGH_UART_ID])
+        cg.add(var.set_passthrough_uart(passthrough_uart))
     if CONF_TIME_ID in config:
         time_ = await cg.get_variable(config[CONF_TIME_ID])
         cg.add(var.set_time_id(time_))
+        cg.add(var.set_time_push_threshold(config[CONF_TIME_PUSH_THRESHOLD]))
     if CONF_STATUS_PIN in config:
         status_pin_ = await cg.gpio_pin_expression(config[CONF_STATUS_PIN])
         cg.add(var.set_status_pin(status_pin_))
@@ -136,10 +383,52 @@ async def to_code(config):
     if CONF_IGNORE_MCU_UPDATE_ON_DATAPOINTS in config:
         for dp in config[CONF_IGNORE_MCU_UPDATE_ON_DATAPOINTS]:
             cg.add(var.add_ignore_mcu_update_on_datapoints(dp))
+    for conf in config.get(CONF_DATAPOINT_FILTERS, []):
+        cg.add(
+            var.add_datapoint_filter(
+                conf[CONF_DATAPOINT],
+                conf[CONF_DROP_UNCHANGED],
+                conf[CONF_DEADBAND],
+                conf[CONF_MIN_INTERVAL],
+            )
+        )
     for conf in config.get(CONF_ON_DATAPOINT_UPDATE, []):
         trigger = cg.new_Pvariable(
             conf[CONF_TRIGGER_ID], var, conf[CONF_SENSOR_DATAPOINT]
         )
+        # Checked in C++ before the automation is started
+        condition = datapoint_condition_expression(conf)
+        if condition is not None:
+            cg.add(trigger.set_condition(condition))
+        if conf[CONF_CHANGED_ONLY]:
+            cg.add(trigger.set_changed_only(True))
         await automation.build_automation(
             trigger, [(DATAPOINT_TYPES[conf[CONF_DATAPOINT_TYPE]], "x")], conf
         )
+    for conf in config.get(CONF_ON_COMMAND, []):
+        trigger = cg.new_Pvariable(
+            conf[CONF_TRIGGER_ID],
+            var,
+            conf[CONF_COMMAND],
+            conf[CONF_EXPECTS_RESPONSE],
+        )
+        await automation.build_automation(
+            trigger,
+            [(TuyaDoorLockFrame.operator("const").operator("ref"), "frame")],
+            conf,
+        )
+
+
+@automation.register_action(
+    "tuya_door_lock.dump_capture",
+    TuyaDoorLockDumpCaptureAction,
+    automation.maybe_simple_id(
+        {
+            cv.GenerateID(): cv.use_id(TuyaDoorLock),
+        }
+    ),
+)
+async def tuya_door_lock_dump_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
@@ -7,60 +7,81 @@ static const char *const TAG = "tuya_door_lock.automation";
 namespace esphome {
 namespace tuya_door_lock {
 
-void check_expected_datapoint(const TuyaDoorLockDatapoint &dp, TuyaDoorLockDatapointType expected) {
-  if (dp.type != expected) {
-    ESP_LOGW(TAG, "TuyaDoorLock sensor %u expected datapoint type %#02hhX but got %#02hhX", dp.id,
-             static_cast<uint8_t>(expected), static_cast<uint8_t>(dp.type));
+bool TuyaDoorLockDatapointCondition::check(const TuyaDoorLockDatapoint &dp) {
+  if (this->changed_only_) {
+    // The decoder clears value_uint first, so it holds every numeric type whole
+    const bool hashed = dp.type == TuyaDoorLockDatapointType::RAW || dp.type == TuyaDoorLockDatapointType::STRING;
+    const uint32_t value = hashed ? hash_datapoint_value(dp) : dp.value_uint;
+    const bool changed =
+        !this->has_last_ || dp.type != this->last_type_ || dp.len != this->last_len_ || value != this->last_value_;
+    this->has_last_ = true;
+    this->last_type_ = dp.type;
+    this->last_len_ = dp.len;
+    this->last_value_ = value;
+    if (!changed)
+      return false;
   }
+  return !this->condition_ || this->condition_(dp);
 }
 
-TuyaDoorLockRawDatapointUpdateTrigger::TuyaDoorLockRawDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-  parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::RAW);
-    this->trigger(dp.value_raw);
+// The MCU never changes the type of a datapoint, so it is only compared on the first update
+static void register_typed_listener(TuyaDoorLock *parent, uint8_t sensor_id, TuyaDoorLockDatapointType expected,
+                                    TuyaDoorLockDatapointCondition *condition,
+                                    std::function<void(const TuyaDoorLockDatapoint &)> &&deliver) {
+  parent->register_listener(sensor_id, [expected, condition, deliver = std::move(deliver),
+                                        checked = false](const TuyaDoorLockDatapoint &dp) mutable {
+    if (!checked) {
+      checked = true;
+      if (dp.type != expected) {
+        ESP_LOGW(TAG, "TuyaDoorLock sensor %u expected datapoint type %#02hhX but got %#02hhX", dp.id,
+                 static_cast<uint8_t>(expected), static_cast<uint8_t>(dp.type));
+      }
+    }
+    if (condition->check(dp))
+      deliver(dp);
   });
 }
 
-TuyaDoorLockBoolDatapointUpdateTrigger::TuyaDoorLockBoolDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
+TuyaDoorLockDatapointUpdateTrigger::TuyaDoorLockDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
   parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::BOOLEAN);
-    this->trigger(dp.value_bool);
+    if (this->check(dp))
+      this->trigger(dp);
   });
 }
 
+TuyaDoorLockRawDatapointUpdateTrigger::TuyaDoorLockRawDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::RAW, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_raw); });
+}
+
+TuyaDoorLockBoolDatapointUpdateTrigger::TuyaDoorLockBoolDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::BOOLEAN, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_bool); });
+}
+
 TuyaDoorLockIntDatapointUpdateTrigger::TuyaDoorLockIntDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-  parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::INTEGER);
-    this->trigger(dp.value_int);
-  });
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::INTEGER, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_int); });
 }
 
 TuyaDoorLockUIntDatapointUpdateTrigger::TuyaDoorLockUIntDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-  parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::INTEGER);
-    this->trigger(dp.value_uint);
-  });
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::INTEGER, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_uint); });
 }
 
 TuyaDoorLockStringDatapointUpdateTrigger::TuyaDoorLockStringDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-  parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::STRING);
-    this->trigger(dp.value_string);
-  });
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::STRING, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_string); });
 }
 
 TuyaDoorLockEnumDatapointUpdateTrigger::TuyaDoorLockEnumDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-  parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::ENUM);
-    this->trigger(dp.value_enum);
-  });
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::ENUM, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_enum); });
 }
 
 TuyaDoorLockBitmaskDatapointUpdateTrigger::TuyaDoorLockBitmaskDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-  parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) {
-    check_expected_datapoint(dp, TuyaDoorLockDatapointType::BITMASK);
-    this->trigger(dp.value_bitmask);
-  });
+  register_typed_listener(parent, sensor_id, TuyaDoorLockDatapointType::BITMASK, this,
+                          [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp.value_bitmask); });
 }
 
 }  // namespace tuya_door_lock
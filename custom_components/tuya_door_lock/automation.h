@@ -9,47 +9,89 @@
 namespace esphome {
 namespace tuya_door_lock {
 
-class TuyaDoorLockDatapointUpdateTrigger : public Trigger<TuyaDoorLockDatapoint> {
+// Conditions of an on_datapoint_update trigger, checked before its automation is started. The value tests are
+// compiled from YAML into condition.
+class TuyaDoorLockDatapointCondition {
  public:
-  explicit TuyaDoorLockDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id) {
-    parent->register_listener(sensor_id, [this](const TuyaDoorLockDatapoint &dp) { this->trigger(dp); });
+  void set_condition(std::function<bool(const TuyaDoorLockDatapoint &)> &&condition) {
+    this->condition_ = std::move(condition);
   }
+  void set_changed_only(bool changed_only) { this->changed_only_ = changed_only; }
+  // Whether the automation should run for dp, called once per update
+  bool check(const TuyaDoorLockDatapoint &dp);
+
+ protected:
+  std::function<bool(const TuyaDoorLockDatapoint &)> condition_{};
+  bool changed_only_{false};
+  bool has_last_{false};
+  // Previous value for changed_only, compared as is for numeric types, as a hash of the bytes for RAW and STRING
+  TuyaDoorLockDatapointType last_type_{TuyaDoorLockDatapointType::RAW};
+  size_t last_len_{0};
+  uint32_t last_value_{0};
+};
+
+// Datapoint triggers pass their value by const reference, RAW and STRING values included. The reference points into
+// the datapoint being dispatched and is only valid while the automation runs synchronously.
+class TuyaDoorLockDatapointUpdateTrigger : public Trigger<const TuyaDoorLockDatapoint &>,
+                                           public TuyaDoorLockDatapointCondition {
+ public:
+  explicit TuyaDoorLockDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockRawDatapointUpdateTrigger : public Trigger<std::vector<uint8_t>> {
+class TuyaDoorLockRawDatapointUpdateTrigger : public Trigger<const std::vector<uint8_t> &>,
+                                              public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockRawDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockBoolDatapointUpdateTrigger : public Trigger<bool> {
+class TuyaDoorLockBoolDatapointUpdateTrigger : public Trigger<bool>,
+                                               public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockBoolDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockIntDatapointUpdateTrigger : public Trigger<int> {
+class TuyaDoorLockIntDatapointUpdateTrigger : public Trigger<int>,
+                                              public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockIntDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockUIntDatapointUpdateTrigger : public Trigger<uint32_t> {
+class TuyaDoorLockUIntDatapointUpdateTrigger : public Trigger<uint32_t>,
+                                               public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockUIntDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockStringDatapointUpdateTrigger : public Trigger<std::string> {
+class TuyaDoorLockStringDatapointUpdateTrigger : public Trigger<const std::string &>,
+                                                 public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockStringDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockEnumDatapointUpdateTrigger : public Trigger<uint8_t> {
+class TuyaDoorLockEnumDatapointUpdateTrigger : public Trigger<uint8_t>,
+                                               public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockEnumDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
-class TuyaDoorLockBitmaskDatapointUpdateTrigger : public Trigger<uint32_t> {
+class TuyaDoorLockBitmaskDatapointUpdateTrigger : public Trigger<uint32_t>,
+                                                  public TuyaDoorLockDatapointCondition {
  public:
   explicit TuyaDoorLockBitmaskDatapointUpdateTrigger(TuyaDoorLock *parent, uint8_t sensor_id);
 };
 
+class TuyaDoorLockCommandTrigger : public Trigger<const TuyaDoorLockFrame &> {
+ public:
+  explicit TuyaDoorLockCommandTrigger(TuyaDoorLock *parent, uint8_t command, bool expects_response) {
+    parent->register_command_handler(
+        command, [this](const TuyaDoorLockFrame &frame) { this->trigger(frame); }, expects_response);
+  }
+};
+
+template<typename... Ts> class TuyaDoorLockDumpCaptureAction : public Action<Ts...>, public Parented<TuyaDoorLock> {
+ public:
+  void play(Ts... x) override { this->parent_->dump_capture(); }
+};
+
 }  // namespace tuya_door_lock
 }  // namespace esphome
@@ -20,8 +20,7 @@ void TuyaDoorLockClimate::setup() {
           this->mode = climate::CLIMATE_MODE_COOL;
         }
       }
-      this->compute_state_();
-      this->publish_state();
+      this->state_pending_ = true;
     });
   }
   if (this->heating_state_pin_ != nullptr) {
@@ -36,8 +35,7 @@ void TuyaDoorLockClimate::setup() {
     this->parent_->register_listener(*this->active_state_id_, [this](const TuyaDoorLockDatapoint &datapoint) {
       ESP_LOGV(TAG, "MCU reported active state is: %u", datapoint.value_enum);
       this->active_state_ = datapoint.value_enum;
-      this->compute_state_();
-      this->publish_state();
+      this->state_pending_ = true;
     });
   }
   if (this->target_temperature_id_.has_value()) {
@@ -49,8 +47,7 @@ void TuyaDoorLockClimate::setup() {
 
       ESP_LOGV(TAG, "MCU reported manual target temperature is: %.1f", this->manual_temperature_);
       this->compute_target_temperature_();
-      this->compute_state_();
-      this->publish_state();
+      this->state_pending_ = true;
     });
   }
   if (this->current_temperature_id_.has_value()) {
@@ -61,8 +58,7 @@ void TuyaDoorLockClimate::setup() {
       }
 
       ESP_LOGV(TAG, "MCU reported current temperature is: %.1f", this->current_temperature);
-      this->compute_state_();
-      this->publish_state();
+      this->state_pending_ = true;
     });
   }
   if (this->eco_id_.has_value()) {
@@ -71,7 +67,7 @@ void TuyaDoorLockClimate::setup() {
       ESP_LOGV(TAG, "MCU reported eco is: %s", ONOFF(this->eco_));
       this->compute_preset_();
       this->compute_target_temperature_();
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
   if (this->sleep_id_.has_value()) {
@@ -80,7 +76,7 @@ void TuyaDoorLockClimate::setup() {
       ESP_LOGV(TAG, "MCU reported sleep is: %s", ONOFF(this->sleep_));
       this->compute_preset_();
       this->compute_target_temperature_();
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
   if (this->swing_vertical_id_.has_value()) {
@@ -88,7 +84,7 @@ void TuyaDoorLockClimate::setup() {
       this->swing_vertical_ = datapoint.value_bool;
       ESP_LOGV(TAG, "MCU reported vertical swing is: %s", ONOFF(datapoint.value_bool));
       this->compute_swingmode_();
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
 
@@ -97,7 +93,7 @@ void TuyaDoorLockClimate::setup() {
       this->swing_horizontal_ = datapoint.value_bool;
       ESP_LOGV(TAG, "MCU reported horizontal swing is: %s", ONOFF(datapoint.value_bool));
       this->compute_swingmode_();
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
 
@@ -106,9 +102,23 @@ void TuyaDoorLockClimate::setup() {
       ESP_LOGV(TAG, "MCU reported Fan Speed Mode is: %u", datapoint.value_enum);
       this->fan_state_ = datapoint.value_enum;
       this->compute_fanmode_();
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
+
+  // Several datapoints of one frame collapse into a single state update
+  this->parent_->add_on_frame_commit_callback([this]() { this->publish_pending_state_(); });
+  // Datapoints the parent already knew were replayed by register_listener() before there was a commit callback
+  this->publish_pending_state_();
+}
+
+void TuyaDoorLockClimate::publish_pending_state_() {
+  if (this->state_pending_)
+    this->compute_state_();
+  if (this->state_pending_ || this->publish_pending_)
+    this->publish_state();
+  this->state_pending_ = false;
+  this->publish_pending_ = false;
 }
 
 void TuyaDoorLockClimate::loop() {
@@ -85,6 +85,9 @@ class TuyaDoorLockClimate : public climate::Climate, public Component {
   /// Switch the climate device to the given climate mode.
   void switch_to_action_(climate::ClimateAction action);
 
+  /// Publish what the datapoints of the last frame changed.
+  void publish_pending_state_();
+
   TuyaDoorLock *parent_;
   bool supports_heat_;
   bool supports_cool_;
@@ -122,6 +125,8 @@ class TuyaDoorLockClimate : public climate::Climate, public Component {
   bool eco_;
   bool sleep_;
   bool reports_fahrenheit_{false};
+  bool state_pending_{false};
+  bool publish_pending_{false};
 };
 
 }  // namespace tuya_door_lock
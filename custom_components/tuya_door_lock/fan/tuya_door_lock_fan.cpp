@@ -15,12 +15,12 @@ void TuyaDoorLockFan::setup() {
           ESP_LOGE(TAG, "Speed has invalid value %d", datapoint.value_enum);
         } else {
           this->speed = datapoint.value_enum + 1;
-          this->publish_state();
+          this->publish_pending_ = true;
         }
       } else if (datapoint.type == TuyaDoorLockDatapointType::INTEGER) {
         ESP_LOGV(TAG, "MCU reported speed of: %d", datapoint.value_int);
         this->speed = datapoint.value_int;
-        this->publish_state();
+        this->publish_pending_ = true;
       }
       this->speed_type_ = datapoint.type;
     });
@@ -29,7 +29,7 @@ void TuyaDoorLockFan::setup() {
     this->parent_->register_listener(*this->switch_id_, [this](const TuyaDoorLockDatapoint &datapoint) {
       ESP_LOGV(TAG, "MCU reported switch is: %s", ONOFF(datapoint.value_bool));
       this->state = datapoint.value_bool;
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
   if (this->oscillation_id_.has_value()) {
@@ -38,7 +38,7 @@ void TuyaDoorLockFan::setup() {
       // scenarios
       ESP_LOGV(TAG, "MCU reported oscillation is: %s", ONOFF(datapoint.value_bool));
       this->oscillating = datapoint.value_bool;
-      this->publish_state();
+      this->publish_pending_ = true;
 
       this->oscillation_type_ = datapoint.type;
     });
@@ -47,7 +47,7 @@ void TuyaDoorLockFan::setup() {
     this->parent_->register_listener(*this->direction_id_, [this](const TuyaDoorLockDatapoint &datapoint) {
       ESP_LOGD(TAG, "MCU reported reverse direction is: %s", ONOFF(datapoint.value_bool));
       this->direction = datapoint.value_bool ? fan::FanDirection::REVERSE : fan::FanDirection::FORWARD;
-      this->publish_state();
+      this->publish_pending_ = true;
     });
   }
 
@@ -56,6 +56,17 @@ void TuyaDoorLockFan::setup() {
     if (restored)
       restored->to_call(*this).perform();
   });
+  // Speed, switch and direction changes reported together publish as one state
+  this->parent_->add_on_frame_commit_callback([this]() { this->publish_pending_state_(); });
+  // Datapoints the parent already knew were replayed by register_listener() before there was a commit callback
+  this->publish_pending_state_();
+}
+
+void TuyaDoorLockFan::publish_pending_state_() {
+  if (!this->publish_pending_)
+    return;
+  this->publish_pending_ = false;
+  this->publish_state();
 }
 
 void TuyaDoorLockFan::dump_config() {
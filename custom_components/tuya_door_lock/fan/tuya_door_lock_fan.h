@@ -21,6 +21,7 @@ class TuyaDoorLockFan : public Component, public fan::Fan {
 
  protected:
   void control(const fan::FanCall &call) override;
+  void publish_pending_state_();
 
   TuyaDoorLock *parent_;
   optional<uint8_t> speed_id_{};
@@ -30,6 +31,7 @@ class TuyaDoorLockFan : public Component, public fan::Fan {
   int speed_count_{};
   TuyaDoorLockDatapointType speed_type_{};
   TuyaDoorLockDatapointType oscillation_type_{};
+  bool publish_pending_{false};
 };
 
 }  // namespace tuya_door_lock
@@ -0,0 +1,288 @@
+#include "host_uart.h"
+
+#ifdef USE_HOST
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+
+static const char *const TAG = "tuya_door_lock.host_uart";
+static const size_t RX_READ_SIZE = 256;
+static const int MAX_EPOLL_EVENTS = 64;
+static const uint32_t REOPEN_BACKOFF_MIN = 500;
+static const uint32_t REOPEN_BACKOFF_MAX = 30000;
+
+TuyaDoorLockHostEventLoop *TuyaDoorLockHostEventLoop::get_instance() {
+  static TuyaDoorLockHostEventLoop *instance = nullptr;
+  if (instance == nullptr)
+    instance = new TuyaDoorLockHostEventLoop();  // NOLINT
+  return instance;
+}
+
+void TuyaDoorLockHostEventLoop::add_uart(TuyaDoorLockHostUART *uart) {
+  if (this->epoll_fd_ < 0) {
+    this->epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (this->epoll_fd_ < 0) {
+      ESP_LOGE(TAG, "Could not create epoll set: %s", strerror(errno));
+      return;
+    }
+  }
+  struct epoll_event event {};
+  // EPOLLHUP and EPOLLERR are always reported
+  event.events = EPOLLIN;
+  event.data.ptr = uart;
+  if (epoll_ctl(this->epoll_fd_, EPOLL_CTL_ADD, uart->get_fd(), &event) != 0) {
+    ESP_LOGE(TAG, "Could not watch %s: %s", uart->get_device().c_str(), strerror(errno));
+    return;
+  }
+  this->uarts_.push_back(uart);
+}
+
+void TuyaDoorLockHostEventLoop::remove_uart(TuyaDoorLockHostUART *uart) {
+  auto it = std::find(this->uarts_.begin(), this->uarts_.end(), uart);
+  if (it == this->uarts_.end())
+    return;
+  // Closing the fd alone would leave it in the set while a duplicate of it is open somewhere
+  epoll_ctl(this->epoll_fd_, EPOLL_CTL_DEL, uart->get_fd(), nullptr);
+  this->uarts_.erase(it);
+}
+
+void TuyaDoorLockHostEventLoop::loop() {
+  if (this->epoll_fd_ < 0)
+    return;
+  struct epoll_event events[MAX_EPOLL_EVENTS];
+  const int count = epoll_wait(this->epoll_fd_, events, MAX_EPOLL_EVENTS, 0);
+  const uint32_t now = micros();
+  for (int i = 0; i < count; i++) {
+    auto *uart = static_cast<TuyaDoorLockHostUART *>(events[i].data.ptr);
+    // A level-triggered hangup would otherwise be reported on every iteration
+    if (events[i].events & EPOLLERR) {
+      uart->hang_up("error on the port");
+    } else if (events[i].events & EPOLLHUP) {
+      uart->hang_up("hung up");
+    } else {
+      uart->set_rx_ready(now);
+    }
+  }
+}
+
+void TuyaDoorLockHostEventLoop::dump_config() {
+  ESP_LOGCONFIG(TAG, "TuyaDoorLock Host Event Loop:");
+  ESP_LOGCONFIG(TAG, "  Serial ports: %zu", this->uarts_.size());
+  ESP_LOGCONFIG(TAG, "  Max dispatch latency: %" PRIu32 "us", this->max_dispatch_us_);
+}
+
+static speed_t baud_rate_to_speed(uint32_t baud_rate) {
+  switch (baud_rate) {
+    case 1200:
+      return B1200;
+    case 2400:
+      return B2400;
+    case 4800:
+      return B4800;
+    case 9600:
+      return B9600;
+    case 19200:
+      return B19200;
+    case 38400:
+      return B38400;
+    case 57600:
+      return B57600;
+    case 115200:
+      return B115200;
+    case 230400:
+      return B230400;
+    default:
+      ESP_LOGW(TAG, "Unsupported baud rate %" PRIu32 ", using 9600", baud_rate);
+      return B9600;
+  }
+}
+
+void TuyaDoorLockHostUART::setup() {
+  if (!this->open_()) {
+    this->mark_failed();
+    return;
+  }
+  this->rx_buffer_.reserve(RX_READ_SIZE);
+}
+
+bool TuyaDoorLockHostUART::open_() {
+  // Only the first attempt is worth an error, the port being gone was logged when it was lost
+  const auto fail = [this](const char *what) {
+    if (this->lost_) {
+      ESP_LOGV(TAG, "Could not %s %s: %s", what, this->device_.c_str(), strerror(errno));
+    } else {
+      ESP_LOGE(TAG, "Could not %s %s: %s", what, this->device_.c_str(), strerror(errno));
+    }
+    if (this->fd_ >= 0)
+      ::close(this->fd_);
+    this->fd_ = -1;
+    return false;
+  };
+  this->fd_ = ::open(this->device_.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (this->fd_ < 0)
+    return fail("open");
+
+  struct termios tty {};
+  if (tcgetattr(this->fd_, &tty) != 0)
+    return fail("read attributes of");
+  // Raw 8N1, no flow control
+  cfmakeraw(&tty);
+  tty.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+  tty.c_cflag |= CS8 | CLOCAL | CREAD;
+  tty.c_cc[VMIN] = 0;
+  tty.c_cc[VTIME] = 0;
+  const speed_t speed = baud_rate_to_speed(this->baud_rate_);
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  if (tcsetattr(this->fd_, TCSANOW, &tty) != 0)
+    return fail("configure");
+  tcflush(this->fd_, TCIOFLUSH);
+
+  this->event_loop_ = TuyaDoorLockHostEventLoop::get_instance();
+  this->event_loop_->add_uart(this);
+  return true;
+}
+
+void TuyaDoorLockHostUART::close_(const char *reason) {
+  if (this->fd_ < 0)
+    return;
+  ESP_LOGW(TAG, "Lost %s (%s), reopening it in the background", this->device_.c_str(), reason);
+  if (this->event_loop_ != nullptr)
+    this->event_loop_->remove_uart(this);
+  ::close(this->fd_);
+  this->fd_ = -1;
+  this->rx_buffer_.clear();
+  this->rx_pos_ = 0;
+  this->rx_ready_ = false;
+  this->tx_pending_.clear();
+  this->lost_ = true;
+  this->closed_at_ = millis();
+  this->reopen_backoff_ = REOPEN_BACKOFF_MIN;
+}
+
+void TuyaDoorLockHostUART::reopen_() {
+  const uint32_t now = millis();
+  if (now - this->closed_at_ < this->reopen_backoff_)
+    return;
+  if (this->open_()) {
+    ESP_LOGI(TAG, "Reopened %s", this->device_.c_str());
+    this->lost_ = false;
+    return;
+  }
+  this->closed_at_ = now;
+  this->reopen_backoff_ = std::min(this->reopen_backoff_ * 2, REOPEN_BACKOFF_MAX);
+}
+
+void TuyaDoorLockHostUART::loop() {
+  if (this->lost_) {
+    this->reopen_();
+    return;
+  }
+  this->write_pending_();
+}
+
+void TuyaDoorLockHostUART::dump_config() {
+  ESP_LOGCONFIG(TAG, "TuyaDoorLock Host UART:");
+  ESP_LOGCONFIG(TAG, "  Device: %s", this->device_.c_str());
+  ESP_LOGCONFIG(TAG, "  Baud Rate: %" PRIu32, this->baud_rate_);
+}
+
+void TuyaDoorLockHostUART::fill_rx_buffer_() {
+  if (this->fd_ < 0 || this->rx_pos_ < this->rx_buffer_.size())
+    return;
+  if (this->event_loop_ != nullptr) {
+    if (!this->rx_ready_)
+      return;
+    this->event_loop_->report_dispatch(micros() - this->rx_ready_at_);
+  }
+  this->rx_buffer_.resize(RX_READ_SIZE);
+  this->rx_pos_ = 0;
+  const ssize_t len = ::read(this->fd_, this->rx_buffer_.data(), RX_READ_SIZE);
+  if (len < 0 && errno == EIO) {
+    this->close_("read failed");
+    return;
+  }
+  if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    ESP_LOGW(TAG, "Read from %s failed: %s", this->device_.c_str(), strerror(errno));
+  this->rx_buffer_.resize(len > 0 ? len : 0);
+  // A short read drained the tty, wait for epoll to report more
+  if ((size_t) this->rx_buffer_.size() < RX_READ_SIZE)
+    this->rx_ready_ = false;
+}
+
+int TuyaDoorLockHostUART::available() {
+  this->fill_rx_buffer_();
+  return this->rx_buffer_.size() - this->rx_pos_;
+}
+
+bool TuyaDoorLockHostUART::peek_byte(uint8_t *data) {
+  if (this->available() == 0)
+    return false;
+  *data = this->rx_buffer_[this->rx_pos_];
+  return true;
+}
+
+bool TuyaDoorLockHostUART::read_array(uint8_t *data, size_t len) {
+  while (len > 0) {
+    const size_t available = this->available();
+    if (available == 0)
+      return false;
+    const size_t chunk = std::min(len, available);
+    std::memcpy(data, &this->rx_buffer_[this->rx_pos_], chunk);
+    this->rx_pos_ += chunk;
+    data += chunk;
+    len -= chunk;
+  }
+  return true;
+}
+
+void TuyaDoorLockHostUART::write_array(const uint8_t *data, size_t len) {
+  this->tx_pending_.insert(this->tx_pending_.end(), data, data + len);
+  this->write_pending_();
+}
+
+void TuyaDoorLockHostUART::write_pending_() {
+  if (this->fd_ < 0 || this->tx_pending_.empty())
+    return;
+  const ssize_t written = ::write(this->fd_, this->tx_pending_.data(), this->tx_pending_.size());
+  if (written < 0) {
+    if (errno == EIO) {
+      this->close_("write failed");
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      ESP_LOGW(TAG, "Write to %s failed, dropping %zu bytes: %s", this->device_.c_str(), this->tx_pending_.size(),
+               strerror(errno));
+      this->tx_pending_.clear();
+    }
+    return;
+  }
+  this->tx_pending_.erase(this->tx_pending_.begin(), this->tx_pending_.begin() + written);
+}
+
+void TuyaDoorLockHostUART::flush() {
+  if (this->fd_ < 0)
+    return;
+  while (!this->tx_pending_.empty()) {
+    this->write_pending_();
+    // Wait for the tty to drain instead of spinning on EAGAIN
+    if (this->fd_ < 0)
+      return;
+    tcdrain(this->fd_);
+  }
+  tcdrain(this->fd_);
+}
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
+
+#endif  // USE_HOST
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_HOST
+
+#include <string>
+#include <vector>
+
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+
+class TuyaDoorLockHostUART;
+
+// Waits on the serial ports of every lock with a single epoll set, once per main loop iteration, so a gateway serving
+// many locks only touches the ports that actually have data instead of polling each one.
+class TuyaDoorLockHostEventLoop : public Component {
+ public:
+  static TuyaDoorLockHostEventLoop *get_instance();
+
+  // Runs before the serial ports and the locks
+  float get_setup_priority() const override { return setup_priority::BUS + 1.0f; }
+  void loop() override;
+  void dump_config() override;
+
+  void add_uart(TuyaDoorLockHostUART *uart);
+  void remove_uart(TuyaDoorLockHostUART *uart);
+  uint32_t get_max_dispatch_us() const { return this->max_dispatch_us_; }
+  void report_dispatch(uint32_t dispatch_us) {
+    if (dispatch_us > this->max_dispatch_us_)
+      this->max_dispatch_us_ = dispatch_us;
+  }
+
+ protected:
+  int epoll_fd_{-1};
+  std::vector<TuyaDoorLockHostUART *> uarts_;
+  uint32_t max_dispatch_us_{0};
+};
+
+// termios backed UART for running the lock bridge on a Linux host with a USB-serial adapter.
+// Reads and writes never block: reads drain the tty in bulk into rx_buffer_, writes the tty cannot take right away
+// are kept in tx_pending_ and retried from loop(). When the adapter goes away the port is closed and loop() tries to
+// open it again, with a growing backoff.
+class TuyaDoorLockHostUART : public uart::UARTComponent, public Component {
+ public:
+  void set_device(const std::string &device) { this->device_ = device; }
+  const std::string &get_device() const { return this->device_; }
+  int get_fd() const { return this->fd_; }
+  bool is_open() const { return this->fd_ >= 0; }
+  // Called by the event loop when epoll reports data on the port
+  void set_rx_ready(uint32_t ready_at) {
+    if (!this->rx_ready_)
+      this->rx_ready_at_ = ready_at;
+    this->rx_ready_ = true;
+  }
+  // Called by the event loop when epoll reports a hangup or error on the port
+  void hang_up(const char *reason) { this->close_(reason); }
+
+  float get_setup_priority() const override { return setup_priority::BUS; }
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+
+  void write_array(const uint8_t *data, size_t len) override;
+  bool peek_byte(uint8_t *data) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override;
+
+ protected:
+  void check_logger_conflict() override {}
+  bool open_();
+  void close_(const char *reason);
+  void reopen_();
+  void fill_rx_buffer_();
+  void write_pending_();
+
+  std::string device_;
+  int fd_{-1};
+  std::vector<uint8_t> rx_buffer_;
+  size_t rx_pos_{0};
+  std::vector<uint8_t> tx_pending_;
+  // Without an event loop every available() call reads the tty, with one only after epoll reported data
+  TuyaDoorLockHostEventLoop *event_loop_{nullptr};
+  bool rx_ready_{false};
+  uint32_t rx_ready_at_{0};
+  // Set once the port was lost, loop() reopens it reopen_backoff_ ms after closed_at_
+  bool lost_{false};
+  uint32_t closed_at_{0};
+  uint32_t reopen_backoff_{0};
+};
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
+
+#endif  // USE_HOST
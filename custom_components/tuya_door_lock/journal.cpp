@@ -0,0 +1,55 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace tuya_door_lock {
+
+void TuyaDoorLockJournal::setup() {
+  if (this->size_ > 0)
+    this->entries_ = new TuyaDoorLockJournalEntry[this->size_];  // NOLINT
+}
+
+void TuyaDoorLockJournal::append(const TuyaDoorLockDatapoint &datapoint, uint32_t timestamp) {
+  if (this->entries_ == nullptr)
+    return;
+  this->sequence_++;
+  TuyaDoorLockJournalEntry &entry = this->entries_[this->sequence_ % this->size_];
+  entry.sequence = this->sequence_;
+  entry.timestamp = timestamp;
+  entry.datapoint.id = datapoint.id;
+  entry.datapoint.type = datapoint.type;
+  entry.datapoint.value = 0;
+  memset(entry.datapoint.head, 0, sizeof(entry.datapoint.head));
+  size_t len = datapoint.len;
+  if (datapoint.type == TuyaDoorLockDatapointType::RAW) {
+    len = datapoint.value_raw.size();
+    memcpy(entry.datapoint.head, datapoint.value_raw.data(), std::min(len, sizeof(entry.datapoint.head)));
+  } else if (datapoint.type == TuyaDoorLockDatapointType::STRING) {
+    len = datapoint.value_string.size();
+    memcpy(entry.datapoint.head, datapoint.value_string.data(), std::min(len, sizeof(entry.datapoint.head)));
+  } else {
+    entry.datapoint.value = datapoint.value_uint;
+  }
+  entry.datapoint.len = std::min<size_t>(len, 0xFFFF);
+  entry.truncated = (datapoint.type == TuyaDoorLockDatapointType::RAW ||
+                     datapoint.type == TuyaDoorLockDatapointType::STRING) &&
+                    len > sizeof(entry.datapoint.head);
+}
+
+bool TuyaDoorLockJournal::read_since(uint32_t sequence, std::vector<TuyaDoorLockJournalEntry> &out) const {
+  if (sequence > this->sequence_)
+    return false;
+  // The ring holds sequences oldest..sequence_
+  const uint32_t oldest = this->sequence_ >= this->size_ ? this->sequence_ - this->size_ + 1 : 1;
+  if (sequence + 1 < oldest)
+    return false;
+  out.reserve(out.size() + (this->sequence_ - sequence));
+  for (uint32_t next = sequence + 1; next <= this->sequence_; next++)
+    out.push_back(this->entries_[next % this->size_]);
+  return true;
+}
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,46 @@
+#pragma once
+
+// Bounded history of datapoint changes, so clients that reconnect can catch up from the last sequence number they
+// saw instead of reading every entity. Kept free of ESPHome includes, like protocol.h.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "protocol.h"
+#include "snapshot.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+
+struct TuyaDoorLockJournalEntry {
+  uint32_t sequence;   // 1 for the first change, then increasing by one
+  uint32_t timestamp;  // millis() when the change was received
+  // RAW or STRING value longer than datapoint.head, read it whole with TuyaDoorLock::get_datapoint()
+  bool truncated;
+  TuyaDoorLockSnapshotDatapoint datapoint;
+};
+// The README gives this size for journal_size
+static_assert(sizeof(TuyaDoorLockJournalEntry) == 28, "journal entry size changed, update journal_size in README.md");
+
+// Ring of the last changes, allocated once. Not thread safe, used from loop() and lambdas only.
+class TuyaDoorLockJournal {
+ public:
+  void set_size(size_t size) { this->size_ = size; }
+  size_t get_size() const { return this->size_; }
+  void setup();
+  void append(const TuyaDoorLockDatapoint &datapoint, uint32_t timestamp);
+  // Sequence number of the last change, 0 before the first one
+  uint32_t get_sequence() const { return this->sequence_; }
+  // Appends the changes after sequence to out, oldest first. false when some of them were already overwritten, the
+  // caller then has to start over from a full snapshot.
+  bool read_since(uint32_t sequence, std::vector<TuyaDoorLockJournalEntry> &out) const;
+
+ protected:
+  TuyaDoorLockJournalEntry *entries_{nullptr};
+  size_t size_{0};
+  uint32_t sequence_{0};
+};
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
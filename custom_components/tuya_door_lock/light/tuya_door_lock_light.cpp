@@ -19,11 +19,9 @@ void TuyaDoorLockLight::setup() {
       if (this->color_temperature_invert_) {
         datapoint_value = this->color_temperature_max_value_ - datapoint_value;
       }
-      auto call = this->state_->make_call();
-      call.set_color_temperature(this->cold_white_temperature_ +
-                                 (this->warm_white_temperature_ - this->cold_white_temperature_) *
-                                     (float(datapoint_value) / this->color_temperature_max_value_));
-      call.perform();
+      this->pending_color_temperature_ = this->cold_white_temperature_ +
+                                         (this->warm_white_temperature_ - this->cold_white_temperature_) *
+                                             (float(datapoint_value) / this->color_temperature_max_value_);
     });
   }
   if (this->dimmer_id_.has_value()) {
@@ -33,9 +31,7 @@ void TuyaDoorLockLight::setup() {
         return;
       }
 
-      auto call = this->state_->make_call();
-      call.set_brightness(float(datapoint.value_uint) / this->max_value_);
-      call.perform();
+      this->pending_brightness_ = float(datapoint.value_uint) / this->max_value_;
     });
   }
   if (switch_id_.has_value()) {
@@ -45,9 +41,7 @@ void TuyaDoorLockLight::setup() {
         return;
       }
 
-      auto call = this->state_->make_call();
-      call.set_state(datapoint.value_bool);
-      call.perform();
+      this->pending_state_ = datapoint.value_bool;
     });
   }
   if (color_id_.has_value()) {
@@ -86,17 +80,44 @@ void TuyaDoorLockLight::setup() {
       this->state_->current_values_as_rgb(&current_red, &current_green, &current_blue);
       if (red == current_red && green == current_green && blue == current_blue)
         return;
-      auto rgb_call = this->state_->make_call();
-      rgb_call.set_rgb(red, green, blue);
-      rgb_call.perform();
+      this->pending_red_ = red;
+      this->pending_green_ = green;
+      this->pending_blue_ = blue;
     });
   }
 
+  // Switch, brightness and color reported in one frame become a single light call
+  this->parent_->add_on_frame_commit_callback([this]() { this->publish_pending_state_(); });
+  // Datapoints the parent already knew were replayed by register_listener() before there was a commit callback
+  this->publish_pending_state_();
+
   if (min_value_datapoint_id_.has_value()) {
     this->parent_->set_integer_datapoint_value(*this->min_value_datapoint_id_, this->min_value_);
   }
 }
 
+void TuyaDoorLockLight::publish_pending_state_() {
+  if (!this->pending_state_.has_value() && !this->pending_brightness_.has_value() &&
+      !this->pending_color_temperature_.has_value() && !this->pending_red_.has_value())
+    return;
+  auto call = this->state_->make_call();
+  if (this->pending_state_.has_value())
+    call.set_state(*this->pending_state_);
+  if (this->pending_brightness_.has_value())
+    call.set_brightness(*this->pending_brightness_);
+  if (this->pending_color_temperature_.has_value())
+    call.set_color_temperature(*this->pending_color_temperature_);
+  if (this->pending_red_.has_value())
+    call.set_rgb(*this->pending_red_, *this->pending_green_, *this->pending_blue_);
+  call.perform();
+  this->pending_state_.reset();
+  this->pending_brightness_.reset();
+  this->pending_color_temperature_.reset();
+  this->pending_red_.reset();
+  this->pending_green_.reset();
+  this->pending_blue_.reset();
+}
+
 void TuyaDoorLockLight::dump_config() {
   ESP_LOGCONFIG(TAG, "TuyaDoorLock Dimmer:");
   if (this->dimmer_id_.has_value()) {
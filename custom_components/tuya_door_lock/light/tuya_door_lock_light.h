@@ -49,6 +49,7 @@ class TuyaDoorLockLight : public Component, public light::LightOutput {
  protected:
   void update_dimmer_(uint32_t value);
   void update_switch_(uint32_t value);
+  void publish_pending_state_();
 
   TuyaDoorLock *parent_;
   optional<uint8_t> dimmer_id_{};
@@ -65,6 +66,13 @@ class TuyaDoorLockLight : public Component, public light::LightOutput {
   bool color_temperature_invert_{false};
   bool color_interlock_{false};
   light::LightState *state_{nullptr};
+  // Values reported by the current frame, applied together once it has been parsed
+  optional<bool> pending_state_{};
+  optional<float> pending_brightness_{};
+  optional<float> pending_color_temperature_{};
+  optional<float> pending_red_{};
+  optional<float> pending_green_{};
+  optional<float> pending_blue_{};
 };
 
 }  // namespace tuya_door_lock
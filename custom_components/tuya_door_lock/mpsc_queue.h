@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace esphome {
+namespace tuya_door_lock {
+
+// Bounded lock-free queue for any number of producer tasks and a single consumer. Every cell carries a sequence
+// number telling whether it is free for the producer that claimed its position or ready for the consumer, so
+// producers only contend on the enqueue position and never on the consumer.
+template<typename T> class TuyaDoorLockMpscQueue {
+ public:
+  explicit TuyaDoorLockMpscQueue(size_t size) { this->resize(size); }
+
+  // Capacity rounded up to a power of two, anything queued is dropped. Only while no other task uses the queue.
+  void resize(size_t size) {
+    size_t capacity = 1;
+    while (capacity < size)
+      capacity <<= 1;
+    this->cells_.reset(new Cell[capacity]);  // NOLINT
+    this->mask_ = capacity - 1;
+    for (size_t i = 0; i < capacity; i++)
+      this->cells_[i].sequence.store(i, std::memory_order_relaxed);
+    this->enqueue_pos_.store(0, std::memory_order_relaxed);
+    this->dequeue_pos_ = 0;
+  }
+  size_t capacity() const { return this->mask_ + 1; }
+
+  // Safe from any task, false when the queue is full
+  bool push(T &&value) {
+    Cell *cell;
+    size_t pos = this->enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &this->cells_[pos & this->mask_];
+      const intptr_t diff = (intptr_t) cell->sequence.load(std::memory_order_acquire) - (intptr_t) pos;
+      if (diff == 0) {
+        if (this->enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = this->enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only, false when nothing is ready
+  bool pop(T &value) {
+    Cell *cell = &this->cells_[this->dequeue_pos_ & this->mask_];
+    if (cell->sequence.load(std::memory_order_acquire) != this->dequeue_pos_ + 1)
+      return false;
+    value = std::move(cell->value);
+    cell->sequence.store(this->dequeue_pos_ + this->mask_ + 1, std::memory_order_release);
+    this->dequeue_pos_++;
+    return true;
+  }
+
+ protected:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_{0};
+  std::atomic<size_t> enqueue_pos_{0};
+  size_t dequeue_pos_{0};
+};
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
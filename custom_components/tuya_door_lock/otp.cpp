@@ -1,12 +1,16 @@
 #include <ctime>
 #include <cmath>
 #include <cstring>
-#include <mbedtls/md.h>
 #include <sys/types.h>
 
 #include "otp.hpp"
+#include "esphome/core/defines.h"
 #include "esphome/core/log.h"
 
+#ifndef USE_HOST
+#include <mbedtls/md.h>
+#endif
+
 #define TAG "otp"
 
 namespace esphome
@@ -80,6 +84,169 @@ namespace esphome
             return totp_hash_token(key, key_len, timestamp, 6);
         }
 
+#ifdef USE_HOST
+        // The host platform has no mbedtls, so HMAC-SHA1 (RFC 2104, FIPS 180-4) is done here
+
+        static const size_t SHA1_BLOCK_SIZE = 64;
+        static const size_t SHA1_DIGEST_SIZE = 20;
+
+        struct Sha1Context
+        {
+            uint32_t state[5];
+            uint64_t length;
+            uint8_t block[SHA1_BLOCK_SIZE];
+            size_t block_len;
+        };
+
+        static uint32_t sha1_rol(uint32_t value, uint32_t bits)
+        {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        static void sha1_transform(Sha1Context *ctx, const uint8_t *block)
+        {
+            uint32_t w[80];
+            for (int i = 0; i < 16; i++)
+            {
+                w[i] = (uint32_t)block[i * 4] << 24 | (uint32_t)block[i * 4 + 1] << 16 | (uint32_t)block[i * 4 + 2] << 8 | (uint32_t)block[i * 4 + 3];
+            }
+            for (int i = 16; i < 80; i++)
+            {
+                w[i] = sha1_rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+
+            uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3], e = ctx->state[4];
+            for (int i = 0; i < 80; i++)
+            {
+                uint32_t f, k;
+                if (i < 20)
+                {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                }
+                else if (i < 40)
+                {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                }
+                else if (i < 60)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                uint32_t temp = sha1_rol(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = sha1_rol(b, 30);
+                b = a;
+                a = temp;
+            }
+            ctx->state[0] += a;
+            ctx->state[1] += b;
+            ctx->state[2] += c;
+            ctx->state[3] += d;
+            ctx->state[4] += e;
+        }
+
+        static void sha1_init(Sha1Context *ctx)
+        {
+            ctx->state[0] = 0x67452301;
+            ctx->state[1] = 0xEFCDAB89;
+            ctx->state[2] = 0x98BADCFE;
+            ctx->state[3] = 0x10325476;
+            ctx->state[4] = 0xC3D2E1F0;
+            ctx->length = 0;
+            ctx->block_len = 0;
+        }
+
+        static void sha1_update(Sha1Context *ctx, const uint8_t *data, size_t len)
+        {
+            ctx->length += len;
+            while (len > 0)
+            {
+                size_t chunk = SHA1_BLOCK_SIZE - ctx->block_len;
+                if (chunk > len)
+                {
+                    chunk = len;
+                }
+                std::memcpy(ctx->block + ctx->block_len, data, chunk);
+                ctx->block_len += chunk;
+                data += chunk;
+                len -= chunk;
+                if (ctx->block_len == SHA1_BLOCK_SIZE)
+                {
+                    sha1_transform(ctx, ctx->block);
+                    ctx->block_len = 0;
+                }
+            }
+        }
+
+        static void sha1_finish(Sha1Context *ctx, uint8_t *out)
+        {
+            const uint64_t bit_length = ctx->length * 8;
+            const uint8_t pad = 0x80;
+            const uint8_t zero = 0x00;
+            sha1_update(ctx, &pad, 1);
+            while (ctx->block_len != SHA1_BLOCK_SIZE - 8)
+            {
+                sha1_update(ctx, &zero, 1);
+            }
+            uint8_t length_be[8];
+            for (int i = 0; i < 8; i++)
+            {
+                length_be[i] = (uint8_t)(bit_length >> (56 - i * 8));
+            }
+            sha1_update(ctx, length_be, sizeof(length_be));
+            for (int i = 0; i < 5; i++)
+            {
+                out[i * 4] = (uint8_t)(ctx->state[i] >> 24);
+                out[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+                out[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+                out[i * 4 + 3] = (uint8_t)(ctx->state[i]);
+            }
+        }
+
+        void hotp_hmac(unsigned char *key, size_t ken_len, uint64_t interval, uint8_t *out)
+        {
+            uint8_t key_block[SHA1_BLOCK_SIZE] = {0};
+            Sha1Context ctx;
+            if (ken_len > SHA1_BLOCK_SIZE)
+            {
+                sha1_init(&ctx);
+                sha1_update(&ctx, key, ken_len);
+                sha1_finish(&ctx, key_block);
+            }
+            else
+            {
+                std::memcpy(key_block, key, ken_len);
+            }
+
+            uint8_t pad[SHA1_BLOCK_SIZE];
+            uint8_t inner[SHA1_DIGEST_SIZE];
+            for (size_t i = 0; i < SHA1_BLOCK_SIZE; i++)
+            {
+                pad[i] = key_block[i] ^ 0x36;
+            }
+            sha1_init(&ctx);
+            sha1_update(&ctx, pad, SHA1_BLOCK_SIZE);
+            sha1_update(&ctx, (const uint8_t *)&interval, sizeof(interval));
+            sha1_finish(&ctx, inner);
+
+            for (size_t i = 0; i < SHA1_BLOCK_SIZE; i++)
+            {
+                pad[i] = key_block[i] ^ 0x5c;
+            }
+            sha1_init(&ctx);
+            sha1_update(&ctx, pad, SHA1_BLOCK_SIZE);
+            sha1_update(&ctx, inner, SHA1_DIGEST_SIZE);
+            sha1_finish(&ctx, out);
+        }
+#else
         void hotp_hmac(unsigned char *key, size_t ken_len, uint64_t interval, uint8_t *out)
         {
             mbedtls_md_context_t ctx;
@@ -93,6 +260,8 @@ namespace esphome
             mbedtls_md_free(&ctx);
         }
 
+#endif
+
         uint32_t hotp_dt(const uint8_t *digest)
         {
             uint64_t offset;
@@ -124,9 +293,9 @@ namespace esphome
 
             // Base32's overhead must be at least 1.4x than the decoded bytes, so the result output must be bigger than this
             size_t expect_len = ceil(std::strlen(encoded) / 1.6);
-            if (buf_len < expect_len)
+            if (buf_len < 0 || (size_t) buf_len < expect_len)
             {
-                ESP_LOGE(TAG, "Buffer length is too short, only %d, need %u", buf_len, expect_len);
+                ESP_LOGE(TAG, "Buffer length is too short, only %d, need %zu", buf_len, expect_len);
                 return -1;
             }
 
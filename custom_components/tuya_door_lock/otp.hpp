@@ -1,6 +1,9 @@
 #ifndef OTP_HPP
 #define OTP_HPP
 
+#include <cstddef>
+#include <cstdint>
+
 namespace esphome {
 namespace otp {
     // public:
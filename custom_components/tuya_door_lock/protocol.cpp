@@ -0,0 +1,187 @@
+#include "protocol.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+
+TuyaDoorLockParseResult TuyaDoorLockFrameParser::feed(uint8_t c) {
+  if (this->complete_)
+    this->reset();
+
+  const size_t at = this->buffer_.size();
+  // Byte 0: HEADER1 (always 0x55)
+  // Byte 1: HEADER2 (always 0xAA)
+  if ((at == 0 && c != 0x55) || (at == 1 && c != 0xAA)) {
+    this->reset();
+    // A repeated HEADER1 may still start the next frame
+    if (at == 1 && c == 0x55) {
+      this->buffer_.push_back(c);
+      this->checksum_ += c;
+    }
+    return TuyaDoorLockParseResult::BAD_HEADER;
+  }
+
+  // Byte 6+LEN: CHECKSUM - sum of all bytes (including header) modulo 256
+  if (at >= FRAME_HEADER_SIZE && at == FRAME_HEADER_SIZE + this->length_) {
+    this->received_checksum_ = c;
+    this->calculated_checksum_ = this->checksum_;
+    if (c != this->checksum_) {
+      this->reset();
+      return TuyaDoorLockParseResult::BAD_CHECKSUM;
+    }
+    this->complete_ = true;
+    return TuyaDoorLockParseResult::FRAME;
+  }
+
+  this->buffer_.push_back(c);
+  this->checksum_ += c;
+  // Byte 4: LENGTH1
+  // Byte 5: LENGTH2
+  if (at == 5)
+    this->length_ = (uint16_t(this->buffer_[4]) << 8) | uint16_t(this->buffer_[5]);
+  return TuyaDoorLockParseResult::INCOMPLETE;
+}
+
+TuyaDoorLockFrame TuyaDoorLockFrameParser::get_frame() const {
+  return TuyaDoorLockFrame{
+      .version = this->buffer_[2],
+      .command = this->buffer_[3],
+      .data = this->buffer_.data() + FRAME_HEADER_SIZE,
+      .len = this->length_,
+  };
+}
+
+void TuyaDoorLockFrameParser::reset() {
+  this->buffer_.clear();
+  this->length_ = 0;
+  this->checksum_ = 0;
+  this->complete_ = false;
+}
+
+void encode_frame(uint8_t version, uint8_t command, const uint8_t *payload, size_t len, std::vector<uint8_t> &out) {
+  const uint8_t len_hi = (uint8_t)(len >> 8);
+  const uint8_t len_lo = (uint8_t)(len & 0xFF);
+  out.insert(out.end(), {0x55, 0xAA, version, command, len_hi, len_lo});
+  out.insert(out.end(), payload, payload + len);
+
+  uint8_t checksum = 0x55 + 0xAA + version + command + len_hi + len_lo;
+  for (size_t i = 0; i < len; i++)
+    checksum += payload[i];
+  out.push_back(checksum);
+}
+
+static uint32_t decode_uint32_be(const uint8_t *data, size_t len) {
+  uint32_t value = 0;
+  for (size_t i = 0; i < len; i++)
+    value = (value << 8) | data[i];
+  return value;
+}
+
+TuyaDoorLockDecodeResult decode_datapoint(const uint8_t *buffer, size_t len, TuyaDoorLockDatapoint &datapoint,
+                                          size_t &consumed) {
+  if (len < 4)
+    return TuyaDoorLockDecodeResult::TRUNCATED;
+  datapoint.id = buffer[0];
+  datapoint.type = (TuyaDoorLockDatapointType)buffer[1];
+  datapoint.value_uint = 0;
+
+  const size_t data_size = (buffer[2] << 8) + buffer[3];
+  const uint8_t *data = buffer + 4;
+  if (data_size > len - 4)
+    return TuyaDoorLockDecodeResult::TRUNCATED;
+  datapoint.len = data_size;
+
+  switch (datapoint.type) {
+    case TuyaDoorLockDatapointType::RAW:
+      datapoint.value_raw.assign(data, data + data_size);
+      break;
+    case TuyaDoorLockDatapointType::BOOLEAN:
+      if (data_size != 1)
+        return TuyaDoorLockDecodeResult::BAD_LENGTH;
+      datapoint.value_bool = data[0];
+      break;
+    case TuyaDoorLockDatapointType::INTEGER:
+      if (data_size != 4)
+        return TuyaDoorLockDecodeResult::BAD_LENGTH;
+      datapoint.value_uint = decode_uint32_be(data, 4);
+      break;
+    case TuyaDoorLockDatapointType::STRING:
+      datapoint.value_string.assign(reinterpret_cast<const char *>(data), data_size);
+      break;
+    case TuyaDoorLockDatapointType::ENUM:
+      if (data_size != 1)
+        return TuyaDoorLockDecodeResult::BAD_LENGTH;
+      datapoint.value_enum = data[0];
+      break;
+    case TuyaDoorLockDatapointType::BITMASK:
+      if (data_size != 1 && data_size != 2 && data_size != 4)
+        return TuyaDoorLockDecodeResult::BAD_LENGTH;
+      datapoint.value_bitmask = decode_uint32_be(data, data_size);
+      break;
+    default:
+      return TuyaDoorLockDecodeResult::UNKNOWN_TYPE;
+  }
+
+  consumed = data_size + 4;
+  return TuyaDoorLockDecodeResult::OK;
+}
+
+void encode_datapoint(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, const uint8_t *data, size_t len,
+                      std::vector<uint8_t> &out) {
+  out.push_back(datapoint_id);
+  out.push_back(static_cast<uint8_t>(datapoint_type));
+  out.push_back(len >> 8);
+  out.push_back(len >> 0);
+  out.insert(out.end(), data, data + len);
+}
+
+int64_t civil_to_seconds(int year, int month, int day, int hour, int minute, int second) {
+  // Days from civil, with March as the first month so leap days end the year
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const int year_of_era = year - era * 400;
+  const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+  const int64_t days = int64_t(era) * 146097 + day_of_era - 719468;
+  return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+static const uint32_t FNV_OFFSET_BASIS = 2166136261UL;
+
+static uint32_t fnv1a(uint32_t hash, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    hash = (hash ^ data[i]) * 16777619UL;
+  return hash;
+}
+
+uint32_t hash_frame(const TuyaDoorLockFrame &frame) {
+  return fnv1a(fnv1a(FNV_OFFSET_BASIS, &frame.command, 1), frame.data, frame.len);
+}
+
+uint32_t hash_datapoint_value(const TuyaDoorLockDatapoint &datapoint) {
+  switch (datapoint.type) {
+    case TuyaDoorLockDatapointType::RAW:
+      return fnv1a(FNV_OFFSET_BASIS, datapoint.value_raw.data(), datapoint.value_raw.size());
+    case TuyaDoorLockDatapointType::STRING:
+      return fnv1a(FNV_OFFSET_BASIS, reinterpret_cast<const uint8_t *>(datapoint.value_string.data()),
+                   datapoint.value_string.size());
+    default:
+      return fnv1a(FNV_OFFSET_BASIS, reinterpret_cast<const uint8_t *>(&datapoint.value_uint),
+                   sizeof(datapoint.value_uint));
+  }
+}
+
+bool datapoint_value_equals(const TuyaDoorLockDatapoint &a, const TuyaDoorLockDatapoint &b) {
+  if (a.type != b.type)
+    return false;
+  switch (a.type) {
+    case TuyaDoorLockDatapointType::RAW:
+      return a.value_raw == b.value_raw;
+    case TuyaDoorLockDatapointType::STRING:
+      return a.value_string == b.value_string;
+    default:
+      return a.len == b.len && a.value_uint == b.value_uint;
+  }
+}
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,140 @@
+#pragma once
+
+// Tuya door lock serial protocol: framing, checksum and datapoint records.
+// Kept free of ESPHome includes so it can be built and profiled on its own.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace tuya_door_lock {
+
+enum class TuyaDoorLockDatapointType : uint8_t {
+  RAW = 0x00,      // variable length
+  BOOLEAN = 0x01,  // 1 byte (0/1)
+  INTEGER = 0x02,  // 4 byte
+  STRING = 0x03,   // variable length
+  ENUM = 0x04,     // 1 byte
+  BITMASK = 0x05,  // 1/2/4 bytes // Not supported
+};
+
+struct TuyaDoorLockDatapoint {
+  uint8_t id;
+  TuyaDoorLockDatapointType type;
+  size_t len;
+  union {
+    bool value_bool;
+    int value_int;
+    uint32_t value_uint;
+    uint8_t value_enum;
+    uint32_t value_bitmask;
+  };
+  std::string value_string;
+  std::vector<uint8_t> value_raw;
+};
+
+enum class TuyaDoorLockCommandType : uint8_t {
+  // The one that I recieved
+
+  PRODUCT_QUERY = 0x01,            // Exactly the same // for me is {"p":"bljvjx2nsv02dhao","v":"3.4.0"}
+  WIFI_STATE = 0x02,               // FROM 0x03 The rest is matched
+  DATAPOINT_REPORT = 0x05,         // From 0x07 and 0x22 // Happen everytime someone try to unlock
+  DATAPOINT_RECORD_REPORT = 0x08,  // FROM 0x34 but nothing seems to match (the protocol is matched, but tuya imeplementation is diffrent) // Happen only when unlock successful
+  // DATAPOINT_DELIVER = 0x05, // REPORT REAL-TIME STATUS
+  // DATAPOINT_QUERY = 0x08, // REPORT STATUS OF RECORD TYPE
+  LOCAL_TIME_QUERY = 0x06,  // FROM 0x1C The rest is matched
+  GMT_TIME_QUERY = 0x10,    // FROM 0x0c The rest is matched # BUT esphome only implement local time so..
+  REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE = 0x13,
+  VERIFY_DYNAMIC_PASSWORD = 0x12,  // 8 digits totp
+  MODULE_SEND_COMMAND = 0x09,
+
+  // Below is what they said on the table which seems totally wrong
+
+  WIFI_RESET = 0x03,
+  WIFI_SELECT = 0x04,
+  WIFI_TEST = 0x07,
+  REQUEST_WIFI_MODULE_FW_UPDATE = 0x0A,
+  WIFI_RSSI = 0x0B,
+  REQUEST_MCU_FW_UPDATE = 0x0c,
+  START_UPDATE = 0x0D,
+  TRANSMIT_UPDATE_PACKAGE = 0x0E,
+  REQUEST_TEMP_PASSWD_CLOUD_SINGLE = 0x11,
+  REQUEST_TEMP_PASSWD_CLOUD_SCHEDULE = 0x14,
+  GET_DP_CACHE_COMMAND = 0x15,
+  OFFLINE_DYNAMIC_PASSWORD = 0x16,
+  REPORT_SERIAL_NUMBER_MCU = 0x17,
+  POSITIONAL_NOTATION = 0x1C,
+  AUTOMATIC_UPDATE = 0x21,
+  NOTIFY_MODULE_RESET = 0x25,
+  WIFI_TEST_2 = 0xF0,
+};
+
+// Frame layout: 55 AA VERSION COMMAND LEN_HI LEN_LO DATA... CHECKSUM
+static const size_t FRAME_HEADER_SIZE = 6;
+static const size_t FRAME_OVERHEAD = FRAME_HEADER_SIZE + 1;
+
+// A complete frame, data points into the parser buffer and is valid until the next byte is fed
+struct TuyaDoorLockFrame {
+  uint8_t version;
+  uint8_t command;
+  const uint8_t *data;
+  size_t len;
+};
+
+enum class TuyaDoorLockParseResult : uint8_t {
+  INCOMPLETE,    // byte accepted, frame not complete yet
+  FRAME,         // byte completed a frame with a valid checksum
+  BAD_HEADER,    // byte cannot start or continue a frame, parser was reset (a 0x55 starts the next frame)
+  BAD_CHECKSUM,  // frame complete but checksum mismatched, parser was reset
+};
+
+// Byte at a time frame parser with a running checksum
+class TuyaDoorLockFrameParser {
+ public:
+  TuyaDoorLockParseResult feed(uint8_t c);
+  TuyaDoorLockFrame get_frame() const;
+  // Checksums of the last BAD_CHECKSUM frame
+  uint8_t get_received_checksum() const { return this->received_checksum_; }
+  uint8_t get_calculated_checksum() const { return this->calculated_checksum_; }
+  // No frame started, or the last one is complete
+  bool is_idle() const { return this->buffer_.empty() || this->complete_; }
+  void reset();
+
+ protected:
+  std::vector<uint8_t> buffer_;
+  uint16_t length_{0};
+  uint8_t checksum_{0};
+  uint8_t received_checksum_{0};
+  uint8_t calculated_checksum_{0};
+  bool complete_{false};
+};
+
+// Appends a complete frame to out
+void encode_frame(uint8_t version, uint8_t command, const uint8_t *payload, size_t len, std::vector<uint8_t> &out);
+
+enum class TuyaDoorLockDecodeResult : uint8_t {
+  OK,
+  TRUNCATED,     // record header or value runs past the buffer
+  BAD_LENGTH,    // value length does not match the type
+  UNKNOWN_TYPE,
+};
+
+// Decodes the datapoint record at the start of buffer, consumed is set to the record size
+TuyaDoorLockDecodeResult decode_datapoint(const uint8_t *buffer, size_t len, TuyaDoorLockDatapoint &datapoint,
+                                          size_t &consumed);
+// Seconds since 1970-01-01 of a calendar date and time, no time zone is applied
+int64_t civil_to_seconds(int year, int month, int day, int hour, int minute, int second);
+// FNV-1a over the command byte and the payload, identifies retransmitted frames
+uint32_t hash_frame(const TuyaDoorLockFrame &frame);
+// FNV-1a over the value, numeric values hash as their 4 value bytes
+uint32_t hash_datapoint_value(const TuyaDoorLockDatapoint &datapoint);
+// Same type and value, ids are not compared
+bool datapoint_value_equals(const TuyaDoorLockDatapoint &a, const TuyaDoorLockDatapoint &b);
+// Appends a datapoint record (id, type, length, value) to out
+void encode_datapoint(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, const uint8_t *data, size_t len,
+                      std::vector<uint8_t> &out);
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
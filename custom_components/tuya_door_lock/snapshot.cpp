@@ -0,0 +1,96 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace tuya_door_lock {
+
+// state_ layout: bits 0-7 datapoint count, then the flags
+static const uint32_t STATE_INITIALIZED = 1u << 8;
+static const uint32_t STATE_DEGRADED = 1u << 9;
+static const uint32_t STATE_TRUNCATED = 1u << 10;
+
+void TuyaDoorLockStateSnapshot::publish(const std::vector<TuyaDoorLockDatapoint> &datapoints, uint32_t frame_count,
+                                        uint32_t sequence, bool initialized, bool degraded) {
+  const size_t count = std::min(datapoints.size(), TuyaDoorLockSnapshot::MAX_DATAPOINTS);
+  uint32_t state = count;
+  if (initialized)
+    state |= STATE_INITIALIZED;
+  if (degraded)
+    state |= STATE_DEGRADED;
+  if (datapoints.size() > count)
+    state |= STATE_TRUNCATED;
+
+  // An odd sequence tells readers a publish is in progress
+  const uint32_t seqlock = this->sequence_.load(std::memory_order_relaxed);
+  this->sequence_.store(seqlock + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  this->frame_count_.store(frame_count, std::memory_order_relaxed);
+  this->journal_sequence_.store(sequence, std::memory_order_relaxed);
+  this->state_.store(state, std::memory_order_relaxed);
+  for (size_t i = 0; i < count; i++) {
+    const TuyaDoorLockDatapoint &datapoint = datapoints[i];
+    uint8_t head[8] = {};
+    size_t len = datapoint.len;
+    uint32_t value = 0;
+    if (datapoint.type == TuyaDoorLockDatapointType::RAW) {
+      len = datapoint.value_raw.size();
+      memcpy(head, datapoint.value_raw.data(), std::min(len, sizeof(head)));
+    } else if (datapoint.type == TuyaDoorLockDatapointType::STRING) {
+      len = datapoint.value_string.size();
+      memcpy(head, datapoint.value_string.data(), std::min(len, sizeof(head)));
+    } else {
+      value = datapoint.value_uint;
+    }
+    std::atomic<uint32_t> *words = &this->words_[i * WORDS_PER_DATAPOINT];
+    words[0].store(datapoint.id | (uint32_t(datapoint.type) << 8) | (uint32_t(std::min<size_t>(len, 0xFFFF)) << 16),
+                   std::memory_order_relaxed);
+    words[1].store(value, std::memory_order_relaxed);
+    uint32_t word;
+    memcpy(&word, head, sizeof(word));
+    words[2].store(word, std::memory_order_relaxed);
+    memcpy(&word, head + 4, sizeof(word));
+    words[3].store(word, std::memory_order_relaxed);
+  }
+
+  this->sequence_.store(seqlock + 2, std::memory_order_release);
+}
+
+bool TuyaDoorLockStateSnapshot::read(TuyaDoorLockSnapshot &out, uint8_t attempts) const {
+  while (attempts-- > 0) {
+    const uint32_t before = this->sequence_.load(std::memory_order_acquire);
+    if (before & 1)
+      continue;
+
+    out.frame_count = this->frame_count_.load(std::memory_order_relaxed);
+    out.sequence = this->journal_sequence_.load(std::memory_order_relaxed);
+    const uint32_t state = this->state_.load(std::memory_order_relaxed);
+    out.count = std::min<size_t>(state & 0xFF, TuyaDoorLockSnapshot::MAX_DATAPOINTS);
+    out.initialized = state & STATE_INITIALIZED;
+    out.degraded = state & STATE_DEGRADED;
+    out.truncated = state & STATE_TRUNCATED;
+    for (size_t i = 0; i < out.count; i++) {
+      const std::atomic<uint32_t> *words = &this->words_[i * WORDS_PER_DATAPOINT];
+      const uint32_t header = words[0].load(std::memory_order_relaxed);
+      TuyaDoorLockSnapshotDatapoint &datapoint = out.datapoints[i];
+      datapoint.id = header & 0xFF;
+      datapoint.type = TuyaDoorLockDatapointType((header >> 8) & 0xFF);
+      datapoint.len = header >> 16;
+      datapoint.value = words[1].load(std::memory_order_relaxed);
+      const uint32_t head_lo = words[2].load(std::memory_order_relaxed);
+      const uint32_t head_hi = words[3].load(std::memory_order_relaxed);
+      memcpy(datapoint.head, &head_lo, sizeof(head_lo));
+      memcpy(datapoint.head + 4, &head_hi, sizeof(head_hi));
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (this->sequence_.load(std::memory_order_relaxed) == before)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
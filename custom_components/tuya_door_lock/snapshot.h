@@ -0,0 +1,54 @@
+#pragma once
+
+// Compact copy of the lock state that any task can read without locks while loop() keeps updating it.
+// Kept free of ESPHome includes, like protocol.h.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "protocol.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+
+struct TuyaDoorLockSnapshotDatapoint {
+  uint8_t id;
+  TuyaDoorLockDatapointType type;
+  uint16_t len;
+  uint32_t value;   // numeric types
+  uint8_t head[8];  // first bytes of RAW and STRING values
+};
+
+struct TuyaDoorLockSnapshot {
+  static const size_t MAX_DATAPOINTS = 32;
+  uint32_t frame_count;  // frames received when the snapshot was published
+  uint32_t sequence;     // journal sequence of the last change included, to resume from with read_changes_since()
+  bool initialized;
+  bool degraded;
+  bool truncated;  // the lock knows more than MAX_DATAPOINTS datapoints
+  uint8_t count;
+  TuyaDoorLockSnapshotDatapoint datapoints[MAX_DATAPOINTS];
+};
+
+// Seqlock over atomic words: the single writer never waits, readers retry when a publish overlapped their copy
+class TuyaDoorLockStateSnapshot {
+ public:
+  // Writer side, loop() only
+  void publish(const std::vector<TuyaDoorLockDatapoint> &datapoints, uint32_t frame_count, uint32_t sequence,
+               bool initialized, bool degraded);
+  // Any task, false when every attempt overlapped a publish
+  bool read(TuyaDoorLockSnapshot &out, uint8_t attempts = 8) const;
+
+ protected:
+  static const size_t WORDS_PER_DATAPOINT = 4;
+  std::atomic<uint32_t> sequence_{0};
+  std::atomic<uint32_t> frame_count_{0};
+  std::atomic<uint32_t> journal_sequence_{0};
+  std::atomic<uint32_t> state_{0};
+  std::atomic<uint32_t> words_[TuyaDoorLockSnapshot::MAX_DATAPOINTS * WORDS_PER_DATAPOINT]{};
+};
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
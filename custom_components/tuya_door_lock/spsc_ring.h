@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace esphome {
+namespace tuya_door_lock {
+
+// Lock-free ring between exactly one producer and one consumer task. Slots are filled and read in place: the
+// producer writes into write_slot() and publishes it with push(), the consumer reads front() and frees it with pop().
+template<typename T, size_t N> class TuyaDoorLockSpscRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+ public:
+  // Free slot for the producer, nullptr when the ring is full
+  T *write_slot() {
+    const size_t head = this->head_.load(std::memory_order_relaxed);
+    if (head - this->tail_.load(std::memory_order_acquire) == N)
+      return nullptr;
+    return &this->slots_[head & (N - 1)];
+  }
+  void push() { this->head_.store(this->head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Oldest published slot for the consumer, nullptr when the ring is empty
+  T *front() {
+    const size_t tail = this->tail_.load(std::memory_order_relaxed);
+    if (this->head_.load(std::memory_order_acquire) == tail)
+      return nullptr;
+    return &this->slots_[tail & (N - 1)];
+  }
+  void pop() { this->tail_.store(this->tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+ protected:
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  T slots_[N];
+};
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
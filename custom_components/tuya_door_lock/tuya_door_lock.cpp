@@ -15,52 +15,314 @@
 #include "esphome/components/captive_portal/captive_portal.h"
 #endif
 
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
 namespace esphome {
 namespace tuya_door_lock {
 
 static const char *const TAG = "tuya_door_lock";
-static const int COMMAND_DELAY = 10;
-static const int RECEIVE_TIMEOUT = 300;
-static const int MAX_RETRIES = 5;
+// Lower bound of an adaptive response timeout, whatever the measured round trip time
+static const uint32_t MIN_RECEIVE_TIMEOUT = 50;
+static const uint32_t RETRY_BACKOFF_BASE = 50;
+static const uint32_t RETRY_BACKOFF_MAX = 5000;
+static const uint32_t RECOVERY_BACKOFF_MIN = 10000;
+static const uint32_t RECOVERY_BACKOFF_MAX = 600000;
+// After the Tuya module is enabled, report the cloud connection at these delays
+static const uint32_t WAKE_REPORT_DELAYS[] = {1250, 3000};
+// Shortest span between two clock samples used for the MCU clock drift
+static const uint32_t CLOCK_DRIFT_MIN_SPAN = 3600000;
+// First byte of a record report, which clock its timestamp was read from
+static const uint8_t RECORD_TIME_NONE = 0x00;
+static const uint8_t RECORD_TIME_LOCAL = 0x01;
+static const uint8_t RECORD_TIME_GMT = 0x02;
+// Bytes read from a UART in one go
+static const size_t RX_CHUNK_SIZE = 64;
+// Bytes we allow to sit in the UART TX FIFO, so write_array() never has to wait for room
+static const size_t TX_FIFO_SIZE = 128;
+
+// RX task: stack size, priority (above the main loop task) and how long it sleeps when the UART is empty
+static const uint32_t RX_TASK_STACK_SIZE = 3072;
+static const uint32_t RX_TASK_PRIORITY = 5;
+static const uint32_t RX_TASK_IDLE_TICKS = 1;
+// Bytes all locks together may start sending in one main loop iteration
+static const size_t TX_BUDGET_PER_LOOP = TX_FIFO_SIZE;
+
+static std::vector<TuyaDoorLockSharedKey> shared_totp_keys;  // NOLINT
+
+TuyaDoorLockTxScheduler *TuyaDoorLockTxScheduler::get_instance() {
+  static TuyaDoorLockTxScheduler *instance = nullptr;
+  if (instance == nullptr)
+    instance = new TuyaDoorLockTxScheduler();  // NOLINT
+  return instance;
+}
+
+size_t TuyaDoorLockTxScheduler::add_lock() {
+  this->slots_.push_back(Slot{.waiting = false, .overdue = false});
+  return this->slots_.size() - 1;
+}
+
+void TuyaDoorLockTxScheduler::loop() {
+  this->budget_ = TX_BUDGET_PER_LOOP;
+  this->overdue_count_ = 0;
+  for (auto &slot : this->slots_) {
+    slot.overdue = slot.waiting;
+    slot.waiting = false;
+    if (slot.overdue)
+      this->overdue_count_++;
+  }
+}
+
+bool TuyaDoorLockTxScheduler::acquire(size_t slot, size_t len) {
+  // A single lock has the line timing to itself
+  if (this->slots_.size() <= 1)
+    return true;
+  Slot &s = this->slots_[slot];
+  const bool first = this->budget_ == TX_BUDGET_PER_LOOP;
+  if ((!first && len > this->budget_) || (!s.overdue && this->overdue_count_ > 0)) {
+    if (!s.waiting)
+      this->deferred_count_++;
+    s.waiting = true;
+    return false;
+  }
+  this->budget_ -= std::min(len, this->budget_);
+  if (s.overdue) {
+    s.overdue = false;
+    this->overdue_count_--;
+  }
+  return true;
+}
+
+void TuyaDoorLockTxScheduler::dump_config() {
+  ESP_LOGCONFIG(TAG, "TuyaDoorLock TX Scheduler:");
+  ESP_LOGCONFIG(TAG, "  Locks: %zu, budget: %zu bytes per loop, deferred frames: %" PRIu32, this->slots_.size(),
+                TX_BUDGET_PER_LOOP, this->deferred_count_);
+}
+
+TuyaDoorLock::TuyaDoorLock() {
+  // Components are created by the main task, the one running loop()
+#ifdef USE_ESP32
+  this->loop_task_ = xTaskGetCurrentTaskHandle();
+#elif defined(USE_HOST)
+  this->loop_thread_ = std::this_thread::get_id();
+#endif
+  this->register_builtin_handler_(TuyaDoorLockCommandType::PRODUCT_QUERY, &TuyaDoorLock::handle_product_query_, true);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::WIFI_STATE, &TuyaDoorLock::handle_wifi_state_, false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::WIFI_RESET, &TuyaDoorLock::handle_unsupported_command_,
+                                  false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::WIFI_SELECT, &TuyaDoorLock::handle_unsupported_command_,
+                                  false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::DATAPOINT_REPORT, &TuyaDoorLock::handle_datapoint_report_,
+                                  false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT,
+                                  &TuyaDoorLock::handle_datapoint_record_report_, false);
+  // Only ever sent by us
+  this->register_command_handler(static_cast<uint8_t>(TuyaDoorLockCommandType::MODULE_SEND_COMMAND), nullptr, false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::WIFI_TEST, &TuyaDoorLock::handle_wifi_test_, false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::WIFI_RSSI, &TuyaDoorLock::handle_wifi_rssi_, false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE,
+                                  &TuyaDoorLock::handle_temp_password_multiple_, false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD,
+                                  &TuyaDoorLock::handle_verify_dynamic_password_, false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::LOCAL_TIME_QUERY, &TuyaDoorLock::handle_local_time_query_,
+                                  false);
+  this->register_builtin_handler_(TuyaDoorLockCommandType::GMT_TIME_QUERY, &TuyaDoorLock::handle_gmt_time_query_,
+                                  false);
+}
 
 void TuyaDoorLock::setup() {
-  this->send_empty_command_(TuyaDoorLockCommandType::PRODUCT_QUERY);
+  if (this->capture_size_ > 0) {
+    this->capture_ = new TuyaDoorLockCaptureEntry[this->capture_size_];  // NOLINT
+  }
+  this->journal_.setup();
+  this->tx_slot_ = TuyaDoorLockTxScheduler::get_instance()->add_lock();
+#ifdef USE_ESP32
+  if (this->rx_task_core_ >= 0) {
+    this->rx_ring_ = new TuyaDoorLockSpscRing<TuyaDoorLockRxFrame, RX_RING_SIZE>();  // NOLINT
+    if (xTaskCreatePinnedToCore(TuyaDoorLock::rx_task_entry_, "tuya_door_lock_rx", RX_TASK_STACK_SIZE, this,
+                                RX_TASK_PRIORITY, nullptr, this->rx_task_core_) != pdPASS) {
+      ESP_LOGE(TAG, "Could not start the RX task, reading the UART from loop()");
+      delete this->rx_ring_;
+      this->rx_ring_ = nullptr;
+    }
+  }
+#endif
+  if (this->en_binary_sensor_ != nullptr) {
+    this->en_binary_sensor_->add_on_state_callback([this](bool state) {
+      if (state && this->init_state_ == TuyaDoorLockInitState::INIT_DONE)
+        this->start_wake_();
+    });
+  }
+  if (this->is_passthrough()) {
+    // Bytes are forwarded from loop(), at the default 16ms loop interval that alone would delay them by up to 16ms
+    this->passthrough_high_freq_.start();
+    // The module runs its own handshake, init_state follows the MCU's answers to it as they are decoded
+  } else {
+    this->send_empty_command_(TuyaDoorLockCommandType::PRODUCT_QUERY);
+  }
   this->parse_totp_key();
   ESP_LOGD(TAG, "Finished setup");
 }
 
 void TuyaDoorLock::loop() {
-  if ((this->init_state_ == TuyaDoorLockInitState::INIT_DONE) && (this->en_binary_sensor_ != nullptr)) {
-    const bool is_enable = this->en_binary_sensor_->state;
-    if (is_enable) {
-      if (!this->has_sent_wifi_status) {
-        ESP_LOGD(TAG, "Tuya module enabled, reporting cloud connection in 1.25s, 3s");
-        this->set_timeout("handle_wake_1.25s", 1250, [this] {
-          this->send_command_(
-              TuyaDoorLockCommand{
-                  .cmd = TuyaDoorLockCommandType::WIFI_STATE,
-                  .payload = std::vector<uint8_t>{0x04}  // Connected with Tuya Cloud
-              });
-        });
-        this->set_timeout("handle_wake_3s", 3000, [this] {
-          this->send_command_(
-              TuyaDoorLockCommand{
-                  .cmd = TuyaDoorLockCommandType::WIFI_STATE,
-                  .payload = std::vector<uint8_t>{0x04}  // Connected with Tuya Cloud
-              });
-        });
-        this->has_sent_wifi_status = true;
+  this->run_sequences_();
+  // Notice a drained frame before reading, so a fast reply is not mistaken for the MCU talking over it
+  this->flush_tx_();
+  if (this->has_rx_task()) {
+    this->dispatch_rx_frames_();
+  } else {
+    this->read_mcu_();
+  }
+  if (this->is_passthrough())
+    this->forward_module_();
+  this->flush_throttled_datapoints_();
+  this->apply_writes_();
+  process_command_queue_();
+}
+
+void TuyaDoorLock::read_mcu_() {
+  uint8_t chunk[RX_CHUNK_SIZE];
+  int available;
+  while ((available = this->available()) > 0) {
+    const size_t len = std::min<size_t>(available, sizeof(chunk));
+    if (!this->read_array(chunk, len))
+      return;
+    // Forward before decoding, so decoding never adds latency on the module side
+    if (this->passthrough_uart_ != nullptr)
+      this->passthrough_uart_->write_array(chunk, len);
+    const uint32_t now = this->now_us_();
+    this->last_rx_us_ = now;
+    for (size_t i = 0; i < len; i++) {
+      this->capture_byte_(TuyaDoorLockCaptureDirection::RX, now, chunk[i]);
+      this->handle_char_(chunk[i]);
+    }
+  }
+}
+
+#ifdef USE_ESP32
+void TuyaDoorLock::rx_task_entry_(void *arg) { static_cast<TuyaDoorLock *>(arg)->rx_task_loop_(); }
+
+void TuyaDoorLock::rx_task_loop_() {
+  while (true) {
+    if (!this->rx_task_poll_())
+      vTaskDelay(RX_TASK_IDLE_TICKS);
+  }
+}
+#endif
+
+bool TuyaDoorLock::rx_task_poll_() {
+  uint8_t chunk[RX_CHUNK_SIZE];
+  const int available = this->available();
+  if (available <= 0) {
+    if (!this->rx_parser_.is_idle() && this->now_ms_() - this->rx_task_last_byte_ms_ > this->receive_timeout_) {
+      this->rx_parser_.reset();
+      this->rx_task_in_frame_.store(false, std::memory_order_relaxed);
+    }
+    return false;
+  }
+  const size_t len = std::min<size_t>(available, sizeof(chunk));
+  if (!this->read_array(chunk, len))
+    return false;
+  const uint32_t now = this->now_us_();
+  this->rx_task_last_byte_ms_ = this->now_ms_();
+  this->last_rx_us_.store(now, std::memory_order_relaxed);
+  this->rx_byte_count_.fetch_add(len, std::memory_order_relaxed);
+  for (size_t i = 0; i < len; i++) {
+    switch (this->rx_parser_.feed(chunk[i])) {
+      case TuyaDoorLockParseResult::INCOMPLETE:
+      case TuyaDoorLockParseResult::BAD_HEADER:
+        break;
+      case TuyaDoorLockParseResult::BAD_CHECKSUM:
+        this->rx_bad_frames_.fetch_add(1, std::memory_order_relaxed);
+        break;
+      case TuyaDoorLockParseResult::FRAME: {
+        const TuyaDoorLockFrame frame = this->rx_parser_.get_frame();
+        TuyaDoorLockRxFrame *slot = this->rx_ring_->write_slot();
+        if (slot == nullptr || frame.len + FRAME_OVERHEAD > TuyaDoorLockRxFrame::MAX_SIZE) {
+          this->rx_dropped_frames_.fetch_add(1, std::memory_order_relaxed);
+          break;
+        }
+        const uint8_t header[FRAME_HEADER_SIZE] = {0x55, 0xAA, frame.version, frame.command,
+                                                   (uint8_t)(frame.len >> 8), (uint8_t)(frame.len & 0xFF)};
+        memcpy(slot->raw, header, FRAME_HEADER_SIZE);
+        memcpy(slot->raw + FRAME_HEADER_SIZE, frame.data, frame.len);
+        slot->raw[FRAME_HEADER_SIZE + frame.len] = this->rx_parser_.get_received_checksum();
+        slot->len = frame.len + FRAME_OVERHEAD;
+        slot->arrival_us = now;
+        this->rx_ring_->push();
+        break;
       }
-    } else {
-      this->has_sent_wifi_status = false;
     }
   }
-  while (this->available()) {
-    uint8_t c;
-    this->read_byte(&c);
-    this->handle_char_(c);
+  this->rx_task_in_frame_.store(!this->rx_parser_.is_idle(), std::memory_order_relaxed);
+  return true;
+}
+
+void TuyaDoorLock::dispatch_rx_frames_() {
+  TuyaDoorLockRxFrame *slot;
+  while ((slot = this->rx_ring_->front()) != nullptr) {
+    const uint32_t latency = this->now_us_() - slot->arrival_us;
+    size_t bucket = 0;
+    while (bucket < RX_LATENCY_BUCKETS - 1 && (latency >> bucket) != 0)
+      bucket++;
+    this->rx_latency_hist_[bucket]++;
+    // Only bytes of valid frames reach loop(), captured with the time their frame was read
+    for (size_t i = 0; i < slot->len; i++)
+      this->capture_byte_(TuyaDoorLockCaptureDirection::RX, slot->arrival_us, slot->raw[i]);
+    this->handle_frame_(TuyaDoorLockFrame{
+        .version = slot->raw[2],
+        .command = slot->raw[3],
+        .data = slot->raw + FRAME_HEADER_SIZE,
+        .len = slot->len - FRAME_OVERHEAD,
+    });
+    this->rx_ring_->pop();
+  }
+}
+
+uint32_t TuyaDoorLock::get_rx_latency_p99_us() const {
+  uint32_t total = 0;
+  for (uint32_t count : this->rx_latency_hist_)
+    total += count;
+  if (total == 0)
+    return 0;
+  const uint32_t target = total - total / 100;
+  uint32_t seen = 0;
+  for (size_t i = 0; i < RX_LATENCY_BUCKETS; i++) {
+    seen += this->rx_latency_hist_[i];
+    if (seen >= target)
+      return 1u << i;
+  }
+  return 1u << (RX_LATENCY_BUCKETS - 1);
+}
+
+void TuyaDoorLock::forward_module_() {
+  uint8_t chunk[RX_CHUNK_SIZE];
+  int available;
+  while ((available = this->passthrough_uart_->available()) > 0) {
+    const size_t len = std::min<size_t>(available, sizeof(chunk));
+    if (!this->passthrough_uart_->read_array(chunk, len))
+      return;
+    this->write_array(chunk, len);
+    const uint32_t now = this->now_us_();
+    for (size_t i = 0; i < len; i++) {
+      this->capture_byte_(TuyaDoorLockCaptureDirection::TX, now, chunk[i]);
+      if (this->module_parser_.feed(chunk[i]) == TuyaDoorLockParseResult::FRAME)
+        this->handle_module_frame_(this->module_parser_.get_frame());
+    }
+  }
+}
+
+void TuyaDoorLock::handle_module_frame_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGV(TAG, "Module sent TuyaDoorLock: CMD=0x%02X VERSION=%u DATA=[%s]", frame.command, frame.version,
+           format_hex_pretty(frame.data, frame.len).c_str());
+  // Datapoints set by the cloud through the original module
+  if ((TuyaDoorLockCommandType)frame.command == TuyaDoorLockCommandType::MODULE_SEND_COMMAND) {
+    this->handle_datapoints_(frame.data, frame.len);
+    this->snapshot_.publish(this->datapoints_, this->rx_frame_count_, this->journal_.get_sequence(),
+                            this->init_state_ == TuyaDoorLockInitState::INIT_DONE, this->is_degraded());
   }
-  process_command_queue_();
 }
 
 void TuyaDoorLock::dump_config() {
@@ -89,325 +351,427 @@ void TuyaDoorLock::dump_config() {
   LOG_PIN("  Status Pin: ", this->status_pin_);
   LOG_BINARY_SENSOR("", "  EN Sensor: ", this->en_binary_sensor_);
   ESP_LOGCONFIG(TAG, "  Product: '%s'", this->product_.c_str());
+  if (this->is_passthrough()) {
+    ESP_LOGCONFIG(TAG, "  Passthrough to the original Tuya module: enabled");
+  }
+  if (this->is_degraded() || this->recovery_attempts_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Initialization: %s, %" PRIu32 " recovery attempts, degraded for %" PRIu32 "s",
+                  this->is_degraded() ? "FAILED" : "recovered", this->recovery_attempts_, this->get_degraded_time() / 1000);
+  }
+  ESP_LOGCONFIG(TAG, "  Max UART write blocking: %" PRIu32 "us", this->tx_max_blocking_us_);
+  ESP_LOGCONFIG(TAG, "  Receive timeout: %" PRIu32 "ms, command delay: %" PRIu32 "ms, max retries: %u",
+                this->receive_timeout_, this->command_delay_, this->max_retries_);
+  ESP_LOGCONFIG(TAG, "  Retransmit window: %" PRIu32 "ms, retransmitted reports dropped: %" PRIu32,
+                this->retransmit_window_, this->retransmit_count_);
+  ESP_LOGCONFIG(TAG, "  Line idle: %u bytes (%" PRIu32 "us)", this->line_idle_bytes_,
+                this->line_idle_bytes_ * this->byte_time_us_());
+  if (this->rx_frame_count_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Frames received: %" PRIu32 " (%" PRIu32 " bytes), %" PRIu32 "ns/frame, max %" PRIu32 "us",
+                  this->rx_frame_count_, this->rx_byte_count_.load(),
+                  (uint32_t)(this->rx_frame_total_us_ * 1000 / this->rx_frame_count_), this->rx_frame_max_us_);
+  }
+  if (this->has_rx_task()) {
+    ESP_LOGCONFIG(TAG, "  RX task: core %d, dispatch p99 <%" PRIu32 "us, dropped frames: %" PRIu32 ", bad frames: %" PRIu32,
+                  this->rx_task_core_, this->get_rx_latency_p99_us(), this->rx_dropped_frames_.load(),
+                  this->rx_bad_frames_.load());
+  }
+  for (auto &filter : this->datapoint_filters_) {
+    ESP_LOGCONFIG(TAG, "  Datapoint %u filter: drop unchanged %s, deadband %" PRIu32 ", min interval %" PRIu32 "ms",
+                  filter.datapoint_id, YESNO(filter.drop_unchanged), filter.deadband, filter.min_interval);
+  }
+  if (!this->datapoint_filters_.empty()) {
+    ESP_LOGCONFIG(TAG, "  Suppressed reports: %" PRIu32 " unchanged, %" PRIu32 " within deadband, %" PRIu32 " throttled",
+                  this->unchanged_drop_count_, this->deadband_drop_count_, this->throttled_count_);
+  }
+#ifdef USE_TIME
+  if (this->time_id_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  MCU clock: %+" PRId32 "s off, drift %" PRId32 "ppm, pushed at wake %" PRIu32 " times",
+                  this->clock_offset_, this->clock_drift_ppm_, this->time_push_count_);
+  }
+#endif
+  ESP_LOGCONFIG(TAG, "  Capture buffer: %zu/%zu bytes recorded", this->capture_count_, this->capture_size_);
+  ESP_LOGCONFIG(TAG, "  Change journal: %zu entries, sequence %" PRIu32, this->journal_.get_size(),
+                this->journal_.get_sequence());
+  ESP_LOGCONFIG(TAG, "  Command handlers: %zu, unknown commands received: %" PRIu32, this->command_entries_.size(),
+                this->unknown_command_count_);
+  ESP_LOGCONFIG(TAG, "  Frames sent: %" PRIu32 ", collisions: %" PRIu32 ", retries: %" PRIu32, this->tx_frame_count_,
+                this->collision_count_, this->retry_count_);
+  for (auto &stats : this->rtt_stats_) {
+    ESP_LOGCONFIG(TAG, "  Command 0x%02X: %u RTT samples, response timeout %" PRIu32 "ms",
+                  static_cast<uint8_t>(stats.cmd), stats.count, this->get_response_timeout_(stats.cmd));
+  }
   if (this->totp_key_length_ > 0) {
     ESP_LOGCONFIG(TAG, "  totp: enabled");
   } else {
     ESP_LOGCONFIG(TAG, "  totp: disabled");
     this->parse_totp_key();  // I leave it here in case someone else needs to know why the tot parsing failed
   }
+  ESP_LOGCONFIG(TAG, "  RAM usage: %zu bytes", this->get_ram_usage());
 }
 
-bool TuyaDoorLock::validate_message_() {
-  uint32_t at = this->rx_message_.size() - 1;
-  auto *data = &this->rx_message_[0];
-  uint8_t new_byte = data[at];
-
-  // Byte 0: HEADER1 (always 0x55)
-  if (at == 0)
-    return new_byte == 0x55;
-  // Byte 1: HEADER2 (always 0xAA)
-  if (at == 1)
-    return new_byte == 0xAA;
+size_t TuyaDoorLock::get_ram_usage() const {
+  size_t usage = sizeof(*this);
+  usage += this->capture_size_ * sizeof(TuyaDoorLockCaptureEntry);
+  usage += this->journal_.get_size() * sizeof(TuyaDoorLockJournalEntry);
+  usage += this->tx_buffer_.capacity();
+  if (this->has_rx_task())
+    usage += sizeof(*this->rx_ring_);
+  usage += this->rtt_stats_.capacity() * sizeof(TuyaDoorLockRttStats);
+  usage += this->listeners_.capacity() * sizeof(TuyaDoorLockDatapointListener);
+  usage += this->ignore_mcu_update_on_datapoints_.capacity();
+  usage += this->datapoint_filters_.capacity() * sizeof(TuyaDoorLockDatapointFilter);
+  usage += this->product_.capacity();
+  usage += this->datapoints_.capacity() * sizeof(TuyaDoorLockDatapoint);
+  for (auto &datapoint : this->datapoints_)
+    usage += datapoint.value_raw.capacity() + datapoint.value_string.capacity();
+  usage += this->command_queue_.capacity() * sizeof(TuyaDoorLockCommand);
+  for (auto &command : this->command_queue_)
+    usage += command.payload.capacity();
+  usage += this->pending_responses_.capacity() * sizeof(TuyaDoorLockPendingResponse);
+  for (auto &pending : this->pending_responses_)
+    usage += pending.command.payload.capacity();
+  return usage;
+}
 
-  // Byte 2: VERSION
-  // no validation for the following fields:
-  uint8_t version = data[2];
-  if (at == 2)
-    return true;
-  // Byte 3: COMMAND
-  uint8_t command = data[3];
-  if (at == 3)
-    return true;
+void TuyaDoorLock::handle_char_(uint8_t c) {
+  this->rx_byte_count_++;
+  switch (this->rx_parser_.feed(c)) {
+    case TuyaDoorLockParseResult::INCOMPLETE:
+    case TuyaDoorLockParseResult::BAD_HEADER:
+      this->last_rx_char_timestamp_ = this->now_ms_();
+      break;
+    case TuyaDoorLockParseResult::FRAME:
+      this->handle_frame_(this->rx_parser_.get_frame());
+      break;
+    case TuyaDoorLockParseResult::BAD_CHECKSUM:
+      ESP_LOGW(TAG, "TuyaDoorLock Received invalid message checksum %02X!=%02X",
+               this->rx_parser_.get_received_checksum(), this->rx_parser_.get_calculated_checksum());
+      break;
+  }
+}
 
-  // Byte 4: LENGTH1
-  // Byte 5: LENGTH2
-  if (at <= 5) {
-    // no validation for these fields
-    return true;
+void TuyaDoorLock::handle_frame_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGV(TAG, "Received TuyaDoorLock: CMD=0x%02X VERSION=%u DATA=[%s] INIT_STATE=%u", frame.command, frame.version,
+           format_hex_pretty(frame.data, frame.len).c_str(), static_cast<uint8_t>(this->init_state_));
+  const uint32_t start = this->now_us_();
+  this->handle_command_(frame.command, frame.version, frame.data, frame.len);
+  const uint32_t elapsed = this->now_us_() - start;
+  this->rx_frame_count_++;
+  this->rx_frame_total_us_ += elapsed;
+  if (elapsed > this->rx_frame_max_us_)
+    this->rx_frame_max_us_ = elapsed;
+  this->snapshot_.publish(this->datapoints_, this->rx_frame_count_, this->journal_.get_sequence(),
+                          this->init_state_ == TuyaDoorLockInitState::INIT_DONE, this->is_degraded());
+
+  for (auto &sequence : this->sequences_) {
+    if (sequence.started && sequence.awaiting_response && static_cast<uint8_t>(sequence.response_command) == frame.command)
+      this->resume_sequence_(sequence, TuyaDoorLockResume::RESPONSE, &frame);
   }
+}
 
-  uint16_t length = (uint16_t(data[4]) << 8) | (uint16_t(data[5]));
+void TuyaDoorLock::handle_command_(uint8_t command, uint8_t version, const uint8_t *buffer, size_t len) {
+  TuyaDoorLockCommandType command_type = (TuyaDoorLockCommandType)command;
 
-  // wait until all data is read
-  if (at - 6 < length)
-    return true;
+  // Any valid frame means the MCU is alive again, but a chatty MCU that ignores our query is not probed before the
+  // backoff ran out
+  if (this->init_failed_ && command_type != TuyaDoorLockCommandType::PRODUCT_QUERY &&
+      this->now_ms_() - this->recovery_from_ >= this->recovery_backoff_)
+    this->start_recovery_("MCU frame received");
 
-  // Byte 6+LEN: CHECKSUM - sum of all bytes (including header) modulo 256
-  uint8_t rx_checksum = new_byte;
-  uint8_t calc_checksum = 0;
-  for (uint32_t i = 0; i < 6 + length; i++)
-    calc_checksum += data[i];
+  for (auto it = this->pending_responses_.begin(); it != this->pending_responses_.end(); ++it) {
+    if (it->command.cmd != command_type)
+      continue;
+    if (it->state == TuyaDoorLockPendingState::AWAITING) {
+      this->record_rtt_(command_type, this->now_ms_() - it->since, len + FRAME_OVERHEAD);
+    } else if (it->state == TuyaDoorLockPendingState::TRANSMITTING) {
+      // Answered before our frame was seen draining, the round trip started when it drained, if it has
+      const int32_t since_drain = this->now_us_() - this->tx_drain_at_;
+      this->record_rtt_(command_type, since_drain > 0 ? since_drain / 1000 : 0, len + FRAME_OVERHEAD);
+    }
+    this->pending_responses_.erase(it);
+    break;
+  }
 
-  if (rx_checksum != calc_checksum) {
-    ESP_LOGW(TAG, "TuyaDoorLock Received invalid message checksum %02X!=%02X", rx_checksum, calc_checksum);
-    return false;
+  const uint16_t index = this->command_index_[command];
+  if (index == 0) {
+    this->unknown_command_count_++;
+    ESP_LOGD(TAG, "Unhandled command (0x%02X) received", command);
+    return;
   }
+  const TuyaDoorLockCommandHandler &handler = this->command_entries_[index - 1].handler;
+  if (handler)
+    handler(TuyaDoorLockFrame{.version = version, .command = command, .data = buffer, .len = len});
+}
 
-  // valid message
-  const uint8_t *message_data = data + 6;
-  ESP_LOGV(TAG, "Received TuyaDoorLock: CMD=0x%02X VERSION=%u DATA=[%s] INIT_STATE=%u", command, version,
-           format_hex_pretty(message_data, length).c_str(), static_cast<uint8_t>(this->init_state_));
-  this->handle_command_(command, version, message_data, length);
+void TuyaDoorLock::register_command_handler(uint8_t command, TuyaDoorLockCommandHandler handler, bool expects_response) {
+  uint16_t &index = this->command_index_[command];
+  if (index == 0) {
+    this->command_entries_.push_back(TuyaDoorLockCommandEntry{});
+    index = this->command_entries_.size();
+  }
+  this->command_entries_[index - 1] = TuyaDoorLockCommandEntry{
+      .handler = std::move(handler),
+      .expects_response = expects_response,
+  };
+}
 
-  // return false to reset rx buffer
-  return false;
+void TuyaDoorLock::register_builtin_handler_(TuyaDoorLockCommandType command,
+                                             void (TuyaDoorLock::*handler)(const TuyaDoorLockFrame &),
+                                             bool expects_response) {
+  this->register_command_handler(
+      static_cast<uint8_t>(command), [this, handler](const TuyaDoorLockFrame &frame) { (this->*handler)(frame); },
+      expects_response);
 }
 
-void TuyaDoorLock::handle_char_(uint8_t c) {
-  this->rx_message_.push_back(c);
-  if (!this->validate_message_()) {
-    this->rx_message_.clear();
+void TuyaDoorLock::handle_product_query_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "PRODUCT_QUERY (0x%02X)", frame.command);
+  // check it is a valid string made up of printable characters
+  bool valid = true;
+  for (size_t i = 0; i < frame.len; i++) {
+    if (!std::isprint(frame.data[i])) {
+      valid = false;
+      break;
+    }
+  }
+  if (valid) {
+    this->product_ = std::string(reinterpret_cast<const char *>(frame.data), frame.len);
   } else {
-    this->last_rx_char_timestamp_ = millis();
+    this->product_ = R"({"p":"INVALID"})";
+  }
+  if (this->init_state_ == TuyaDoorLockInitState::INIT_LISTEN_ENABLE_PIN) {
+    this->init_state_ = TuyaDoorLockInitState::INIT_DONE;
+    // Later wakes start it from the EN callback
+    if (this->en_binary_sensor_ != nullptr && this->en_binary_sensor_->state)
+      this->start_wake_();
+  }
+  if (this->degraded_) {
+    const uint32_t degraded = this->now_ms_() - this->degraded_since_;
+    ESP_LOGI(TAG, "Recovered from failed initialization after %" PRIu32 "s", degraded / 1000);
+    this->degraded_total_ms_ += degraded;
+    this->degraded_ = false;
+    this->init_failed_ = false;
+    this->recovery_backoff_ = 0;
   }
 }
 
-void TuyaDoorLock::handle_command_(uint8_t command, uint8_t version, const uint8_t *buffer, size_t len) {
-  TuyaDoorLockCommandType command_type = (TuyaDoorLockCommandType)command;
+void TuyaDoorLock::handle_wifi_state_(const TuyaDoorLockFrame &) {
+  ESP_LOGD(TAG, "WIFI_STATE handled, expected: 55 AA 00 02 00 00 01");
+}
 
-  if (this->expected_response_.has_value() && this->expected_response_ == command_type) {
-    this->expected_response_.reset();
-    this->command_queue_.erase(command_queue_.begin());
-    this->init_retries_ = 0;
+void TuyaDoorLock::handle_unsupported_command_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGE(TAG, "Command 0x%02X is not handled", frame.command);
+}
+
+void TuyaDoorLock::handle_datapoint_report_(const TuyaDoorLockFrame &frame) {
+  // This case happen every unlock attempt
+  ESP_LOGD(TAG, "DATAPOINT_REPORT (0x%02X)", frame.command);
+  // We can just acknowledge before process, right? This is required for the request remote unlock
+  this->send_command_(
+      TuyaDoorLockCommand{
+          .cmd = TuyaDoorLockCommandType::DATAPOINT_REPORT,
+          .payload = std::vector<uint8_t>{0x00}  // Reporting succeeded
+      });
+  if (this->is_retransmission_(frame))
+    return;
+  this->handle_datapoints_(frame.data, frame.len);
+}
+
+void TuyaDoorLock::handle_datapoint_record_report_(const TuyaDoorLockFrame &frame) {
+  // This case happen every sucessful unlock
+  ESP_LOGD(TAG, "DATAPOINT_RECORD_REPORT (0x%02X)", frame.command);
+  // 02   00      01  01  01  04  00  01 02 00 04 00 00 00 03 0B 04 00 01 01
+  // GMT  YY+2000 MM  DD  HH  MM  SS  .................DATA.................
+  // A resent record still needs its ack, the lost one is why the MCU resent it
+  if (frame.len < 7) {
+    ESP_LOGW(TAG, "DATAPOINT_RECORD_REPORT too short (%zu bytes)", frame.len);
+  } else if (!this->is_retransmission_(frame)) {
+#ifdef USE_TIME
+    this->track_mcu_clock_(frame.data);
+#endif
+    const uint8_t *report_data = frame.data + 7;
+    this->handle_datapoints_(report_data, frame.len - 7);
   }
+  this->send_command_(
+      TuyaDoorLockCommand{
+          .cmd = TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT,
+          .payload = std::vector<uint8_t>{0x00}  // Reporting succeeded
+      });
+}
 
-  switch (command_type) {
-    case TuyaDoorLockCommandType::PRODUCT_QUERY: {
-      ESP_LOGD(TAG, "PRODUCT_QUERY (0x%02X)", command);
-      // check it is a valid string made up of printable characters
-      bool valid = true;
-      for (size_t i = 0; i < len; i++) {
-        if (!std::isprint(buffer[i])) {
-          valid = false;
-          break;
-        }
-      }
-      if (valid) {
-        this->product_ = std::string(reinterpret_cast<const char *>(buffer), len);
-      } else {
-        this->product_ = R"({"p":"INVALID"})";
-      }
-      if (this->init_state_ == TuyaDoorLockInitState::INIT_LISTEN_ENABLE_PIN) {
-        this->init_state_ = TuyaDoorLockInitState::INIT_DONE;
-      }
-      break;
+bool TuyaDoorLock::is_retransmission_(const TuyaDoorLockFrame &frame) {
+  if (this->retransmit_window_ == 0)
+    return false;
+  const uint32_t hash = hash_frame(frame);
+  const uint32_t now = this->now_ms_();
+  for (auto &recent : this->recent_frames_) {
+    if (!recent.valid || recent.hash != hash || now - recent.received_at > this->retransmit_window_)
+      continue;
+    ESP_LOGD(TAG, "Frame 0x%02X retransmitted after %" PRIu32 "ms, not dispatched again", frame.command,
+             now - recent.received_at);
+    this->retransmit_count_++;
+    // The window stays anchored to the first copy, so a report the MCU keeps repeating is dispatched again once it
+    // is over
+    return true;
+  }
+  this->recent_frames_[this->recent_frame_next_] = TuyaDoorLockRecentFrame{true, hash, now};
+  this->recent_frame_next_ = (this->recent_frame_next_ + 1) % RECENT_FRAMES;
+  return false;
+}
+
+void TuyaDoorLock::handle_wifi_test_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "WIFI_TEST (0x%02X)", frame.command);
+  this->send_command_(TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::WIFI_TEST, .payload = std::vector<uint8_t>{0x00, 0x00}});
+}
+
+void TuyaDoorLock::handle_wifi_rssi_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "WIFI_RSSI (0x%02X)", frame.command);
+  this->send_command_(
+      TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::WIFI_RSSI, .payload = std::vector<uint8_t>{get_wifi_rssi_()}});
+}
+
+void TuyaDoorLock::handle_temp_password_multiple_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE (0x%02X)", frame.command);
+  // #ifdef USE_TIME
+  //       if (this->time_id_ != nullptr && this->totp_key_length_ > 0 && this->totp_key_ != nullptr) {
+  //         // Generate totp password
+  //         ESPTime now = this->time_id_->now();
+  //         if (now.is_valid()) {
+  //           // Convert the current time to a timestamp (in seconds since the epoch)
+  //           auto timestamp = (time_t)floor(now.timestamp / 30.0);  // Use the same 30-second time window
+  //           const uint32_t generated_password = otp::totp_hash_token(this->totp_key_, this->totp_key_length_, timestamp, 6);
+  //           ESP_LOGD(TAG, "Generated TOTP password: %u", generated_password);
+  //         } else {
+  //           ESP_LOGW(TAG, "Current time is invalid, cannot generate TOTP password.");
+  //         }
+  //       } else
+  // #endif
+  //       {
+  //         ESP_LOGW(TAG, "REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE is not handled because time is not configured and/or totp key was incorrect");
+  //       }
+  ESP_LOGD(TAG, "REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE is not handled, I don't want this feature");
+}
+
+void TuyaDoorLock::handle_verify_dynamic_password_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "VERIFY_DYNAMIC_PASSWORD (0x%02X)", frame.command);
+  ESP_LOGV(TAG, "Input password was: %.*s", 8, reinterpret_cast<const char *>(&frame.data[6]));
+#ifdef USE_TIME
+  if (this->time_id_ != nullptr && this->totp_key_length_ > 0 && this->totp_key_ != nullptr) {
+    // Generate totp password
+    ESPTime now = this->time_id_->now();
+    char generated_password_str[9];
+    if (now.is_valid()) {
+      auto timestamp = (time_t)floor(now.timestamp / 300.0);  // time windows of 5 min
+      const uint32_t generated_password = this->get_totp_code_(timestamp, 8);
+      snprintf(generated_password_str, sizeof(generated_password_str), "%08u", generated_password);
+      ESP_LOGVV(TAG, "Generated TOTP len=8 password: %u", generated_password);
+    } else {
+      ESP_LOGW(TAG, "Current time is invalid, cannot generate TOTP password.");
+      return;
     }
-    case TuyaDoorLockCommandType::WIFI_STATE:
-      ESP_LOGD(TAG, "WIFI_STATE handled, expected: 55 AA 00 02 00 00 01");
-      break;
-    case TuyaDoorLockCommandType::WIFI_RESET:
-      ESP_LOGE(TAG, "WIFI_RESET is not handled");
-      break;
-    case TuyaDoorLockCommandType::WIFI_SELECT:
-      ESP_LOGE(TAG, "WIFI_SELECT is not handled");
-      break;
-    case TuyaDoorLockCommandType::DATAPOINT_REPORT:
-      // This case happen every unlock attempt
-      ESP_LOGD(TAG, "DATAPOINT_REPORT (0x%02X)", command);
-      // We can just acknowledge before process, right? This is required for the request remote unlock
+    if (memcmp(generated_password_str, (char *)(frame.data + 6), 8) == 0) {
+      ESP_LOGD(TAG, "Password matched");
       this->send_command_(
           TuyaDoorLockCommand{
-              .cmd = TuyaDoorLockCommandType::DATAPOINT_REPORT,
-              .payload = std::vector<uint8_t>{0x00}  // Reporting succeeded
-          });
-      this->handle_datapoints_(buffer, len);
-      break;
-    case TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT:
-      // This case happen every sucessful unlock
-      ESP_LOGD(TAG, "DATAPOINT_RECORD_REPORT (0x%02X)", command);
-      {
-        // 02   00      01  01  01  04  00  01 02 00 04 00 00 00 03 0B 04 00 01 01
-        // GMT  YY+2000 MM  DD  HH  MM  SS  .................DATA.................
-        const uint8_t *report_data = buffer + 7;
-        this->handle_datapoints_(report_data, len - 7);
-        this->send_command_(
-            TuyaDoorLockCommand{
-                .cmd = TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT,
-                .payload = std::vector<uint8_t>{0x00}  // Reporting succeeded
-            });
-      }
-      break;
-    case TuyaDoorLockCommandType::MODULE_SEND_COMMAND:
-      break;
-    case TuyaDoorLockCommandType::WIFI_TEST:
-      ESP_LOGD(TAG, "WIFI_TEST (0x%02X)", command);
-      this->send_command_(TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::WIFI_TEST, .payload = std::vector<uint8_t>{0x00, 0x00}});
-      break;
-    case TuyaDoorLockCommandType::WIFI_RSSI:
-      ESP_LOGD(TAG, "WIFI_RSSI (0x%02X)", command);
+              .cmd = TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD,
+              .payload = std::vector<uint8_t>{0x00}});
+    } else {
+      ESP_LOGD(TAG, "Password not matched");
       this->send_command_(
-          TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::WIFI_RSSI, .payload = std::vector<uint8_t>{get_wifi_rssi_()}});
-      break;
-    case TuyaDoorLockCommandType::REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE:
-      ESP_LOGD(TAG, "REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE (0x%02X)", command);
-      // #ifdef USE_TIME
-      //       if (this->time_id_ != nullptr && this->totp_key_length_ > 0 && this->totp_key_ != nullptr) {
-      //         // Generate totp password
-      //         ESPTime now = this->time_id_->now();
-      //         if (now.is_valid()) {
-      //           // Convert the current time to a timestamp (in seconds since the epoch)
-      //           auto timestamp = (time_t)floor(now.timestamp / 30.0);  // Use the same 30-second time window
-      //           const uint32_t generated_password = otp::totp_hash_token(this->totp_key_, this->totp_key_length_, timestamp, 6);
-      //           ESP_LOGD(TAG, "Generated TOTP password: %u", generated_password);
-      //         } else {
-      //           ESP_LOGW(TAG, "Current time is invalid, cannot generate TOTP password.");
-      //         }
-      //       } else
-      // #endif
-      //       {
-      //         ESP_LOGW(TAG, "REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE is not handled because time is not configured and/or totp key was incorrect");
-      //       }
-      ESP_LOGD(TAG, "REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE is not handled, I don't want this feature");
-      break;
-    case TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD:
-      ESP_LOGD(TAG, "VERIFY_DYNAMIC_PASSWORD (0x%02X)", command);
-      ESP_LOGV(TAG, "Input password was: %.*s", 8, reinterpret_cast<const char *>(&buffer[6]));
-#ifdef USE_TIME
-      if (this->time_id_ != nullptr && this->totp_key_length_ > 0 && this->totp_key_ != nullptr) {
-        // Generate totp password
-        ESPTime now = this->time_id_->now();
-        char generated_password_str[9];
-        if (now.is_valid()) {
-          auto timestamp = (time_t)floor(now.timestamp / 300.0);  // time windows of 5 min
-          const uint32_t generated_password = otp::totp_hash_token(this->totp_key_, totp_key_length_, timestamp, 8);
-          snprintf(generated_password_str, sizeof(generated_password_str), "%08u", generated_password);
-          ESP_LOGVV(TAG, "Generated TOTP len=8 password: %u", generated_password);
-        } else {
-          ESP_LOGW(TAG, "Current time is invalid, cannot generate TOTP password.");
-          break;
-        }
-        if (memcmp(generated_password_str, (char *)(buffer + 6), 8) == 0) {
-          ESP_LOGD(TAG, "Password matched");
-          this->send_command_(
-              TuyaDoorLockCommand{
-                  .cmd = TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD,
-                  .payload = std::vector<uint8_t>{0x00}});
-        } else {
-          ESP_LOGD(TAG, "Password not matched");
-          this->send_command_(
-              TuyaDoorLockCommand{
-                  .cmd = TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD,
-                  .payload = std::vector<uint8_t>{0x01}});
-        }
-      } else
+          TuyaDoorLockCommand{
+              .cmd = TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD,
+              .payload = std::vector<uint8_t>{0x01}});
+    }
+  } else
 #endif
-      {
-        ESP_LOGW(TAG, "VERIFY_DYNAMIC_PASSWORD is not handled because time is not configured and/or totp key was incorrect");
-      }
-      break;
-    case TuyaDoorLockCommandType::LOCAL_TIME_QUERY:
-      ESP_LOGD(TAG, "LOCAL_TIME_QUERY (0x%02X)", command);
-#ifdef USE_TIME
-      if (this->time_id_ != nullptr) {
-        this->send_local_time_();
+  {
+    ESP_LOGW(TAG, "VERIFY_DYNAMIC_PASSWORD is not handled because time is not configured and/or totp key was incorrect");
+  }
+}
 
-        if (!this->time_sync_callback_registered_) {
-          // tuya_door_lock mcu supports time, so we let them know when our time changed
-          this->time_id_->add_on_time_sync_callback([this] { this->send_local_time_(); });
-          this->time_sync_callback_registered_ = true;
-        }
-      } else
-#endif
-      {
-        ESP_LOGW(TAG, "LOCAL_TIME_QUERY is not handled because time is not configured");
-      }
-      break;
-    case TuyaDoorLockCommandType::GMT_TIME_QUERY:
-      ESP_LOGD(TAG, "GMT_TIME_QUERY (0x%02X)", command);
+void TuyaDoorLock::handle_local_time_query_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "LOCAL_TIME_QUERY (0x%02X)", frame.command);
 #ifdef USE_TIME
-      if (this->time_id_ != nullptr) {
-        this->send_gmt_time_();
+  if (this->time_id_ != nullptr) {
+    this->time_query_ = TuyaDoorLockCommandType::LOCAL_TIME_QUERY;
+    this->send_time_();
+    this->register_time_sync_();
+  } else
+#endif
+  {
+    ESP_LOGW(TAG, "LOCAL_TIME_QUERY is not handled because time is not configured");
+  }
+}
 
-        if (!this->time_sync_callback_registered_) {
-          // tuya_door_lock mcu supports time, so we let them know when our time changed
-          this->time_id_->add_on_time_sync_callback([this] { this->send_gmt_time_(); });
-          this->time_sync_callback_registered_ = true;
-        }
-      } else
+void TuyaDoorLock::handle_gmt_time_query_(const TuyaDoorLockFrame &frame) {
+  ESP_LOGD(TAG, "GMT_TIME_QUERY (0x%02X)", frame.command);
+#ifdef USE_TIME
+  if (this->time_id_ != nullptr) {
+    this->time_query_ = TuyaDoorLockCommandType::GMT_TIME_QUERY;
+    this->send_time_();
+    this->register_time_sync_();
+  } else
 #endif
-      {
-        ESP_LOGW(TAG, "GMT_TIME_QUERY is not handled because time is not configured");
-      }
-      break;
-    default:
-      ESP_LOGE(TAG, "Invalid command (0x%02X) received", command);
+  {
+    ESP_LOGW(TAG, "GMT_TIME_QUERY is not handled because time is not configured");
   }
 }
 
 void TuyaDoorLock::handle_datapoints_(const uint8_t *buffer, size_t len) {
+  this->dispatch_datapoints_(buffer, len);
+  this->commit_datapoints_();
+}
+
+void TuyaDoorLock::commit_datapoints_() {
+  // Entities fed by several datapoints publish once, after every datapoint of the frame reached them
+  if (this->datapoints_dispatched_) {
+    this->datapoints_dispatched_ = false;
+    this->frame_commit_callback_.call();
+  }
+}
+
+void TuyaDoorLock::dispatch_datapoints_(const uint8_t *buffer, size_t len) {
   while (len >= 4) {
     TuyaDoorLockDatapoint datapoint{};
-    datapoint.id = buffer[0];
-    datapoint.type = (TuyaDoorLockDatapointType)buffer[1];
-    datapoint.value_uint = 0;
-
-    size_t data_size = (buffer[2] << 8) + buffer[3];
-    const uint8_t *data = buffer + 4;
-    size_t data_len = len - 4;
-    if (data_size > data_len) {
-      ESP_LOGW(TAG, "Datapoint %u is truncated and cannot be parsed (%zu > %zu)", datapoint.id, data_size, data_len);
-      return;
+    size_t consumed = 0;
+    switch (decode_datapoint(buffer, len, datapoint, consumed)) {
+      case TuyaDoorLockDecodeResult::OK:
+        break;
+      case TuyaDoorLockDecodeResult::TRUNCATED:
+        ESP_LOGW(TAG, "Datapoint %u is truncated and cannot be parsed (%zu > %zu)", datapoint.id,
+                 (size_t)encode_uint16(buffer[2], buffer[3]), len - 4);
+        return;
+      case TuyaDoorLockDecodeResult::BAD_LENGTH:
+        ESP_LOGW(TAG, "Datapoint %u of type %#02hhX has bad len %zu", datapoint.id,
+                 static_cast<uint8_t>(datapoint.type), datapoint.len);
+        return;
+      case TuyaDoorLockDecodeResult::UNKNOWN_TYPE:
+        ESP_LOGW(TAG, "Datapoint %u has unknown type %#02hhX", datapoint.id, static_cast<uint8_t>(datapoint.type));
+        return;
     }
 
-    datapoint.len = data_size;
-
     switch (datapoint.type) {
       case TuyaDoorLockDatapointType::RAW:
-        datapoint.value_raw = std::vector<uint8_t>(data, data + data_size);
         ESP_LOGD(TAG, "Datapoint %u update to %s", datapoint.id, format_hex_pretty(datapoint.value_raw).c_str());
         break;
       case TuyaDoorLockDatapointType::BOOLEAN:
-        if (data_size != 1) {
-          ESP_LOGW(TAG, "Datapoint %u has bad boolean len %zu", datapoint.id, data_size);
-          return;
-        }
-        datapoint.value_bool = data[0];
         ESP_LOGD(TAG, "Datapoint %u update to %s", datapoint.id, ONOFF(datapoint.value_bool));
         break;
       case TuyaDoorLockDatapointType::INTEGER:
-        if (data_size != 4) {
-          ESP_LOGW(TAG, "Datapoint %u has bad integer len %zu", datapoint.id, data_size);
-          return;
-        }
-        datapoint.value_uint = encode_uint32(data[0], data[1], data[2], data[3]);
         ESP_LOGD(TAG, "Datapoint %u update to %d", datapoint.id, datapoint.value_int);
         break;
       case TuyaDoorLockDatapointType::STRING:
-        datapoint.value_string = std::string(reinterpret_cast<const char *>(data), data_size);
         ESP_LOGD(TAG, "Datapoint %u update to %s", datapoint.id, datapoint.value_string.c_str());
         break;
       case TuyaDoorLockDatapointType::ENUM:
-        if (data_size != 1) {
-          ESP_LOGW(TAG, "Datapoint %u has bad enum len %zu", datapoint.id, data_size);
-          return;
-        }
-        datapoint.value_enum = data[0];
         ESP_LOGD(TAG, "Datapoint %u update to %d", datapoint.id, datapoint.value_enum);
         break;
       case TuyaDoorLockDatapointType::BITMASK:
-        switch (data_size) {
-          case 1:
-            datapoint.value_bitmask = encode_uint32(0, 0, 0, data[0]);
-            break;
-          case 2:
-            datapoint.value_bitmask = encode_uint32(0, 0, data[0], data[1]);
-            break;
-          case 4:
-            datapoint.value_bitmask = encode_uint32(data[0], data[1], data[2], data[3]);
-            break;
-          default:
-            ESP_LOGW(TAG, "Datapoint %u has bad bitmask len %zu", datapoint.id, data_size);
-            return;
-        }
         ESP_LOGD(TAG, "Datapoint %u update to %#08" PRIX32, datapoint.id, datapoint.value_bitmask);
         break;
-      default:
-        ESP_LOGW(TAG, "Datapoint %u has unknown type %#02hhX", datapoint.id, static_cast<uint8_t>(datapoint.type));
-        return;
     }
 
-    len -= data_size + 4;
-    buffer = data + data_size;
+    len -= consumed;
+    buffer += consumed;
 
     // drop update if datapoint is in ignore_mcu_datapoint_update list
     bool skip = false;
@@ -423,8 +787,10 @@ void TuyaDoorLock::handle_datapoints_(const uint8_t *buffer, size_t len) {
 
     // Update internal datapoints
     bool found = false;
+    bool unchanged = false;
     for (auto &other : this->datapoints_) {
       if (other.id == datapoint.id) {
+        unchanged = datapoint_value_equals(other, datapoint);
         other = datapoint;
         found = true;
       }
@@ -432,89 +798,509 @@ void TuyaDoorLock::handle_datapoints_(const uint8_t *buffer, size_t len) {
     if (!found) {
       this->datapoints_.push_back(datapoint);
     }
+    if (!unchanged)
+      this->journal_.append(datapoint, this->now_ms_());
 
-    // Run through listeners
-    for (auto &listener : this->listeners_) {
-      if (listener.datapoint_id == datapoint.id)
-        listener.on_datapoint(datapoint);
+    bool suppressed = false;
+    for (auto &filter : this->datapoint_filters_) {
+      if (filter.datapoint_id == datapoint.id) {
+        suppressed = !this->filter_datapoint_(filter, datapoint, unchanged);
+        break;
+      }
     }
+    if (suppressed)
+      continue;
+
+    this->notify_listeners_(datapoint);
   }
 }
 
-void TuyaDoorLock::send_raw_command_(TuyaDoorLockCommand command) {
-  uint8_t len_hi = (uint8_t)(command.payload.size() >> 8);
-  uint8_t len_lo = (uint8_t)(command.payload.size() & 0xFF);
-  uint8_t version = 0;
+bool TuyaDoorLock::filter_datapoint_(TuyaDoorLockDatapointFilter &filter, const TuyaDoorLockDatapoint &datapoint,
+                                     bool unchanged) {
+  if (filter.drop_unchanged && unchanged) {
+    ESP_LOGV(TAG, "Datapoint %u unchanged, dropping MCU update", datapoint.id);
+    this->unchanged_drop_count_++;
+    return false;
+  }
+  if (filter.deadband > 0 && filter.published && datapoint.type == TuyaDoorLockDatapointType::INTEGER) {
+    const int64_t delta = int64_t(datapoint.value_int) - int32_t(filter.published_value);
+    if (std::abs(delta) < int64_t(filter.deadband)) {
+      ESP_LOGV(TAG, "Datapoint %u change of %" PRId64 " within deadband, dropping MCU update", datapoint.id, delta);
+      this->deadband_drop_count_++;
+      return false;
+    }
+  }
+  const uint32_t now = this->now_ms_();
+  if (filter.min_interval > 0 && filter.published && now - filter.published_at < filter.min_interval) {
+    ESP_LOGV(TAG, "Datapoint %u throttled, dispatching in %" PRIu32 "ms", datapoint.id,
+             filter.min_interval - (now - filter.published_at));
+    this->throttled_count_++;
+    filter.pending = true;
+    return false;
+  }
+  filter.published = true;
+  filter.published_value = datapoint.value_uint;
+  filter.published_at = now;
+  filter.pending = false;
+  return true;
+}
 
-  this->last_command_timestamp_ = millis();
-  switch (command.cmd) {
-    case TuyaDoorLockCommandType::PRODUCT_QUERY:
-      this->expected_response_ = TuyaDoorLockCommandType::PRODUCT_QUERY;
-      break;
-    case TuyaDoorLockCommandType::MODULE_SEND_COMMAND:
-      break;
-    case TuyaDoorLockCommandType::WIFI_STATE:
-      break;
-    case TuyaDoorLockCommandType::DATAPOINT_REPORT:
-      break;
-    case TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT:
-      break;
-    case TuyaDoorLockCommandType::LOCAL_TIME_QUERY:
-      break;
-    case TuyaDoorLockCommandType::GMT_TIME_QUERY:
-      break;
-    case TuyaDoorLockCommandType::VERIFY_DYNAMIC_PASSWORD:
-      break;
-    default:
-      ESP_LOGE(TAG, "The command asked to be sent was not yet handled");
+void TuyaDoorLock::flush_throttled_datapoints_() {
+  const uint32_t now = this->now_ms_();
+  for (auto &filter : this->datapoint_filters_) {
+    if (!filter.pending || now - filter.published_at < filter.min_interval)
+      continue;
+    filter.pending = false;
+    for (auto &datapoint : this->datapoints_) {
+      if (datapoint.id != filter.datapoint_id)
+        continue;
+      filter.published_value = datapoint.value_uint;
+      filter.published_at = now;
+      this->notify_listeners_(datapoint);
       break;
+    }
+  }
+  this->commit_datapoints_();
+}
+
+void TuyaDoorLock::notify_listeners_(const TuyaDoorLockDatapoint &datapoint) {
+  this->datapoints_dispatched_ = true;
+  for (auto &listener : this->listeners_) {
+    if (listener.datapoint_id == datapoint.id)
+      listener.on_datapoint(datapoint);
   }
+}
+
+void TuyaDoorLock::send_raw_command_(TuyaDoorLockCommand command) {
+  uint8_t version = 0;
 
   ESP_LOGV(TAG, "Sending TuyaDoorLock: CMD=0x%02X VERSION=%u DATA=[%s] INIT_STATE=%u", static_cast<uint8_t>(command.cmd),
            version, format_hex_pretty(command.payload).c_str(), static_cast<uint8_t>(this->init_state_));
 
-  this->write_array({0x55, 0xAA, version, (uint8_t)command.cmd, len_hi, len_lo});
-  if (!command.payload.empty())
-    this->write_array(command.payload.data(), command.payload.size());
+  if (this->tx_buffer_.empty()) {
+    this->tx_written_ = 0;
+    this->tx_rx_mark_ = this->rx_byte_count_.load(std::memory_order_relaxed);
+  }
+  this->tx_frame_count_++;
+  encode_frame(version, (uint8_t)command.cmd, command.payload.data(), command.payload.size(), this->tx_buffer_);
 
-  uint8_t checksum = 0x55 + 0xAA + (uint8_t)command.cmd + len_hi + len_lo;
-  for (auto &data : command.payload)
-    checksum += data;
-  this->write_byte(checksum);
+  this->flush_tx_();
 }
 
-void TuyaDoorLock::process_command_queue_() {
-  uint32_t now = millis();
-  uint32_t delay = now - this->last_command_timestamp_;
+bool TuyaDoorLock::expects_response_(TuyaDoorLockCommandType cmd) {
+  const uint16_t index = this->command_index_[static_cast<uint8_t>(cmd)];
+  return index != 0 && this->command_entries_[index - 1].expects_response;
+}
 
-  if (now - this->last_rx_char_timestamp_ > RECEIVE_TIMEOUT) {
-    this->rx_message_.clear();
+bool TuyaDoorLock::is_pending_(TuyaDoorLockCommandType cmd) {
+  for (auto &pending : this->pending_responses_) {
+    if (pending.command.cmd == cmd)
+      return true;
   }
+  return false;
+}
+
+void TuyaDoorLock::dump_capture() {
+  // Format v1: a header line, then lines of hex encoded 6 byte records, oldest first:
+  // timestamp_us (uint32 little endian), direction (0 = RX, 1 = TX), data
+  static const size_t RECORD_SIZE = 6;
+  static const size_t RECORDS_PER_LINE = 16;
+  ESP_LOGI(TAG, "capture v1 entries=%zu baud=%" PRIu32, this->capture_count_, this->parent_->get_baud_rate());
+
+  if (this->capture_count_ == 0)
+    return;
 
-  if (this->expected_response_.has_value() && delay > RECEIVE_TIMEOUT) {
-    this->expected_response_.reset();
-    if (init_state_ != TuyaDoorLockInitState::INIT_DONE) {
-      if (++this->init_retries_ >= MAX_RETRIES) {
-        this->init_failed_ = true;
-        ESP_LOGE(TAG, "Initialization failed at init_state %u", static_cast<uint8_t>(this->init_state_));
-        this->command_queue_.erase(command_queue_.begin());
-        this->init_retries_ = 0;
+  char line[RECORDS_PER_LINE * RECORD_SIZE * 2 + 1];
+  size_t pos = 0;
+  size_t index = (this->capture_next_ + this->capture_size_ - this->capture_count_) % this->capture_size_;
+  for (size_t i = 0; i < this->capture_count_; i++) {
+    const TuyaDoorLockCaptureEntry &entry = this->capture_[index];
+    const uint8_t record[RECORD_SIZE] = {
+        (uint8_t)(entry.timestamp_us >> 0),  (uint8_t)(entry.timestamp_us >> 8),
+        (uint8_t)(entry.timestamp_us >> 16), (uint8_t)(entry.timestamp_us >> 24),
+        static_cast<uint8_t>(entry.direction), entry.data,
+    };
+    for (uint8_t byte : record) {
+      line[pos++] = format_hex_char(byte >> 4);
+      line[pos++] = format_hex_char(byte & 0x0F);
+    }
+    if (++index == this->capture_size_)
+      index = 0;
+    if (pos == sizeof(line) - 1 || i + 1 == this->capture_count_) {
+      line[pos] = '\0';
+      ESP_LOGI(TAG, "capture %s", line);
+      pos = 0;
+    }
+  }
+}
+
+uint32_t TuyaDoorLock::byte_time_us_() {
+  uint32_t baud_rate = this->parent_->get_baud_rate();
+  if (baud_rate == 0)
+    baud_rate = 9600;
+  // 8N1: start bit + 8 data bits + stop bit
+  return 10000000 / baud_rate;
+}
+
+void TuyaDoorLock::flush_tx_() {
+  if (this->tx_buffer_.empty())
+    return;
+
+  const uint32_t now = this->now_us_();
+  const uint32_t byte_time = this->byte_time_us_();
+  size_t in_fifo = 0;
+  if ((int32_t)(this->tx_drain_at_ - now) > 0)
+    in_fifo = (this->tx_drain_at_ - now + byte_time - 1) / byte_time;
+
+  size_t pending = this->tx_buffer_.size() - this->tx_written_;
+  if (pending > 0 && in_fifo < TX_FIFO_SIZE) {
+    // An idle line starts sending right away. tx_drain_at_ keeps the time the previous frame drained until then.
+    if (in_fifo == 0)
+      this->tx_drain_at_ = now;
+    size_t chunk = std::min(pending, TX_FIFO_SIZE - in_fifo);
+    this->write_array(&this->tx_buffer_[this->tx_written_], chunk);
+    // Stamp each byte with the time it starts on the wire
+    for (size_t i = 0; i < chunk; i++) {
+      this->capture_byte_(TuyaDoorLockCaptureDirection::TX, this->tx_drain_at_ + i * byte_time,
+                     this->tx_buffer_[this->tx_written_ + i]);
+    }
+    const uint32_t blocked = this->now_us_() - now;
+    if (blocked > this->tx_max_blocking_us_)
+      this->tx_max_blocking_us_ = blocked;
+    this->tx_written_ += chunk;
+    this->tx_drain_at_ += chunk * byte_time;
+    return;
+  }
+
+  if (pending == 0 && (int32_t)(now - this->tx_drain_at_) >= 0) {
+    // The last byte has left the wire, response timeout and command delay start from when it did, not from when
+    // this loop iteration noticed
+    this->tx_buffer_.clear();
+    this->tx_written_ = 0;
+    this->last_command_timestamp_ = this->now_ms_() - (now - this->tx_drain_at_) / 1000;
+    // Bytes received since the frame started only collided with it if the last of them came before it drained
+    if (this->rx_byte_count_.load(std::memory_order_relaxed) != this->tx_rx_mark_ &&
+        (int32_t)(this->last_rx_us_.load(std::memory_order_relaxed) - this->tx_drain_at_) < 0) {
+      this->collision_count_++;
+      ESP_LOGV(TAG, "MCU transmitted while our frame was on the wire");
+    }
+    for (auto &pending : this->pending_responses_) {
+      if (pending.state == TuyaDoorLockPendingState::TRANSMITTING) {
+        pending.state = TuyaDoorLockPendingState::AWAITING;
+        pending.since = this->last_command_timestamp_;
       }
-    } else {
-      this->command_queue_.erase(command_queue_.begin());
     }
   }
+}
+
+void TuyaDoorLock::record_rtt_(TuyaDoorLockCommandType cmd, uint32_t rtt, size_t response_len) {
+  TuyaDoorLockRttStats *stats = nullptr;
+  for (auto &other : this->rtt_stats_) {
+    if (other.cmd == cmd)
+      stats = &other;
+  }
+  if (stats == nullptr) {
+    this->rtt_stats_.push_back(TuyaDoorLockRttStats{.cmd = cmd});
+    stats = &this->rtt_stats_.back();
+  }
+
+  stats->samples[stats->next] = std::min<uint32_t>(rtt, UINT16_MAX);
+  stats->next = (stats->next + 1) % TuyaDoorLockRttStats::SAMPLES;
+  if (stats->count < TuyaDoorLockRttStats::SAMPLES)
+    stats->count++;
+  stats->max_response_len = std::max<size_t>(stats->max_response_len, response_len);
+  ESP_LOGV(TAG, "Command 0x%02X answered in %" PRIu32 "ms", static_cast<uint8_t>(cmd), rtt);
+}
+
+uint32_t TuyaDoorLock::get_response_timeout_(TuyaDoorLockCommandType cmd) {
+  for (auto &stats : this->rtt_stats_) {
+    if (stats.cmd != cmd || stats.count == 0)
+      continue;
+    // Insertion sort of at most SAMPLES values, std::sort's large-range path trips -Warray-bounds on this buffer
+    uint16_t sorted[TuyaDoorLockRttStats::SAMPLES];
+    const size_t count = std::min<size_t>(stats.count, TuyaDoorLockRttStats::SAMPLES);
+    for (size_t i = 0; i < count; i++) {
+      size_t j = i;
+      for (; j > 0 && sorted[j - 1] > stats.samples[i]; j--)
+        sorted[j] = sorted[j - 1];
+      sorted[j] = stats.samples[i];
+    }
+    const uint32_t p90 = sorted[(count * 9 - 1) / 10];
+    // Twice the 90th percentile, plus the airtime of the longest response seen so a longer reply is not cut short
+    const uint32_t airtime = (stats.max_response_len * this->byte_time_us_() + 999) / 1000;
+    return clamp<uint32_t>(p90 * 2 + airtime, MIN_RECEIVE_TIMEOUT, this->receive_timeout_);
+  }
+  return this->receive_timeout_;
+}
+
+uint32_t TuyaDoorLock::get_retry_backoff_(uint8_t retries) {
+  // Exponential backoff with up to 50% random jitter, so the MCU is not hit in lockstep
+  uint32_t backoff = std::min<uint32_t>(RETRY_BACKOFF_BASE << std::min<uint8_t>(retries, 16), RETRY_BACKOFF_MAX);
+  return backoff + random_uint32() % (backoff / 2 + 1);
+}
+
+void TuyaDoorLock::check_pending_timeouts_(uint32_t now) {
+  for (auto it = this->pending_responses_.begin(); it != this->pending_responses_.end();) {
+    if (it->state == TuyaDoorLockPendingState::AWAITING && now - it->since > it->timeout) {
+      ESP_LOGD(TAG, "Command 0x%02X timed out after %" PRIu32 "ms", static_cast<uint8_t>(it->command.cmd), it->timeout);
+      // max_retries counts every attempt, the first one included
+      if (++it->retries >= this->max_retries_) {
+        if (init_state_ != TuyaDoorLockInitState::INIT_DONE || it->command.cmd == TuyaDoorLockCommandType::PRODUCT_QUERY)
+          this->fail_init_(now);
+        it = this->pending_responses_.erase(it);
+        continue;
+      }
+      it->state = TuyaDoorLockPendingState::BACKOFF;
+      it->since = now;
+      it->timeout = this->get_retry_backoff_(it->retries);
+    }
+    ++it;
+  }
+}
+
+void TuyaDoorLock::fail_init_(uint32_t now) {
+  ESP_LOGE(TAG, "Initialization failed at init_state %u", static_cast<uint8_t>(this->init_state_));
+  this->init_failed_ = true;
+  if (!this->degraded_) {
+    this->degraded_ = true;
+    this->degraded_since_ = now;
+  }
+  this->recovery_from_ = now;
+  this->recovery_backoff_ = clamp<uint32_t>(this->recovery_backoff_ * 2, RECOVERY_BACKOFF_MIN, RECOVERY_BACKOFF_MAX);
+  ESP_LOGD(TAG, "Next recovery probe in %" PRIu32 "s", this->recovery_backoff_ / 1000);
+  if (!this->has_sequence_("recovery"))
+    this->start_sequence_("recovery", [this](TuyaDoorLockSequence &sequence, TuyaDoorLockResume reason,
+                                             const TuyaDoorLockFrame *) { this->recovery_step_(sequence, reason); });
+}
+
+void TuyaDoorLock::start_recovery_(const char *reason) {
+  if (!this->init_failed_ || this->is_pending_(TuyaDoorLockCommandType::PRODUCT_QUERY))
+    return;
+  ESP_LOGI(TAG, "Retrying initialization: %s", reason);
+  this->init_failed_ = false;
+  this->recovery_attempts_++;
+  this->send_empty_command_(TuyaDoorLockCommandType::PRODUCT_QUERY);
+}
+
+// Re-runs the handshake on a rising edge of EN, or once the recovery backoff expired
+void TuyaDoorLock::recovery_step_(TuyaDoorLockSequence &sequence, TuyaDoorLockResume reason) {
+  if (!this->init_failed_)
+    return;
+  if (reason == TuyaDoorLockResume::EN_EDGE && sequence.step == 2) {
+    this->start_recovery_("EN went high");
+    return;
+  }
+  const uint32_t elapsed = this->now_ms_() - this->recovery_from_;
+  if (elapsed >= this->recovery_backoff_) {
+    this->start_recovery_("periodic probe");
+    return;
+  }
+  // Step 1 waits for EN to drop, step 2 for it to rise again. Without en_binary_sensor only the backoff expires.
+  const bool en_state = this->en_binary_sensor_ != nullptr && this->en_binary_sensor_->state;
+  sequence.step = en_state ? 1 : 2;
+  sequence.await_en(!en_state, this->recovery_backoff_ - elapsed);
+}
+
+// Every rising edge of EN starts over, like the set_timeout()s it replaces were re-armed on each wake
+void TuyaDoorLock::start_wake_() {
+  this->stop_sequence_("wake");
+  this->start_sequence_("wake", [this](TuyaDoorLockSequence &sequence, TuyaDoorLockResume, const TuyaDoorLockFrame *) {
+    this->wake_step_(sequence);
+  });
+}
+
+// Reports the cloud connection after the MCU enabled the Tuya module
+void TuyaDoorLock::wake_step_(TuyaDoorLockSequence &sequence) {
+  if (sequence.step == 0) {
+#ifdef USE_TIME
+    this->push_time_if_drifted_();
+#endif
+    ESP_LOGD(TAG, "Tuya module enabled, reporting cloud connection in 1.25s, 3s");
+    sequence.step = 1;
+    sequence.sleep(WAKE_REPORT_DELAYS[0]);
+    return;
+  }
+  this->send_command_(
+      TuyaDoorLockCommand{
+          .cmd = TuyaDoorLockCommandType::WIFI_STATE,
+          .payload = std::vector<uint8_t>{0x04}  // Connected with Tuya Cloud
+      });
+  if (sequence.step == 1) {
+    sequence.step = 2;
+    sequence.sleep(WAKE_REPORT_DELAYS[1] - WAKE_REPORT_DELAYS[0]);
+  }
+}
+
+void TuyaDoorLock::start_sequence_(
+    const char *name, std::function<void(TuyaDoorLockSequence &, TuyaDoorLockResume, const TuyaDoorLockFrame *)> run) {
+  TuyaDoorLockSequence sequence{};
+  sequence.name = name;
+  sequence.run = std::move(run);
+  this->sequences_starting_.push_back(std::move(sequence));
+}
+
+void TuyaDoorLock::stop_sequence_(const char *name) {
+  // Stopped sequences stop waiting, run_sequences_() drops them
+  for (auto &sequence : this->sequences_) {
+    if (strcmp(sequence.name, name) == 0) {
+      sequence.started = true;
+      sequence.awaiting_response = false;
+      sequence.awaiting_en = false;
+      sequence.has_deadline = false;
+    }
+  }
+  this->sequences_starting_.erase(std::remove_if(this->sequences_starting_.begin(), this->sequences_starting_.end(),
+                                                 [name](const TuyaDoorLockSequence &sequence) {
+                                                   return strcmp(sequence.name, name) == 0;
+                                                 }),
+                                  this->sequences_starting_.end());
+}
+
+bool TuyaDoorLock::has_sequence_(const char *name) const {
+  for (auto &sequence : this->sequences_) {
+    if (strcmp(sequence.name, name) == 0 && sequence.is_waiting())
+      return true;
+  }
+  for (auto &sequence : this->sequences_starting_) {
+    if (strcmp(sequence.name, name) == 0)
+      return true;
+  }
+  return false;
+}
+
+void TuyaDoorLock::resume_sequence_(TuyaDoorLockSequence &sequence, TuyaDoorLockResume reason,
+                                    const TuyaDoorLockFrame *frame) {
+  sequence.started = true;
+  sequence.awaiting_response = false;
+  sequence.awaiting_en = false;
+  sequence.has_deadline = false;
+  sequence.run(sequence, reason, frame);
+  sequence.deadline_from = this->now_ms_();
+}
+
+void TuyaDoorLock::run_sequences_() {
+  for (auto &sequence : this->sequences_starting_)
+    this->sequences_.push_back(std::move(sequence));
+  this->sequences_starting_.clear();
+
+  const uint32_t now = this->now_ms_();
+  const bool en_state = this->en_binary_sensor_ != nullptr && this->en_binary_sensor_->state;
+  for (auto &sequence : this->sequences_) {
+    if (!sequence.started) {
+      this->resume_sequence_(sequence, TuyaDoorLockResume::START, nullptr);
+    } else if (sequence.awaiting_en && this->en_binary_sensor_ != nullptr && en_state == sequence.en_state) {
+      this->resume_sequence_(sequence, TuyaDoorLockResume::EN_EDGE, nullptr);
+    } else if (sequence.has_deadline && now - sequence.deadline_from >= sequence.deadline) {
+      this->resume_sequence_(sequence, TuyaDoorLockResume::DEADLINE, nullptr);
+    }
+  }
+  this->sequences_.erase(std::remove_if(this->sequences_.begin(), this->sequences_.end(),
+                                        [](const TuyaDoorLockSequence &sequence) {
+                                          return sequence.started && !sequence.is_waiting();
+                                        }),
+                         this->sequences_.end());
+}
+
+void TuyaDoorLock::send_and_await(const TuyaDoorLockCommand &command,
+                                  std::function<void(const TuyaDoorLockFrame *)> on_response, uint32_t timeout) {
+  // The sequence starts on the next loop(), the timeout counts from now
+  const uint32_t called_at = this->now_ms_();
+  this->start_sequence_("send_and_await", [this, command, on_response, timeout, called_at](
+                                              TuyaDoorLockSequence &sequence, TuyaDoorLockResume reason,
+                                              const TuyaDoorLockFrame *frame) {
+    if (reason == TuyaDoorLockResume::START) {
+      this->send_command_(command);
+      // 0 waits forever, a timeout already over still waits for the next loop()
+      const uint32_t elapsed = std::min(this->now_ms_() - called_at, timeout);
+      sequence.await_response(command.cmd, timeout == 0 ? 0 : std::max<uint32_t>(timeout - elapsed, 1));
+      return;
+    }
+    if (reason == TuyaDoorLockResume::DEADLINE)
+      ESP_LOGD(TAG, "No response to command 0x%02X within %" PRIu32 "ms", static_cast<uint8_t>(command.cmd), timeout);
+    on_response(frame);
+  });
+}
+
+uint32_t TuyaDoorLock::get_degraded_time() {
+  if (!this->degraded_)
+    return this->degraded_total_ms_;
+  return this->degraded_total_ms_ + (this->now_ms_() - this->degraded_since_);
+}
+
+void TuyaDoorLock::process_command_queue_() {
+  this->flush_tx_();
+
+  uint32_t now = this->now_ms_();
+  uint32_t delay = now - this->last_command_timestamp_;
+
+  // The RX task times out its own partial frames
+  if (!this->has_rx_task() && now - this->last_rx_char_timestamp_ > this->receive_timeout_) {
+    this->rx_parser_.reset();
+  }
+
+  // Nothing times out or goes out until the previous frame has fully left the wire
+  if (this->is_tx_busy_())
+    return;
+
+  this->check_pending_timeouts_(now);
 
   // Left check of delay since last command in case there's ever a command sent by calling send_raw_command_ directly
-  if (delay > COMMAND_DELAY && !this->command_queue_.empty() && this->rx_message_.empty() &&
-      !this->expected_response_.has_value()) {
-    this->send_raw_command_(command_queue_.front());
-    if (!this->expected_response_.has_value())
-      this->command_queue_.erase(command_queue_.begin());
+  if (delay < this->command_delay_ || !this->is_rx_idle_())
+    return;
+
+  // Only start a frame once both directions have been quiet for line_idle_bytes byte times, so we neither talk over
+  // the MCU nor glue our frame to the tail of the previous one
+  const uint32_t now_us = this->now_us_();
+  const uint32_t idle_gap = this->line_idle_bytes_ * this->byte_time_us_();
+  if (now_us - this->last_rx_us_ < idle_gap || now_us - this->tx_drain_at_ < idle_gap)
+    return;
+
+  // Retries go first, they were queued before anything still in command_queue_
+  for (auto &pending : this->pending_responses_) {
+    if (pending.state == TuyaDoorLockPendingState::BACKOFF && now - pending.since >= pending.timeout) {
+      if (!this->acquire_tx_slot_(pending.command))
+        return;
+      this->send_raw_command_(pending.command);
+      this->retry_count_++;
+      pending.state = TuyaDoorLockPendingState::TRANSMITTING;
+      pending.timeout = this->get_response_timeout_(pending.command.cmd);
+      return;
+    }
   }
+
+  // Send the oldest command that is not waiting behind a pending request of the same type, responses are matched by
+  // command type so only one request per type can be outstanding
+  for (auto it = this->command_queue_.begin(); it != this->command_queue_.end(); ++it) {
+    if (this->is_pending_(it->cmd))
+      continue;
+    if (!this->acquire_tx_slot_(*it))
+      return;
+    this->send_raw_command_(*it);
+    if (this->expects_response_(it->cmd)) {
+      const uint32_t timeout = this->get_response_timeout_(it->cmd);
+      this->pending_responses_.push_back(TuyaDoorLockPendingResponse{
+          .command = std::move(*it),
+          .state = TuyaDoorLockPendingState::TRANSMITTING,
+          .since = now,
+          .timeout = timeout,
+          .retries = 0,
+      });
+    }
+    this->command_queue_.erase(it);
+    return;
+  }
+}
+
+bool TuyaDoorLock::acquire_tx_slot_(const TuyaDoorLockCommand &command) {
+  return TuyaDoorLockTxScheduler::get_instance()->acquire(this->tx_slot_, command.payload.size() + FRAME_OVERHEAD);
 }
 
 void TuyaDoorLock::send_command_(const TuyaDoorLockCommand &command) {
+  if (this->is_passthrough()) {
+    // The original module answers the MCU, we only listen
+    ESP_LOGV(TAG, "Passthrough mode, not sending command 0x%02X", static_cast<uint8_t>(command.cmd));
+    return;
+  }
   command_queue_.push_back(command);
   process_command_queue_();
 }
@@ -571,9 +1357,23 @@ void TuyaDoorLock::send_wifi_status_() {
 }
 
 #ifdef USE_TIME
-void TuyaDoorLock::send_local_time_() {
+ESPTime TuyaDoorLock::time_now_() {
+  return this->time_query_ == TuyaDoorLockCommandType::GMT_TIME_QUERY ? this->time_id_->utcnow()
+                                                                       : this->time_id_->now();
+}
+
+void TuyaDoorLock::register_time_sync_() {
+  if (this->time_sync_callback_registered_)
+    return;
+  // tuya_door_lock mcu supports time, so we let them know when our time changed
+  this->time_id_->add_on_time_sync_callback([this] { this->send_time_(); });
+  this->time_sync_callback_registered_ = true;
+}
+
+void TuyaDoorLock::send_time_() {
+  const bool gmt = this->time_query_ == TuyaDoorLockCommandType::GMT_TIME_QUERY;
   std::vector<uint8_t> payload;
-  ESPTime now = this->time_id_->now();
+  ESPTime now = this->time_now_();
   if (now.is_valid()) {
     uint8_t year = now.year - 2000;
     uint8_t month = now.month;
@@ -586,87 +1386,182 @@ void TuyaDoorLock::send_local_time_() {
     if (day_of_week == 0) {
       day_of_week = 7;
     }
-    ESP_LOGD(TAG, "Sending local time");
+    ESP_LOGD(TAG, "Sending %s time", gmt ? "gmt" : "local");
     payload = std::vector<uint8_t>{0x01, year, month, day_of_month, hour, minute, second, day_of_week};
+    // The MCU clock is right again, the drift estimate restarts from the next record
+    this->has_clock_sample_ = false;
+    this->clock_offset_ = 0;
   } else {
     // By spec we need to notify MCU that the time was not obtained if this is a response to a query
-    ESP_LOGW(TAG, "Sending missing local time");
+    ESP_LOGW(TAG, "Sending missing %s time", gmt ? "gmt" : "local");
     payload = std::vector<uint8_t>{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
   }
-  this->send_command_(TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::LOCAL_TIME_QUERY, .payload = payload});
+  this->send_command_(TuyaDoorLockCommand{.cmd = this->time_query_, .payload = payload});
 }
-void TuyaDoorLock::send_gmt_time_() {
-  std::vector<uint8_t> payload;
-  ESPTime now = this->time_id_->now();
-  if (now.is_valid()) {
-    uint8_t year = now.year - 2000;
-    uint8_t month = now.month;
-    uint8_t day_of_month = now.day_of_month;
-    uint8_t hour = now.hour;
-    uint8_t minute = now.minute;
-    uint8_t second = now.second;
-    // TuyaDoorLock days starts from Monday, esphome uses Sunday as day 1
-    uint8_t day_of_week = now.day_of_week - 1;
-    if (day_of_week == 0) {
-      day_of_week = 7;
-    }
-    ESP_LOGD(TAG, "Sending gmt time (TODO: shift to GMT)");
-    payload = std::vector<uint8_t>{0x01, year, month, day_of_month, hour, minute, second, day_of_week};
-  } else {
-    // By spec we need to notify MCU that the time was not obtained if this is a response to a query
-    ESP_LOGW(TAG, "Sending missing gmt time");
-    payload = std::vector<uint8_t>{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+void TuyaDoorLock::track_mcu_clock_(const uint8_t *record) {
+  if (this->time_id_ == nullptr || record[0] == RECORD_TIME_NONE)
+    return;
+  if (record[0] != RECORD_TIME_LOCAL && record[0] != RECORD_TIME_GMT) {
+    ESP_LOGW(TAG, "Record timestamp has unknown time flag 0x%02X", record[0]);
+    return;
   }
-  this->send_command_(TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::GMT_TIME_QUERY, .payload = payload});
+  // Compared with the clock the MCU says it stamped the record with, whatever time query it made last
+  ESPTime now = record[0] == RECORD_TIME_GMT ? this->time_id_->utcnow() : this->time_id_->now();
+  if (!now.is_valid())
+    return;
+  const uint8_t *stamp = record + 1;
+  if (stamp[1] < 1 || stamp[1] > 12 || stamp[2] < 1 || stamp[2] > 31 || stamp[3] > 23 || stamp[4] > 59 ||
+      stamp[5] > 59) {
+    ESP_LOGW(TAG, "Record timestamp %s is not a valid date", format_hex_pretty(stamp, 6).c_str());
+    return;
+  }
+  // Compared field by field, both sides are in the same time zone
+  const int64_t mcu = civil_to_seconds(2000 + stamp[0], stamp[1], stamp[2], stamp[3], stamp[4], stamp[5]);
+  const int64_t ours = civil_to_seconds(now.year, now.month, now.day_of_month, now.hour, now.minute, now.second);
+  const int32_t offset = clamp<int64_t>(mcu - ours, INT32_MIN, INT32_MAX);
+  const uint32_t at = this->now_ms_();
+  if (!this->has_clock_sample_) {
+    this->has_clock_sample_ = true;
+    this->clock_base_offset_ = offset;
+    this->clock_base_at_ = at;
+    this->clock_drift_ppm_ = 0;
+  } else if (at - this->clock_base_at_ >= CLOCK_DRIFT_MIN_SPAN) {
+    const int64_t span_s = (at - this->clock_base_at_) / 1000;
+    this->clock_drift_ppm_ = (int64_t(offset) - this->clock_base_offset_) * 1000000 / span_s;
+  }
+  this->clock_offset_ = offset;
+  this->clock_offset_at_ = at;
+  ESP_LOGD(TAG, "MCU clock is %+" PRId32 "s off, drifting %" PRId32 "ppm", offset, this->clock_drift_ppm_);
+}
+
+void TuyaDoorLock::push_time_if_drifted_() {
+  if (this->time_id_ == nullptr || this->time_push_threshold_ == 0 || !this->has_clock_sample_)
+    return;
+  // Offset of the last record plus the drift accumulated since
+  const int64_t elapsed_ms = this->now_ms_() - this->clock_offset_at_;
+  const int64_t predicted = this->clock_offset_ + int64_t(this->clock_drift_ppm_) * elapsed_ms / 1000000000;
+  if (std::abs(predicted) < int64_t(this->time_push_threshold_))
+    return;
+  ESP_LOGI(TAG, "MCU clock is about %+" PRId64 "s off, pushing our time", predicted);
+  this->time_push_count_++;
+  this->send_time_();
 }
 #endif
 
-void TuyaDoorLock::set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value) {
-  this->set_raw_datapoint_value_(datapoint_id, value, false);
+bool TuyaDoorLock::set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value) {
+  return this->queue_write_(
+      TuyaDoorLockDatapointWrite{datapoint_id, TuyaDoorLockDatapointType::RAW, 0, false, 0, value});
+}
+
+bool TuyaDoorLock::set_boolean_datapoint_value(uint8_t datapoint_id, bool value) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::BOOLEAN, value, 1, false);
+}
+
+bool TuyaDoorLock::set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::INTEGER, value, 4, false);
+}
+
+bool TuyaDoorLock::set_string_datapoint_value(uint8_t datapoint_id, const std::string &value) {
+  return this->queue_write_(TuyaDoorLockDatapointWrite{datapoint_id, TuyaDoorLockDatapointType::STRING, 0, false, 0,
+                                                       std::vector<uint8_t>(value.begin(), value.end())});
 }
 
-void TuyaDoorLock::set_boolean_datapoint_value(uint8_t datapoint_id, bool value) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::BOOLEAN, value, 1, false);
+bool TuyaDoorLock::set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::ENUM, value, 1, false);
 }
 
-void TuyaDoorLock::set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::INTEGER, value, 4, false);
+bool TuyaDoorLock::set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::BITMASK, value, length, false);
 }
 
-void TuyaDoorLock::set_string_datapoint_value(uint8_t datapoint_id, const std::string &value) {
-  this->set_string_datapoint_value_(datapoint_id, value, false);
+bool TuyaDoorLock::force_set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value) {
+  return this->queue_write_(
+      TuyaDoorLockDatapointWrite{datapoint_id, TuyaDoorLockDatapointType::RAW, 0, true, 0, value});
 }
 
-void TuyaDoorLock::set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::ENUM, value, 1, false);
+bool TuyaDoorLock::force_set_boolean_datapoint_value(uint8_t datapoint_id, bool value) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::BOOLEAN, value, 1, true);
 }
 
-void TuyaDoorLock::set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::BITMASK, value, length, false);
+bool TuyaDoorLock::force_set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::INTEGER, value, 4, true);
 }
 
-void TuyaDoorLock::force_set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value) {
-  this->set_raw_datapoint_value_(datapoint_id, value, true);
+bool TuyaDoorLock::force_set_string_datapoint_value(uint8_t datapoint_id, const std::string &value) {
+  return this->queue_write_(TuyaDoorLockDatapointWrite{datapoint_id, TuyaDoorLockDatapointType::STRING, 0, true, 0,
+                                                       std::vector<uint8_t>(value.begin(), value.end())});
 }
 
-void TuyaDoorLock::force_set_boolean_datapoint_value(uint8_t datapoint_id, bool value) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::BOOLEAN, value, 1, true);
+bool TuyaDoorLock::force_set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::ENUM, value, 1, true);
 }
 
-void TuyaDoorLock::force_set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::INTEGER, value, 4, true);
+bool TuyaDoorLock::force_set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length) {
+  return this->queue_numeric_write_(datapoint_id, TuyaDoorLockDatapointType::BITMASK, value, length, true);
 }
 
-void TuyaDoorLock::force_set_string_datapoint_value(uint8_t datapoint_id, const std::string &value) {
-  this->set_string_datapoint_value_(datapoint_id, value, true);
+bool TuyaDoorLock::in_loop_task_() const {
+#ifdef USE_ESP32
+  return xTaskGetCurrentTaskHandle() == this->loop_task_;
+#elif defined(USE_HOST)
+  return std::this_thread::get_id() == this->loop_thread_;
+#else
+  return true;
+#endif
 }
 
-void TuyaDoorLock::force_set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::ENUM, value, 1, true);
+bool TuyaDoorLock::queue_write_(TuyaDoorLockDatapointWrite &&write) {
+  if (this->in_loop_task_()) {
+    // Writes queued by other tasks before this one go first
+    this->apply_writes_();
+    this->apply_write_(write);
+    return true;
+  }
+  // No logging here, this may run on any task
+  if (this->write_intake_.push(std::move(write)))
+    return true;
+  this->write_intake_dropped_.fetch_add(1, std::memory_order_relaxed);
+  return false;
 }
 
-void TuyaDoorLock::force_set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length) {
-  this->set_numeric_datapoint_value_(datapoint_id, TuyaDoorLockDatapointType::BITMASK, value, length, true);
+bool TuyaDoorLock::queue_numeric_write_(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, uint32_t value,
+                                        uint8_t length, bool forced) {
+  return this->queue_write_(TuyaDoorLockDatapointWrite{datapoint_id, datapoint_type, length, forced, value, {}});
+}
+
+void TuyaDoorLock::apply_write_(const TuyaDoorLockDatapointWrite &write) {
+  switch (write.type) {
+    case TuyaDoorLockDatapointType::RAW:
+      this->set_raw_datapoint_value_(write.datapoint_id, write.data, write.forced);
+      break;
+    case TuyaDoorLockDatapointType::STRING:
+      this->set_string_datapoint_value_(write.datapoint_id, std::string(write.data.begin(), write.data.end()),
+                                        write.forced);
+      break;
+    default:
+      this->set_numeric_datapoint_value_(write.datapoint_id, write.type, write.value, write.length, write.forced);
+      break;
+  }
+}
+
+void TuyaDoorLock::apply_writes_() {
+  TuyaDoorLockDatapointWrite write;
+  while (this->write_intake_.pop(write))
+    this->apply_write_(write);
+  const uint32_t dropped = this->write_intake_dropped_.load(std::memory_order_relaxed);
+  if (dropped != this->write_intake_dropped_reported_) {
+    ESP_LOGW(TAG, "Datapoint write queue full, %" PRIu32 " writes dropped", dropped - this->write_intake_dropped_reported_);
+    this->write_intake_dropped_reported_ = dropped;
+  }
+}
+
+bool TuyaDoorLock::get_datapoint(uint8_t datapoint_id, TuyaDoorLockDatapoint &out) {
+  optional<TuyaDoorLockDatapoint> datapoint = this->get_datapoint_(datapoint_id);
+  if (!datapoint.has_value())
+    return false;
+  out = *datapoint;
+  return true;
 }
 
 optional<TuyaDoorLockDatapoint> TuyaDoorLock::get_datapoint_(uint8_t datapoint_id) {
@@ -696,8 +1591,10 @@ void TuyaDoorLock::set_numeric_datapoint_value_(uint8_t datapoint_id, TuyaDoorLo
     case 4:
       data.push_back(value >> 24);
       data.push_back(value >> 16);
+      // fall through
     case 2:
       data.push_back(value >> 8);
+      // fall through
     case 1:
       data.push_back(value >> 0);
       break;
@@ -744,16 +1641,12 @@ void TuyaDoorLock::set_string_datapoint_value_(uint8_t datapoint_id, const std::
 
 void TuyaDoorLock::send_datapoint_command_(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, std::vector<uint8_t> data) {
   std::vector<uint8_t> buffer;
-  buffer.push_back(datapoint_id);
-  buffer.push_back(static_cast<uint8_t>(datapoint_type));
-  buffer.push_back(data.size() >> 8);
-  buffer.push_back(data.size() >> 0);
-  buffer.insert(buffer.end(), data.begin(), data.end());
+  encode_datapoint(datapoint_id, datapoint_type, data.data(), data.size(), buffer);
 
   this->send_command_(TuyaDoorLockCommand{.cmd = TuyaDoorLockCommandType::MODULE_SEND_COMMAND, .payload = buffer});
 }
 
-void TuyaDoorLock::register_listener(uint8_t datapoint_id, const std::function<void(TuyaDoorLockDatapoint)> &func) {
+void TuyaDoorLock::register_listener(uint8_t datapoint_id, const std::function<void(const TuyaDoorLockDatapoint &)> &func) {
   auto listener = TuyaDoorLockDatapointListener{
       .datapoint_id = datapoint_id,
       .on_datapoint = func,
@@ -770,31 +1663,59 @@ void TuyaDoorLock::register_listener(uint8_t datapoint_id, const std::function<v
 TuyaDoorLockInitState TuyaDoorLock::get_init_state() { return this->init_state_; }
 
 void TuyaDoorLock::parse_totp_key() {
-  // Free any previously allocated memory
-  if (this->totp_key_ != nullptr) {
-    delete[] this->totp_key_;
-    this->totp_key_ = nullptr;
-    this->totp_key_length_ = 0;
+  this->totp_key_ = nullptr;
+  this->totp_key_length_ = 0;
+  this->totp_shared_index_ = SIZE_MAX;
+
+  // Locks configured with the same key share one decoded copy
+  for (size_t i = 0; i < shared_totp_keys.size(); i++) {
+    if (shared_totp_keys[i].key_b32 == this->totp_key_b32) {
+      this->totp_key_ = shared_totp_keys[i].key.data();
+      this->totp_key_length_ = shared_totp_keys[i].key.size();
+      this->totp_shared_index_ = i;
+      return;
+    }
   }
 
-  // Convert std::string to const char*
-  const char *key_cstr = this->totp_key_b32.c_str();
-  int decoded_length = this->totp_key_b32.length();    // Set to the maximum length you expect
-  uint8_t *decoded_key = new uint8_t[decoded_length];  // Allocate memory for decoded_key
-  int actual_decoded_length = otp::base32_decode(key_cstr, decoded_key, decoded_length);
+  std::vector<uint8_t> decoded_key(this->totp_key_b32.length() + 1);
+  int actual_decoded_length = otp::base32_decode(this->totp_key_b32.c_str(), decoded_key.data(), decoded_key.size());
 
   if (actual_decoded_length > 0) {
     ESP_LOGD(TAG, "Sucessfully read totp_key_b32");
-    // Store the decoded key
+    decoded_key.resize(actual_decoded_length);
+    decoded_key.shrink_to_fit();
+    // The key buffer is never freed or resized, totp_key_ of every sharing lock points into it
+    shared_totp_keys.push_back(TuyaDoorLockSharedKey{
+        .key_b32 = this->totp_key_b32,
+        .key = std::move(decoded_key),
+        .has_code = false,
+        .code_window = 0,
+        .code_digits = 0,
+        .code = 0,
+    });
+    this->totp_key_ = shared_totp_keys.back().key.data();
     this->totp_key_length_ = actual_decoded_length;
-    this->totp_key_ = new uint8_t[this->totp_key_length_];
-    std::memcpy(this->totp_key_, decoded_key, this->totp_key_length_);
+    this->totp_shared_index_ = shared_totp_keys.size() - 1;
   } else {
     ESP_LOGE(TAG, "Fail to decode the provided totp_key_b32");
   }
+}
 
-  // Clean up temporary decoded_key
-  delete[] decoded_key;
+uint32_t TuyaDoorLock::get_totp_code_(uint64_t window, size_t digits) {
+  if (this->totp_shared_index_ >= shared_totp_keys.size() ||
+      this->totp_key_ != shared_totp_keys[this->totp_shared_index_].key.data()) {
+    // totp_key_ was set from a lambda, it takes precedence over totp_key_b32 and there is nothing to share
+    return otp::totp_hash_token(this->totp_key_, this->totp_key_length_, window, digits);
+  }
+  // Every lock with this key verifies against the same code during a window, compute it once
+  auto &shared = shared_totp_keys[this->totp_shared_index_];
+  if (!shared.has_code || shared.code_window != window || shared.code_digits != digits) {
+    shared.code = otp::totp_hash_token(shared.key.data(), shared.key.size(), window, digits);
+    shared.code_window = window;
+    shared.code_digits = digits;
+    shared.has_code = true;
+  }
+  return shared.code;
 }
 
 }  // namespace tuya_door_lock
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cinttypes>
+#include <thread>
 #include <vector>
 
 #include "esphome/components/binary_sensor/binary_sensor.h"
@@ -8,7 +11,13 @@
 #include "esphome/components/uart/uart.h"
 #include "esphome/core/component.h"
 #include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
 #include "esphome/core/helpers.h"
+#include "journal.h"
+#include "mpsc_queue.h"
+#include "protocol.h"
+#include "snapshot.h"
+#include "spsc_ring.h"
 
 #ifdef USE_TIME
 #include "esphome/components/time/real_time_clock.h"
@@ -18,69 +27,50 @@
 namespace esphome {
 namespace tuya_door_lock {
 
-enum class TuyaDoorLockDatapointType : uint8_t {
-  RAW = 0x00,      // variable length
-  BOOLEAN = 0x01,  // 1 byte (0/1)
-  INTEGER = 0x02,  // 4 byte
-  STRING = 0x03,   // variable length
-  ENUM = 0x04,     // 1 byte
-  BITMASK = 0x05,  // 1/2/4 bytes // Not supported
+struct TuyaDoorLockDatapointListener {
+  uint8_t datapoint_id;
+  std::function<void(const TuyaDoorLockDatapoint &)> on_datapoint;
 };
 
-struct TuyaDoorLockDatapoint {
-  uint8_t id;
-  TuyaDoorLockDatapointType type;
-  size_t len;
-  union {
-    bool value_bool;
-    int value_int;
-    uint32_t value_uint;
-    uint8_t value_enum;
-    uint32_t value_bitmask;
-  };
-  std::string value_string;
-  std::vector<uint8_t> value_raw;
+// Report policy of one datapoint, applied before its listeners run
+struct TuyaDoorLockDatapointFilter {
+  uint8_t datapoint_id;
+  bool drop_unchanged;
+  uint32_t deadband;      // INTEGER datapoints, smaller changes than this are dropped
+  uint32_t min_interval;  // ms between two dispatches, 0 disables throttling
+  bool published;
+  uint32_t published_value;  // value_uint the listeners saw last
+  uint32_t published_at;     // millis() of the last dispatch
+  // A throttled report waits in datapoints_ and is dispatched once min_interval has passed
+  bool pending;
 };
 
-struct TuyaDoorLockDatapointListener {
-  uint8_t datapoint_id;
-  std::function<void(TuyaDoorLockDatapoint)> on_datapoint;
-};
-
-enum class TuyaDoorLockCommandType : uint8_t {
-  // The one that I recieved
-
-  PRODUCT_QUERY = 0x01,            // Exactly the same // for me is {"p":"bljvjx2nsv02dhao","v":"3.4.0"}
-  WIFI_STATE = 0x02,               // FROM 0x03 The rest is matched
-  DATAPOINT_REPORT = 0x05,         // From 0x07 and 0x22 // Happen everytime someone try to unlock
-  DATAPOINT_RECORD_REPORT = 0x08,  // FROM 0x34 but nothing seems to match (the protocol is matched, but tuya imeplementation is diffrent) // Happen only when unlock successful
-  // DATAPOINT_DELIVER = 0x05, // REPORT REAL-TIME STATUS
-  // DATAPOINT_QUERY = 0x08, // REPORT STATUS OF RECORD TYPE
-  LOCAL_TIME_QUERY = 0x06,  // FROM 0x1C The rest is matched
-  GMT_TIME_QUERY = 0x10,    // FROM 0x0c The rest is matched # BUT esphome only implement local time so..
-  REQUEST_TEMP_PASSWD_CLOUD_MULTIPLE = 0x13,
-  VERIFY_DYNAMIC_PASSWORD = 0x12,  // 8 digits totp
-  MODULE_SEND_COMMAND = 0x09,
-
-  // Below is what they said on the table which seems totally wrong
-
-  WIFI_RESET = 0x03,
-  WIFI_SELECT = 0x04,
-  WIFI_TEST = 0x07,
-  REQUEST_WIFI_MODULE_FW_UPDATE = 0x0A,
-  WIFI_RSSI = 0x0B,
-  REQUEST_MCU_FW_UPDATE = 0x0c,
-  START_UPDATE = 0x0D,
-  TRANSMIT_UPDATE_PACKAGE = 0x0E,
-  REQUEST_TEMP_PASSWD_CLOUD_SINGLE = 0x11,
-  REQUEST_TEMP_PASSWD_CLOUD_SCHEDULE = 0x14,
-  GET_DP_CACHE_COMMAND = 0x15,
-  OFFLINE_DYNAMIC_PASSWORD = 0x16,
-  REPORT_SERIAL_NUMBER_MCU = 0x17,
-  POSITIONAL_NOTATION = 0x1C,
-  AUTOMATIC_UPDATE = 0x21,
-  NOTIFY_MODULE_RESET = 0x25,
-  WIFI_TEST_2 = 0xF0,
+// A recently dispatched report, to recognize the MCU resending it when our ack got lost
+struct TuyaDoorLockRecentFrame {
+  bool valid;  // false until a frame was stored in this slot
+  uint32_t hash;
+  uint32_t received_at;  // millis()
+};
+
+enum class TuyaDoorLockCaptureDirection : uint8_t {
+  RX = 0x00,  // MCU to us
+  TX = 0x01,  // us to MCU
+};
+
+// One raw byte seen on the UART
+struct TuyaDoorLockCaptureEntry {
+  uint32_t timestamp_us;
+  TuyaDoorLockCaptureDirection direction;
+  uint8_t data;
+};
+
+// A frame framed by the RX task, handed to loop() through the RX ring
+struct TuyaDoorLockRxFrame {
+  // Frames with more data are dropped by the RX task
+  static const size_t MAX_SIZE = FRAME_OVERHEAD + 256;
+  uint32_t arrival_us;  // micros() when the last byte was read
+  uint16_t len;
+  uint8_t raw[MAX_SIZE];  // complete frame, header to checksum
 };
 
 enum class TuyaDoorLockInitState : uint8_t {
@@ -93,81 +83,389 @@ struct TuyaDoorLockCommand {
   std::vector<uint8_t> payload;
 };
 
+// A datapoint write requested through the public setters, applied by loop()
+struct TuyaDoorLockDatapointWrite {
+  uint8_t datapoint_id;
+  TuyaDoorLockDatapointType type;
+  uint8_t length;  // numeric types only
+  bool forced;
+  uint32_t value;
+  std::vector<uint8_t> data;  // RAW and STRING
+};
+
+enum class TuyaDoorLockPendingState : uint8_t {
+  TRANSMITTING,  // request still leaving the wire
+  AWAITING,      // waiting for the response until timeout
+  BACKOFF,       // timed out, resent once the backoff expires
+};
+
+// A request sent to the MCU that expects a response with the same command type
+struct TuyaDoorLockPendingResponse {
+  TuyaDoorLockCommand command;
+  TuyaDoorLockPendingState state;
+  uint32_t since;    // millis() of the last state change
+  uint32_t timeout;  // response timeout while AWAITING, backoff while BACKOFF
+  uint8_t retries;
+};
+
+// Last round trip times of one command type, used to size its response timeout
+struct TuyaDoorLockRttStats {
+  static const uint8_t SAMPLES = 8;
+  TuyaDoorLockCommandType cmd{};
+  uint16_t samples[SAMPLES]{};
+  uint8_t count{0};
+  uint8_t next{0};
+  uint16_t max_response_len{0};
+};
+
+// Handles one received command, frame.data points into the receive buffer and is only valid during the call
+using TuyaDoorLockCommandHandler = std::function<void(const TuyaDoorLockFrame &)>;
+
+struct TuyaDoorLockCommandEntry {
+  TuyaDoorLockCommandHandler handler;
+  // Requests we send with this command are answered by the MCU with the same command
+  bool expects_response;
+};
+
+enum class TuyaDoorLockResume : uint8_t {
+  START,     // first run
+  RESPONSE,  // the awaited command arrived
+  DEADLINE,  // the timeout or sleep expired
+  EN_EDGE,   // en_binary_sensor reached the awaited state
+};
+
+// A multi-step exchange with the MCU, run by loop(). The step function is resumed with the reason it woke up and the
+// received frame for RESPONSE, looks at step to know where it left off, and arms at most one await before returning.
+// A run that arms nothing ends the sequence.
+struct TuyaDoorLockSequence {
+  const char *name;
+  std::function<void(TuyaDoorLockSequence &, TuyaDoorLockResume, const TuyaDoorLockFrame *)> run;
+  uint8_t step;
+  bool started;
+  bool awaiting_response;
+  TuyaDoorLockCommandType response_command;
+  bool awaiting_en;
+  bool en_state;
+  bool has_deadline;
+  uint32_t deadline_from;  // set by the lock when the run returns
+  uint32_t deadline;
+
+  // Wait for a frame with this command, or timeout ms (0: forever)
+  void await_response(TuyaDoorLockCommandType command, uint32_t timeout) {
+    this->awaiting_response = true;
+    this->response_command = command;
+    this->set_deadline_(timeout);
+  }
+  // Wait until en_binary_sensor is in state, or timeout ms (0: forever)
+  void await_en(bool state, uint32_t timeout) {
+    this->awaiting_en = true;
+    this->en_state = state;
+    this->set_deadline_(timeout);
+  }
+  void sleep(uint32_t duration) { this->set_deadline_(duration == 0 ? 1 : duration); }
+
+  void set_deadline_(uint32_t timeout) {
+    this->has_deadline = timeout != 0;
+    this->deadline = timeout;
+  }
+  bool is_waiting() const { return this->awaiting_response || this->awaiting_en || this->has_deadline; }
+};
+
+// Hands out TX slots to every TuyaDoorLock on the board. Each main loop iteration gets a byte budget, a lock that
+// could not send because another one used it up goes first in the next iteration.
+class TuyaDoorLockTxScheduler : public Component {
+ public:
+  static TuyaDoorLockTxScheduler *get_instance();
+
+  // Runs before the locks, so the budget is reset at the start of every iteration
+  float get_setup_priority() const override { return setup_priority::LATE + 1.0f; }
+  void loop() override;
+  void dump_config() override;
+
+  size_t add_lock();
+  // Whether the lock in slot may start a frame of len bytes now, only the first frame of an iteration may exceed the
+  // budget
+  bool acquire(size_t slot, size_t len);
+  uint32_t get_deferred_count() const { return this->deferred_count_; }
+
+ protected:
+  struct Slot {
+    bool waiting;  // denied in this iteration
+    bool overdue;  // denied in the previous iteration
+  };
+  std::vector<Slot> slots_;
+  size_t budget_{0};
+  size_t overdue_count_{0};
+  uint32_t deferred_count_{0};
+};
+
+// Decoded TOTP key, shared by every lock configured with the same totp_key_b32, along with the last generated code
+struct TuyaDoorLockSharedKey {
+  std::string key_b32;
+  std::vector<uint8_t> key;
+  bool has_code;
+  uint64_t code_window;
+  size_t code_digits;
+  uint32_t code;
+};
+
 class TuyaDoorLock : public Component, public uart::UARTDevice {
  public:
+  TuyaDoorLock();
   float get_setup_priority() const override { return setup_priority::LATE; }
   void setup() override;
   void loop() override;
   void dump_config() override;
-  void register_listener(uint8_t datapoint_id, const std::function<void(TuyaDoorLockDatapoint)> &func);
-  void set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value);
-  void set_boolean_datapoint_value(uint8_t datapoint_id, bool value);
-  void set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value);
-  void set_status_pin(InternalGPIOPin *status_pin) { this->status_pin_ = status_pin; }
+  void register_listener(uint8_t datapoint_id, const std::function<void(const TuyaDoorLockDatapoint &)> &func);
+  // Datapoint setters called from loop()'s task apply the write right away. Other tasks queue it for the next loop(),
+  // false when the write queue is full and the write was dropped.
+  bool set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value);
+  bool set_boolean_datapoint_value(uint8_t datapoint_id, bool value);
+  bool set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value);
+  // Writes from other tasks waiting for loop(), before setup() only
+  void set_write_queue_size(size_t write_queue_size) { this->write_intake_.resize(write_queue_size); }
+  void set_receive_timeout(uint32_t receive_timeout) { this->receive_timeout_ = receive_timeout; }
+  void set_command_delay(uint32_t command_delay) { this->command_delay_ = command_delay; }
+  // Attempts at a command that expects a response, the first one included
+  void set_max_retries(uint8_t max_retries) { this->max_retries_ = max_retries; }
+  void set_line_idle_bytes(uint8_t line_idle_bytes) { this->line_idle_bytes_ = line_idle_bytes; }
+  // Identical reports within this many ms are acknowledged but not dispatched again, 0 disables the check
+  void set_retransmit_window(uint32_t retransmit_window) { this->retransmit_window_ = retransmit_window; }
+  uint32_t get_retransmit_count() const { return this->retransmit_count_; }
+  uint32_t get_tx_frame_count() const { return this->tx_frame_count_; }
+  uint32_t get_collision_count() const { return this->collision_count_; }
+  uint32_t get_retry_count() const { return this->retry_count_; }
+  uint32_t get_rx_frame_count() const { return this->rx_frame_count_; }
+  uint32_t get_rx_frame_max_us() const { return this->rx_frame_max_us_; }
+  // Consistent copy of the datapoints and init state as of the last received frame, safe from any task
+  bool read_snapshot(TuyaDoorLockSnapshot &out) const { return this->snapshot_.read(out); }
+  // Number of datapoint changes kept for read_changes_since(), 0 disables the journal
+  void set_journal_size(size_t journal_size) { this->journal_.set_size(journal_size); }
+  uint32_t get_journal_sequence() const { return this->journal_.get_sequence(); }
+  // Datapoint changes after sequence, oldest first. false when the journal no longer reaches back that far, resync
+  // with read_snapshot() and resume from its sequence. Main loop only.
+  bool read_changes_since(uint32_t sequence, std::vector<TuyaDoorLockJournalEntry> &out) const {
+    return this->journal_.read_since(sequence, out);
+  }
+  // Current value of a datapoint, RAW and STRING in full, for journal entries marked truncated. false when the MCU
+  // has not reported it. Main loop only.
+  bool get_datapoint(uint8_t datapoint_id, TuyaDoorLockDatapoint &out);
+  // Heap and object memory owned by this lock, shared TOTP keys and the scheduler are not counted
+  size_t get_ram_usage() const;
+  void set_capture_size(size_t capture_size) { this->capture_size_ = capture_size; }
+  // Drain and frame the MCU UART in a FreeRTOS task pinned to core, ESP32 only
+  void set_rx_task_core(int8_t rx_task_core) { this->rx_task_core_ = rx_task_core; }
+  bool has_rx_task() const { return this->rx_ring_ != nullptr; }
+  // Upper bound of the 99th percentile delay between the RX task reading a frame and loop() dispatching it
+  uint32_t get_rx_latency_p99_us() const;
+  // UART wired to the original Tuya module, bytes are forwarded both ways and only decoded, never answered
+  void set_passthrough_uart(uart::UARTComponent *passthrough_uart) { this->passthrough_uart_ = passthrough_uart; }
+  bool is_passthrough() const { return this->passthrough_uart_ != nullptr; }
+  void dump_capture();
+  void set_status_pin(GPIOPin *status_pin) { this->status_pin_ = status_pin; }
   void set_en_binary_sensor(binary_sensor::BinarySensor *en_binary_sensor) { this->en_binary_sensor_ = en_binary_sensor; }
   // static void listen_enable_pin(TuyaDoorLock *arg);
   void set_totp_key(const std::string key) { this->totp_key_b32 = key; }
   void parse_totp_key();
   // void set_input_totp_text(text::Text *input_totp_text) { this->input_totp_text_ = input_totp_text; }
-  void set_string_datapoint_value(uint8_t datapoint_id, const std::string &value);
-  void set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value);
-  void set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length);
-  void force_set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value);
-  void force_set_boolean_datapoint_value(uint8_t datapoint_id, bool value);
-  void force_set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value);
-  void force_set_string_datapoint_value(uint8_t datapoint_id, const std::string &value);
-  void force_set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value);
-  void force_set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length);
+  bool set_string_datapoint_value(uint8_t datapoint_id, const std::string &value);
+  bool set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value);
+  bool set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length);
+  bool force_set_raw_datapoint_value(uint8_t datapoint_id, const std::vector<uint8_t> &value);
+  bool force_set_boolean_datapoint_value(uint8_t datapoint_id, bool value);
+  bool force_set_integer_datapoint_value(uint8_t datapoint_id, uint32_t value);
+  bool force_set_string_datapoint_value(uint8_t datapoint_id, const std::string &value);
+  bool force_set_enum_datapoint_value(uint8_t datapoint_id, uint8_t value);
+  bool force_set_bitmask_datapoint_value(uint8_t datapoint_id, uint32_t value, uint8_t length);
+  // Replaces the handler of command, built-in handlers included. A null handler accepts the command silently.
+  void register_command_handler(uint8_t command, TuyaDoorLockCommandHandler handler, bool expects_response = false);
+  uint32_t get_unknown_command_count() const { return this->unknown_command_count_; }
+  // Queue command and call on_response with the MCU's reply, or with nullptr when none arrived within timeout ms of
+  // this call (0: wait forever)
+  void send_and_await(const TuyaDoorLockCommand &command, std::function<void(const TuyaDoorLockFrame *)> on_response,
+                      uint32_t timeout);
   TuyaDoorLockInitState get_init_state();
-  // I add theses here to use from lambda
+  bool is_degraded() const { return this->degraded_; }
+  // Total time spent with a failed initialization, including the current outage
+  uint32_t get_degraded_time();
+  // I add theses here to use from lambda. A totp_key_ set from a lambda is used instead of the key parsed from
+  // totp_key_b32, call parse_totp_key() to go back to the configured one.
   std::string totp_key_b32 = "";
   uint8_t *totp_key_{nullptr};
   size_t totp_key_length_ = 0;
+  // Index in the shared TOTP keys, SIZE_MAX when no valid key was parsed
+  size_t totp_shared_index_{SIZE_MAX};
   // text::Text *input_totp_text_{nullptr};
 #ifdef USE_TIME
   void set_time_id(time::RealTimeClock *time_id) { this->time_id_ = time_id; }
+  // Push our time when the Tuya module is enabled and the MCU clock is estimated this many seconds off, 0 disables
+  void set_time_push_threshold(uint32_t time_push_threshold) { this->time_push_threshold_ = time_push_threshold; }
+  // MCU clock minus ours in seconds, from the timestamp of the last record report
+  int32_t get_mcu_clock_offset() const { return this->clock_offset_; }
+  // How fast the MCU clock runs away from ours, 0 until two records an hour apart were received since the last push
+  int32_t get_mcu_clock_drift_ppm() const { return this->clock_drift_ppm_; }
+  uint32_t get_time_push_count() const { return this->time_push_count_; }
 #endif
   void add_ignore_mcu_update_on_datapoints(uint8_t ignore_mcu_update_on_datapoints) {
     this->ignore_mcu_update_on_datapoints_.push_back(ignore_mcu_update_on_datapoints);
   }
+  void add_datapoint_filter(uint8_t datapoint_id, bool drop_unchanged, uint32_t deadband, uint32_t min_interval) {
+    this->datapoint_filters_.push_back(
+        TuyaDoorLockDatapointFilter{datapoint_id, drop_unchanged, deadband, min_interval, false, 0, 0, false});
+  }
+  uint32_t get_unchanged_drop_count() const { return this->unchanged_drop_count_; }
+  uint32_t get_deadband_drop_count() const { return this->deadband_drop_count_; }
+  uint32_t get_throttled_count() const { return this->throttled_count_; }
   void add_on_initialized_callback(std::function<void()> callback) {
     this->initialized_callback_.add(std::move(callback));
   }
+  // Called once at the end of every frame that updated datapoints, after all their listeners ran
+  void add_on_frame_commit_callback(std::function<void()> callback) {
+    this->frame_commit_callback_.add(std::move(callback));
+  }
 
  protected:
+  // Every timing decision of the protocol goes through these, so a host harness can drive the component with a
+  // virtual clock
+  virtual uint32_t now_ms_() { return millis(); }
+  virtual uint32_t now_us_() { return micros(); }
+
+  void start_sequence_(const char *name,
+                       std::function<void(TuyaDoorLockSequence &, TuyaDoorLockResume, const TuyaDoorLockFrame *)> run);
+  // Ends every sequence called name, started or not
+  void stop_sequence_(const char *name);
+  bool has_sequence_(const char *name) const;
+  void resume_sequence_(TuyaDoorLockSequence &sequence, TuyaDoorLockResume reason, const TuyaDoorLockFrame *frame);
+  void run_sequences_();
+  void start_wake_();
+  void wake_step_(TuyaDoorLockSequence &sequence);
+  void recovery_step_(TuyaDoorLockSequence &sequence, TuyaDoorLockResume reason);
   void handle_char_(uint8_t c);
+  void handle_frame_(const TuyaDoorLockFrame &frame);
+  bool is_rx_idle_() const {
+    return this->has_rx_task() ? !this->rx_task_in_frame_.load(std::memory_order_relaxed) : this->rx_parser_.is_idle();
+  }
+  void read_mcu_();
+#ifdef USE_ESP32
+  static void rx_task_entry_(void *arg);
+  void rx_task_loop_();
+#endif
+  // One pass of the RX task: reads what the UART has and pushes complete frames into rx_ring_, false when there was
+  // nothing to read. Runs on the RX task only, or on a test thread on the host.
+  bool rx_task_poll_();
+  void dispatch_rx_frames_();
+  void forward_module_();
+  void handle_module_frame_(const TuyaDoorLockFrame &frame);
+  void capture_byte_(TuyaDoorLockCaptureDirection direction, uint32_t timestamp_us, uint8_t data) {
+    if (this->capture_size_ == 0)
+      return;
+    this->capture_[this->capture_next_] = TuyaDoorLockCaptureEntry{timestamp_us, direction, data};
+    if (++this->capture_next_ == this->capture_size_)
+      this->capture_next_ = 0;
+    if (this->capture_count_ < this->capture_size_)
+      this->capture_count_++;
+  }
   void handle_datapoints_(const uint8_t *buffer, size_t len);
+  void dispatch_datapoints_(const uint8_t *buffer, size_t len);
+  // false when the filter suppresses this report
+  bool filter_datapoint_(TuyaDoorLockDatapointFilter &filter, const TuyaDoorLockDatapoint &datapoint, bool unchanged);
+  void flush_throttled_datapoints_();
+  void notify_listeners_(const TuyaDoorLockDatapoint &datapoint);
+  void commit_datapoints_();
+  // true when frame repeats a report dispatched within the retransmit window, otherwise remembers it
+  bool is_retransmission_(const TuyaDoorLockFrame &frame);
   optional<TuyaDoorLockDatapoint> get_datapoint_(uint8_t datapoint_id);
-  bool validate_message_();
 
   void handle_command_(uint8_t command, uint8_t version, const uint8_t *buffer, size_t len);
+  void register_builtin_handler_(TuyaDoorLockCommandType command,
+                                 void (TuyaDoorLock::*handler)(const TuyaDoorLockFrame &), bool expects_response);
+  void handle_product_query_(const TuyaDoorLockFrame &frame);
+  void handle_wifi_state_(const TuyaDoorLockFrame &frame);
+  void handle_unsupported_command_(const TuyaDoorLockFrame &frame);
+  void handle_datapoint_report_(const TuyaDoorLockFrame &frame);
+  void handle_datapoint_record_report_(const TuyaDoorLockFrame &frame);
+  void handle_wifi_test_(const TuyaDoorLockFrame &frame);
+  void handle_wifi_rssi_(const TuyaDoorLockFrame &frame);
+  void handle_temp_password_multiple_(const TuyaDoorLockFrame &frame);
+  void handle_verify_dynamic_password_(const TuyaDoorLockFrame &frame);
+  void handle_local_time_query_(const TuyaDoorLockFrame &frame);
+  void handle_gmt_time_query_(const TuyaDoorLockFrame &frame);
   void send_raw_command_(TuyaDoorLockCommand command);
+  bool acquire_tx_slot_(const TuyaDoorLockCommand &command);
+  void flush_tx_();
+  bool is_tx_busy_() const { return !this->tx_buffer_.empty(); }
+  uint32_t byte_time_us_();
+  void record_rtt_(TuyaDoorLockCommandType cmd, uint32_t rtt, size_t response_len);
+  uint32_t get_response_timeout_(TuyaDoorLockCommandType cmd);
+  uint32_t get_retry_backoff_(uint8_t retries);
+  bool expects_response_(TuyaDoorLockCommandType cmd);
+  bool is_pending_(TuyaDoorLockCommandType cmd);
+  void check_pending_timeouts_(uint32_t now);
+  void fail_init_(uint32_t now);
+  void start_recovery_(const char *reason);
   void process_command_queue_();
   void send_command_(const TuyaDoorLockCommand &command);
   void send_empty_command_(TuyaDoorLockCommandType command);
+  bool in_loop_task_() const;
+  bool queue_write_(TuyaDoorLockDatapointWrite &&write);
+  bool queue_numeric_write_(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, uint32_t value,
+                            uint8_t length, bool forced);
+  void apply_write_(const TuyaDoorLockDatapointWrite &write);
+  void apply_writes_();
   void set_numeric_datapoint_value_(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, uint32_t value,
                                     uint8_t length, bool forced);
   void set_string_datapoint_value_(uint8_t datapoint_id, const std::string &value, bool forced);
   void set_raw_datapoint_value_(uint8_t datapoint_id, const std::vector<uint8_t> &value, bool forced);
   void send_datapoint_command_(uint8_t datapoint_id, TuyaDoorLockDatapointType datapoint_type, std::vector<uint8_t> data);
+  uint32_t get_totp_code_(uint64_t window, size_t digits);
   void set_status_pin_();
   void send_wifi_status_();
   uint8_t get_wifi_status_code_();
   uint8_t get_wifi_rssi_();
 
 #ifdef USE_TIME
-  void send_local_time_();
-  void send_gmt_time_();
+  // Answers the last time query of the MCU, local time unless it asked for GMT
+  void send_time_();
+  ESPTime time_now_();
+  void register_time_sync_();
+  // record is the time of a record report: flag (0 no time, 1 local, 2 GMT) then YY MM DD HH MM SS
+  void track_mcu_clock_(const uint8_t *record);
+  void push_time_if_drifted_();
   time::RealTimeClock *time_id_{nullptr};
   bool time_sync_callback_registered_{false};
+  TuyaDoorLockCommandType time_query_{TuyaDoorLockCommandType::LOCAL_TIME_QUERY};
+  uint32_t time_push_threshold_{30};
+  uint32_t time_push_count_{0};
+  // Clock samples since the last push: the first one is the base of the drift estimate
+  bool has_clock_sample_{false};
+  int32_t clock_base_offset_{0};
+  uint32_t clock_base_at_{0};
+  int32_t clock_offset_{0};
+  uint32_t clock_offset_at_{0};
+  int32_t clock_drift_ppm_{0};
 #endif
   TuyaDoorLockInitState init_state_ = TuyaDoorLockInitState::INIT_LISTEN_ENABLE_PIN;
   bool init_failed_{false};
-  int init_retries_{0};
+  // Recovery from a failed initialization, re-runs the handshake with backoff
+  bool degraded_{false};
+  uint32_t degraded_since_{0};
+  uint32_t degraded_total_ms_{0};
+  uint32_t recovery_from_{0};
+  uint32_t recovery_backoff_{0};
+  uint32_t recovery_attempts_{0};
+  uint32_t receive_timeout_{300};
+  uint32_t command_delay_{0};
+  uint8_t max_retries_{5};
+  uint8_t line_idle_bytes_{4};
+  static const size_t RECENT_FRAMES = 8;
+  TuyaDoorLockRecentFrame recent_frames_[RECENT_FRAMES]{};
+  uint8_t recent_frame_next_{0};
+  uint32_t retransmit_window_{0};
+  uint32_t retransmit_count_{0};
+  std::vector<TuyaDoorLockRttStats> rtt_stats_;
   uint8_t protocol_version_ = -1;
-  InternalGPIOPin *status_pin_{nullptr};
+  GPIOPin *status_pin_{nullptr};
   binary_sensor::BinarySensor *en_binary_sensor_{nullptr};
-  bool has_sent_wifi_status = false;
   int status_pin_reported_ = -1;
   int reset_pin_reported_ = -1;
   uint32_t last_command_timestamp_ = 0;
@@ -175,12 +473,78 @@ class TuyaDoorLock : public Component, public uart::UARTDevice {
   std::string product_ = "";
   std::vector<TuyaDoorLockDatapointListener> listeners_;
   std::vector<TuyaDoorLockDatapoint> datapoints_;
-  std::vector<uint8_t> rx_message_;
+  TuyaDoorLockFrameParser rx_parser_;
+  TuyaDoorLockStateSnapshot snapshot_;
+  TuyaDoorLockJournal journal_;
+  uart::UARTComponent *passthrough_uart_{nullptr};
+  TuyaDoorLockFrameParser module_parser_;
+  HighFrequencyLoopRequester passthrough_high_freq_;
   std::vector<uint8_t> ignore_mcu_update_on_datapoints_{};
+  std::vector<TuyaDoorLockDatapointFilter> datapoint_filters_{};
+  uint32_t unchanged_drop_count_{0};
+  uint32_t deadband_drop_count_{0};
+  uint32_t throttled_count_{0};
   std::vector<TuyaDoorLockCommand> command_queue_;
-  optional<TuyaDoorLockCommandType> expected_response_{};
+  // Received command byte to 1 + index in command_entries_, 0 when nothing is registered
+  uint16_t command_index_[256]{};
+  std::vector<TuyaDoorLockCommandEntry> command_entries_;
+  uint32_t unknown_command_count_{0};
+  std::vector<TuyaDoorLockSequence> sequences_;
+  // Started since the last run_sequences_(), so steps can start sequences without invalidating the one running
+  std::vector<TuyaDoorLockSequence> sequences_starting_;
+  // The set_*/force_set_* datapoint setters may be called from any task, writes from other tasks than loop()'s wait
+  // here for loop()
+  static const size_t DEFAULT_WRITE_QUEUE_SIZE = 16;
+  TuyaDoorLockMpscQueue<TuyaDoorLockDatapointWrite> write_intake_{DEFAULT_WRITE_QUEUE_SIZE};
+#ifdef USE_ESP32
+  void *loop_task_{nullptr};
+#elif defined(USE_HOST)
+  std::thread::id loop_thread_;
+#endif
+  std::atomic<uint32_t> write_intake_dropped_{0};
+  uint32_t write_intake_dropped_reported_{0};
+  std::vector<TuyaDoorLockPendingResponse> pending_responses_;
+  // Frames waiting to be handed to the UART, written in FIFO sized chunks from loop()
+  std::vector<uint8_t> tx_buffer_;
+  size_t tx_written_{0};
+  size_t tx_slot_{0};
+  // micros() at which every byte handed to the UART so far has left the wire
+  uint32_t tx_drain_at_{0};
+  uint32_t tx_max_blocking_us_{0};
+  // micros() of the last byte read from the MCU, whether or not it ended up in a valid frame
+  std::atomic<uint32_t> last_rx_us_{0};
+  // rx_byte_count_ when the current TX burst started, the MCU sent something while our frame was on the wire if it
+  // moved before the burst drained
+  uint32_t tx_rx_mark_{0};
+  uint32_t tx_frame_count_{0};
+  uint32_t collision_count_{0};
+  uint32_t retry_count_{0};
+  // Cost of handling received frames: decoding, datapoint store update and listener dispatch
+  std::atomic<uint32_t> rx_byte_count_{0};
+  uint32_t rx_frame_count_{0};
+  uint64_t rx_frame_total_us_{0};
+  uint32_t rx_frame_max_us_{0};
+  // RX task mode: the task owns rx_parser_ and pushes complete frames into rx_ring_
+  // Frames, not bytes: 32 holds back-to-back small reports at 9600 baud through a 500ms main loop stall
+  static const size_t RX_RING_SIZE = 32;
+  static const size_t RX_LATENCY_BUCKETS = 24;
+  int8_t rx_task_core_{-1};
+  TuyaDoorLockSpscRing<TuyaDoorLockRxFrame, RX_RING_SIZE> *rx_ring_{nullptr};
+  std::atomic<bool> rx_task_in_frame_{false};
+  uint32_t rx_task_last_byte_ms_{0};
+  std::atomic<uint32_t> rx_dropped_frames_{0};
+  std::atomic<uint32_t> rx_bad_frames_{0};
+  // Bucket i counts dispatch delays below 2^i us
+  uint32_t rx_latency_hist_[RX_LATENCY_BUCKETS]{};
+  // Ring buffer of the last raw UART bytes in both directions, allocated once in setup()
+  TuyaDoorLockCaptureEntry *capture_{nullptr};
+  size_t capture_size_{0};
+  size_t capture_next_{0};
+  size_t capture_count_{0};
   uint8_t wifi_status_ = -1;
   CallbackManager<void()> initialized_callback_{};
+  CallbackManager<void()> frame_commit_callback_{};
+  bool datapoints_dispatched_{false};
 };
 
 }  // namespace tuya_door_lock
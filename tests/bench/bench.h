@@ -0,0 +1,113 @@
+#pragma once
+
+// Timing and reporting helpers shared by the host benchmarks
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "mcu_emulator.h"
+#include "pty.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace bench {
+
+using namespace testing;
+
+// --quick runs a short workload, enough for ctest to check the benchmark still works
+inline bool is_quick(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0)
+      return true;
+  }
+  return false;
+}
+
+inline uint64_t wall_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Value at percent (0-100) of the samples, the samples are sorted in place
+inline uint64_t percentile(std::vector<uint64_t> &samples, double percent) {
+  if (samples.empty())
+    return 0;
+  std::sort(samples.begin(), samples.end());
+  const size_t at = std::min(samples.size() - 1, (size_t) (percent / 100.0 * (samples.size() - 1) + 0.5));
+  return samples[at];
+}
+
+// Record report of one unlock, stamped like the README record layout: has time, YY MM DD HH MM SS, records
+inline std::vector<uint8_t> record_report(std::mt19937 &rng) {
+  std::vector<uint8_t> payload = {0x01,
+                                  26,
+                                  (uint8_t) (1 + rng() % 12),
+                                  (uint8_t) (1 + rng() % 28),
+                                  (uint8_t) (rng() % 24),
+                                  (uint8_t) (rng() % 60),
+                                  (uint8_t) (rng() % 60)};
+  // unlock_fingerprint .. unlock_card, or unlock_app
+  static const uint8_t UNLOCK_DPS[] = {1, 2, 3, 4, 5, 15};
+  const std::vector<uint8_t> record = encode_int_datapoint(UNLOCK_DPS[rng() % 6], rng() % 1000);
+  payload.insert(payload.end(), record.begin(), record.end());
+  return encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT, payload);
+}
+
+// Status report shaped like the README datapoint table, RAW and STRING values of payload_size bytes
+inline std::vector<uint8_t> status_report(std::mt19937 &rng, size_t payload_size) {
+  std::vector<uint8_t> records;
+  switch (rng() % 6) {
+    case 0:
+      records = encode_enum_datapoint(8, rng() % 13);  // alarm_lock
+      break;
+    case 1:
+      records = encode_enum_datapoint(11, rng() % 4);  // battery_state
+      break;
+    case 2:
+      records = encode_bool_datapoint(19, true);  // doorbell
+      break;
+    case 3:
+      records = encode_bool_datapoint(16, rng() % 2);  // hijack
+      break;
+    case 4:
+      records = encode_raw_datapoint(33, std::vector<uint8_t>(payload_size, (uint8_t) rng()));
+      break;
+    default:
+      records = encode_string_datapoint(34, std::string(payload_size, (char) ('a' + rng() % 26)));
+      break;
+  }
+  return encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, records);
+}
+
+// Mixed record and status reports, a quarter of them record reports
+inline std::vector<std::vector<uint8_t>> report_frames(uint32_t seed, size_t frame_count, size_t payload_size) {
+  std::mt19937 rng(seed);
+  std::vector<std::vector<uint8_t>> frames;
+  for (size_t i = 0; i < frame_count; i++)
+    frames.push_back(rng() % 4 == 0 ? record_report(rng) : status_report(rng, payload_size));
+  return frames;
+}
+
+// report_frames() back to back, with line noise between some frames when garbage is given
+inline std::vector<uint8_t> report_stream(uint32_t seed, size_t frame_count, size_t payload_size,
+                                          size_t *garbage = nullptr) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> stream;
+  for (const std::vector<uint8_t> &frame : report_frames(seed, frame_count, payload_size)) {
+    stream.insert(stream.end(), frame.begin(), frame.end());
+    if (garbage != nullptr && rng() % 50 == 0) {
+      stream.insert(stream.end(), {0x00, 0xFF, 0x55});
+      *garbage += 3;
+    }
+  }
+  return stream;
+}
+
+}  // namespace bench
+}  // namespace tuya_door_lock
+}  // namespace esphome
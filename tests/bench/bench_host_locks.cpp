@@ -0,0 +1,138 @@
+// One process serving 1 to 64 locks on the host platform, one pseudo terminal each, all watched by the shared epoll
+// event loop. Every lock gets a report every 250ms, staggered across the period. Reports main loop CPU per lock and
+// the delay from a report's write to its listener running. Real clock, real ttys, 16ms loop interval.
+
+#include <time.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "bench.h"
+#include "host_uart.h"
+#include "tuya_door_lock.h"
+
+using namespace esphome;
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+// ESPHome's default loop interval
+static const uint32_t LOOP_INTERVAL_US = 16000;
+static const uint32_t REPORT_PERIOD_MS = 250;
+
+struct ScaleRun {
+  double cpu_percent;
+  uint64_t loop_p99_us;
+  std::vector<uint64_t> dispatch_us;
+  size_t lost;
+};
+
+static uint64_t thread_cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static ScaleRun run(size_t lock_count, uint32_t duration_ms) {
+  const size_t reports = duration_ms / REPORT_PERIOD_MS;
+  // Ports are never closed, every run gets its own and they live until exit
+  std::vector<int> ttys(lock_count);
+  std::vector<TuyaDoorLockHostUART *> uarts(lock_count);
+  std::vector<std::unique_ptr<TuyaDoorLock>> locks;
+  std::vector<std::vector<uint32_t>> sent_at(lock_count, std::vector<uint32_t>(reports));
+  std::unique_ptr<std::atomic<uint32_t>[]> dispatched_at(new std::atomic<uint32_t>[lock_count * reports]());
+  for (size_t i = 0; i < lock_count; i++) {
+    std::string path;
+    ttys[i] = open_pty(&path);
+    if (ttys[i] < 0)
+      return {0, 0, {}, lock_count * reports};
+    uarts[i] = new TuyaDoorLockHostUART();  // NOLINT
+    uarts[i]->set_device(path);
+    uarts[i]->setup();
+    locks.emplace_back(new TuyaDoorLock());
+    locks[i]->set_uart_parent(uarts[i]);
+    locks[i]->set_retransmit_window(0);
+    std::atomic<uint32_t> *dispatched = &dispatched_at[i * reports];
+    locks[i]->register_listener(1, [dispatched, reports](const TuyaDoorLockDatapoint &dp) {
+      if (dp.value_uint < reports)
+        dispatched[dp.value_uint] = micros();
+    });
+    locks[i]->setup();
+  }
+
+  std::atomic<bool> done{false};
+  std::thread mcus([&] {
+    const uint32_t stagger_us = REPORT_PERIOD_MS * 1000 / lock_count;
+    for (uint32_t k = 0; k < reports; k++) {
+      for (size_t i = 0; i < lock_count; i++) {
+        std::this_thread::sleep_for(std::chrono::microseconds(stagger_us));
+        // Whatever the lock sent is dropped, so its tty never fills up
+        drain(ttys[i]);
+        const std::vector<uint8_t> frame =
+            encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_int_datapoint(1, k));
+        sent_at[i][k] = micros();
+        if (write(ttys[i], frame.data(), frame.size()) != (ssize_t) frame.size())
+          sent_at[i][k] = 0;
+      }
+    }
+    // Time for the last reports to be dispatched
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    done = true;
+  });
+
+  TuyaDoorLockHostEventLoop *event_loop = TuyaDoorLockHostEventLoop::get_instance();
+  std::vector<uint64_t> loop_us;
+  const uint64_t cpu_started = thread_cpu_ns();
+  const uint64_t wall_started = bench::wall_ns();
+  while (!done) {
+    const uint32_t iteration = micros();
+    // Same order as App.loop(): event loop first, then the ports, then the locks
+    event_loop->loop();
+    for (TuyaDoorLockHostUART *uart : uarts)
+      uart->loop();
+    for (auto &lock : locks)
+      lock->loop();
+    const uint32_t elapsed = micros() - iteration;
+    loop_us.push_back(elapsed);
+    if (elapsed < LOOP_INTERVAL_US)
+      std::this_thread::sleep_for(std::chrono::microseconds(LOOP_INTERVAL_US - elapsed));
+  }
+  const uint64_t cpu_ns = thread_cpu_ns() - cpu_started;
+  const uint64_t wall_ns = bench::wall_ns() - wall_started;
+  mcus.join();
+
+  ScaleRun result{};
+  result.cpu_percent = 100.0 * cpu_ns / wall_ns;
+  result.loop_p99_us = bench::percentile(loop_us, 99);
+  for (size_t i = 0; i < lock_count; i++) {
+    for (size_t k = 0; k < reports; k++) {
+      const uint32_t dispatched = dispatched_at[i * reports + k];
+      if (sent_at[i][k] == 0 || dispatched == 0) {
+        result.lost++;
+      } else {
+        result.dispatch_us.push_back(dispatched - sent_at[i][k]);
+      }
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const uint32_t duration_ms = bench::is_quick(argc, argv) ? 500 : 5000;
+
+  printf("%5s %8s %12s %12s %10s %10s %10s %6s\n", "locks", "cpu %", "cpu %/lock", "loop p99 us", "p50 us", "p99 us",
+         "max us", "lost");
+  for (size_t lock_count : {1, 2, 4, 8, 16, 32, 64}) {
+    ScaleRun result = run(lock_count, duration_ms);
+    const uint64_t p50 = bench::percentile(result.dispatch_us, 50);
+    const uint64_t p99 = bench::percentile(result.dispatch_us, 99);
+    const uint64_t max = result.dispatch_us.empty() ? 0 : result.dispatch_us.back();
+    printf("%5zu %8.3f %12.4f %12llu %10llu %10llu %10llu %6zu\n", lock_count, result.cpu_percent,
+           result.cpu_percent / lock_count, (unsigned long long) result.loop_p99_us, (unsigned long long) p50,
+           (unsigned long long) p99, (unsigned long long) max, result.lost);
+    if (result.lost > 0)
+      return 1;
+  }
+  printf("max epoll ready to read: %uus\n", TuyaDoorLockHostEventLoop::get_instance()->get_max_dispatch_us());
+  return 0;
+}
@@ -0,0 +1,126 @@
+// Per-frame latency on the host platform: reports written to a pseudo terminal, read by TuyaDoorLockHostUART once the
+// host event loop reports data, framed and decoded by a real TuyaDoorLock and dispatched to a listener. Real clock,
+// real tty, with the main loop at ESPHome's default 16ms interval and running flat out.
+
+#include <atomic>
+#include <thread>
+
+#include "bench.h"
+#include "host_uart.h"
+#include "tuya_door_lock.h"
+
+using namespace esphome;
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+// ESPHome's default loop interval
+static const uint32_t LOOP_INTERVAL_US = 16000;
+
+struct DispatchRun {
+  std::vector<uint64_t> write_to_dispatch_us;
+  std::vector<uint64_t> read_to_dispatch_us;
+  size_t lost;
+};
+
+static DispatchRun run(bool high_frequency, size_t payload_size, size_t count) {
+  // Ports are never closed, every run gets its own and they live until exit
+  std::string path;
+  const int tty = open_pty(&path);
+  if (tty < 0)
+    return {{}, {}, count};
+  TuyaDoorLockHostUART *uart = new TuyaDoorLockHostUART();  // NOLINT
+  uart->set_device(path);
+  uart->setup();
+
+  TuyaDoorLock lock;
+  lock.set_uart_parent(uart);
+  lock.set_retransmit_window(0);
+  std::vector<std::atomic<uint32_t>> dispatched_at(count);
+  uint32_t first_read_at = 0;
+  DispatchRun result{};
+  // The raw datapoint comes first, dp 1 is dispatched once the whole frame was handled
+  lock.register_listener(1, [&](const TuyaDoorLockDatapoint &dp) {
+    const uint32_t now = micros();
+    if (dp.value_uint < count)
+      dispatched_at[dp.value_uint] = now;
+    if (first_read_at != 0)
+      result.read_to_dispatch_us.push_back(now - first_read_at);
+    first_read_at = 0;
+  });
+  lock.setup();
+
+  std::vector<uint32_t> sent_at(count);
+  std::atomic<bool> done{false};
+  std::thread mcu([&] {
+    std::mt19937 rng(11);
+    for (uint32_t i = 0; i < count; i++) {
+      // At a random phase of the loop interval, whatever the lock sent meanwhile is dropped
+      std::this_thread::sleep_for(std::chrono::microseconds(1000 + rng() % LOOP_INTERVAL_US));
+      drain(tty);
+      std::vector<uint8_t> records = encode_raw_datapoint(33, std::vector<uint8_t>(payload_size, (uint8_t) i));
+      const std::vector<uint8_t> sequence = encode_int_datapoint(1, i);
+      records.insert(records.end(), sequence.begin(), sequence.end());
+      const std::vector<uint8_t> frame = encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, records);
+      sent_at[i] = micros();
+      if (write(tty, frame.data(), frame.size()) != (ssize_t) frame.size())
+        continue;
+      for (int wait = 0; wait < 500 && dispatched_at[i] == 0; wait++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    done = true;
+  });
+
+  TuyaDoorLockHostEventLoop *event_loop = TuyaDoorLockHostEventLoop::get_instance();
+  while (!done) {
+    const uint32_t iteration = micros();
+    event_loop->loop();
+    uart->loop();
+    // available() is where the port reads the tty
+    if (first_read_at == 0 && uart->available() > 0)
+      first_read_at = micros();
+    lock.loop();
+    const uint32_t elapsed = micros() - iteration;
+    if (high_frequency) {
+      std::this_thread::yield();
+    } else if (elapsed < LOOP_INTERVAL_US) {
+      std::this_thread::sleep_for(std::chrono::microseconds(LOOP_INTERVAL_US - elapsed));
+    }
+  }
+  mcu.join();
+
+  for (size_t i = 0; i < count; i++) {
+    if (dispatched_at[i] == 0) {
+      result.lost++;
+    } else {
+      result.write_to_dispatch_us.push_back(dispatched_at[i] - sent_at[i]);
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const size_t count = bench::is_quick(argc, argv) ? 20 : 300;
+
+  printf("%-16s %7s | %-22s | %-30s | %4s\n", "", "", "write to dispatch", "read to dispatch", "");
+  printf("%-16s %7s | %10s %10s | %10s %10s %8s | %4s\n", "loop", "payload", "p50 us", "p99 us", "p50 us", "p99 us",
+         "max us", "lost");
+  for (bool high_frequency : {false, true}) {
+    for (size_t payload_size : {8, 64, 255}) {
+      DispatchRun result = run(high_frequency, payload_size, count);
+      std::vector<uint64_t> &writes = result.write_to_dispatch_us;
+      std::vector<uint64_t> &reads = result.read_to_dispatch_us;
+      const uint64_t write_p50 = bench::percentile(writes, 50);
+      const uint64_t write_p99 = bench::percentile(writes, 99);
+      const uint64_t read_p50 = bench::percentile(reads, 50);
+      const uint64_t read_p99 = bench::percentile(reads, 99);
+      const uint64_t read_max = reads.empty() ? 0 : reads.back();
+      printf("%-16s %7zu | %10llu %10llu | %10llu %10llu %8llu | %4zu\n",
+             high_frequency ? "high frequency" : "16ms interval", payload_size,
+             (unsigned long long) write_p50, (unsigned long long) write_p99, (unsigned long long) read_p50,
+             (unsigned long long) read_p99, (unsigned long long) read_max, result.lost);
+      if (result.lost > 0)
+        return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Parse throughput: framing, checksum and datapoint decoding of a report stream, byte at a time like read_mcu_()
+
+#include "bench.h"
+#include "protocol.h"
+
+using namespace esphome::tuya_door_lock;
+
+struct ParseRun {
+  size_t frames;
+  size_t datapoints;
+  uint64_t elapsed_ns;
+};
+
+static ParseRun parse(const std::vector<uint8_t> &stream, bool decode) {
+  TuyaDoorLockFrameParser parser;
+  TuyaDoorLockDatapoint datapoint{};
+  ParseRun run{0, 0, 0};
+  const uint64_t started = bench::wall_ns();
+  for (uint8_t c : stream) {
+    if (parser.feed(c) != TuyaDoorLockParseResult::FRAME)
+      continue;
+    run.frames++;
+    if (!decode)
+      continue;
+    const TuyaDoorLockFrame frame = parser.get_frame();
+    // Record reports carry the time stamp before their records
+    size_t at = frame.command == (uint8_t) TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT ? 7 : 0;
+    size_t consumed = 0;
+    while (at < frame.len &&
+           decode_datapoint(frame.data + at, frame.len - at, datapoint, consumed) == TuyaDoorLockDecodeResult::OK) {
+      at += consumed;
+      run.datapoints++;
+    }
+  }
+  run.elapsed_ns = bench::wall_ns() - started;
+  return run;
+}
+
+int main(int argc, char **argv) {
+  const bool quick = bench::is_quick(argc, argv);
+  const size_t frame_count = quick ? 2000 : 200000;
+  const int repeats = quick ? 1 : 5;
+
+  printf("%-8s %-7s %10s %12s %10s %10s\n", "payload", "decode", "MB/s", "frames/s", "ns/frame", "ns/byte");
+  for (size_t payload_size : {8, 64, 255}) {
+    size_t garbage = 0;
+    const std::vector<uint8_t> stream = bench::report_stream(1, frame_count, payload_size, &garbage);
+    for (bool decode : {false, true}) {
+      // Best of the repeats, the others only add scheduler noise
+      ParseRun best{0, 0, UINT64_MAX};
+      for (int i = 0; i < repeats; i++) {
+        const ParseRun run = parse(stream, decode);
+        if (run.elapsed_ns < best.elapsed_ns)
+          best = run;
+      }
+      if (best.frames != frame_count) {
+        fprintf(stderr, "parsed %zu of %zu frames around %zu garbage bytes\n", best.frames, frame_count, garbage);
+        return 1;
+      }
+      const double seconds = best.elapsed_ns / 1e9;
+      printf("%-8zu %-7s %10.1f %12.0f %10.1f %10.2f\n", payload_size, decode ? "yes" : "no",
+             stream.size() / seconds / 1e6, best.frames / seconds, (double) best.elapsed_ns / best.frames,
+             (double) best.elapsed_ns / stream.size());
+    }
+  }
+  return 0;
+}
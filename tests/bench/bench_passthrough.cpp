@@ -0,0 +1,135 @@
+// Forwarding latency of passthrough mode over pseudo terminals, MCU to module and module to MCU, with the main loop
+// held at ESPHome's default 16ms interval and with it honoring HighFrequencyLoopRequester like App.loop() does.
+// Real clock, real ttys, the host event loop watches both ports.
+
+#include <atomic>
+#include <random>
+#include <thread>
+
+#include "bench.h"
+#include "host_uart.h"
+#include "tuya_door_lock.h"
+
+using namespace esphome;
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+// ESPHome's default loop interval
+static const uint32_t LOOP_INTERVAL_US = 16000;
+
+struct ForwardRun {
+  std::vector<uint64_t> to_module_us;
+  std::vector<uint64_t> to_mcu_us;
+  size_t lost_to_module;
+  size_t lost_to_mcu;
+};
+
+// Ports are never closed, every run gets its own pair and they live until exit
+struct PortPair {
+  int mcu_fd;
+  int module_fd;
+  TuyaDoorLockHostUART *mcu_uart;
+  TuyaDoorLockHostUART *module_uart;
+};
+
+static bool open_ports(PortPair *ports) {
+  std::string mcu_path, module_path;
+  ports->mcu_fd = open_pty(&mcu_path);
+  ports->module_fd = open_pty(&module_path);
+  if (ports->mcu_fd < 0 || ports->module_fd < 0)
+    return false;
+  ports->mcu_uart = new TuyaDoorLockHostUART();  // NOLINT
+  ports->mcu_uart->set_device(mcu_path);
+  ports->mcu_uart->setup();
+  ports->module_uart = new TuyaDoorLockHostUART();  // NOLINT
+  ports->module_uart->set_device(module_path);
+  ports->module_uart->setup();
+  return !ports->mcu_uart->is_failed() && !ports->module_uart->is_failed();
+}
+
+static ForwardRun run(const PortPair &ports, bool high_frequency, size_t count) {
+  TuyaDoorLock lock;
+  lock.set_uart_parent(ports.mcu_uart);
+  lock.set_passthrough_uart(ports.module_uart);
+  lock.setup();
+  // Whatever the lock said at setup is not part of the measurement
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  drain(ports.mcu_fd);
+  drain(ports.module_fd);
+
+  ForwardRun result{};
+  std::atomic<bool> done{false};
+  std::thread peers([&] {
+    std::mt19937 rng(7);
+    for (size_t i = 0; i < count; i++) {
+      // Alternate directions, at a random phase of the loop interval
+      std::this_thread::sleep_for(std::chrono::microseconds(2000 + rng() % LOOP_INTERVAL_US));
+      const bool to_module = i % 2 == 0;
+      const std::vector<uint8_t> frame =
+          to_module ? encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_int_datapoint(1, i))
+                    : encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::MODULE_SEND_COMMAND,
+                                       encode_bool_datapoint(6, i % 4 == 1));
+      const int from = to_module ? ports.mcu_fd : ports.module_fd;
+      const int to = to_module ? ports.module_fd : ports.mcu_fd;
+      size_t &lost = to_module ? result.lost_to_module : result.lost_to_mcu;
+      const uint64_t sent = bench::wall_ns();
+      if (write(from, frame.data(), frame.size()) != (ssize_t) frame.size()) {
+        lost++;
+        continue;
+      }
+      std::vector<uint8_t> received(frame.size());
+      if (!read_exactly(to, received.data(), received.size(), 500) || received != frame) {
+        lost++;
+        drain(to);
+        continue;
+      }
+      const uint64_t latency_us = (bench::wall_ns() - sent) / 1000;
+      (to_module ? result.to_module_us : result.to_mcu_us).push_back(latency_us);
+    }
+    done = true;
+  });
+
+  TuyaDoorLockHostEventLoop *event_loop = TuyaDoorLockHostEventLoop::get_instance();
+  while (!done) {
+    const uint32_t iteration = micros();
+    event_loop->loop();
+    ports.mcu_uart->loop();
+    ports.module_uart->loop();
+    lock.loop();
+    const uint32_t elapsed = micros() - iteration;
+    if (high_frequency && HighFrequencyLoopRequester::is_high_frequency()) {
+      std::this_thread::yield();
+    } else if (elapsed < LOOP_INTERVAL_US) {
+      std::this_thread::sleep_for(std::chrono::microseconds(LOOP_INTERVAL_US - elapsed));
+    }
+  }
+  peers.join();
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const size_t count = bench::is_quick(argc, argv) ? 40 : 400;
+
+  printf("%-16s %-14s %8s %8s %8s %6s\n", "loop", "direction", "p50 us", "p99 us", "max us", "lost");
+  for (bool high_frequency : {false, true}) {
+    PortPair ports;
+    if (!open_ports(&ports)) {
+      printf("Could not open pseudo terminals\n");
+      return 1;
+    }
+    ForwardRun result = run(ports, high_frequency, count);
+    for (bool to_module : {true, false}) {
+      std::vector<uint64_t> &latencies = to_module ? result.to_module_us : result.to_mcu_us;
+      const size_t lost = to_module ? result.lost_to_module : result.lost_to_mcu;
+      const uint64_t p50 = bench::percentile(latencies, 50);
+      const uint64_t p99 = bench::percentile(latencies, 99);
+      const uint64_t max = latencies.empty() ? 0 : latencies.back();
+      printf("%-16s %-14s %8llu %8llu %8llu %6zu\n", high_frequency ? "high frequency" : "16ms interval",
+             to_module ? "mcu->module" : "module->mcu", (unsigned long long) p50, (unsigned long long) p99,
+             (unsigned long long) max, lost);
+    }
+    if (result.lost_to_module + result.lost_to_mcu > 0)
+      return 1;
+  }
+  return 0;
+}
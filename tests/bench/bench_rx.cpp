@@ -0,0 +1,110 @@
+// Received frame handling: UART ingestion, framing, decoding, datapoint store and listener dispatch through a real
+// TuyaDoorLock, with allocations counted inside loop()
+
+#include <malloc.h>
+
+#include <atomic>
+#include <new>
+
+#include "bench.h"
+#include "harness.h"
+
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+// Allocations are counted only while loop() runs, live bytes all the time
+static bool counting = false;
+static uint64_t allocations = 0;
+static int64_t live_bytes = 0;
+static int64_t peak_bytes = 0;
+
+void *operator new(size_t size) {
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  live_bytes += malloc_usable_size(ptr);
+  if (counting) {
+    allocations++;
+    peak_bytes = std::max(peak_bytes, live_bytes);
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept {
+  if (ptr != nullptr)
+    live_bytes -= malloc_usable_size(ptr);
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+// Datapoints in the report stream, see bench::record_report() and bench::status_report()
+static const uint8_t STREAM_DPS[] = {1, 2, 3, 4, 5, 8, 11, 15, 16, 19, 33, 34};
+
+struct RxRun {
+  size_t frames;
+  uint64_t loop_ns;
+  uint64_t allocations;
+  int64_t peak_bytes;  // highest heap growth within one loop() call
+};
+
+static RxRun run(size_t listener_count, size_t payload_size, size_t frame_count) {
+  // Fast enough that many frames arrive between two loops
+  TuyaDoorLockHarness bench(nullptr, 921600);
+  bench.lock().set_retransmit_window(0);
+  uint64_t dispatched = 0;
+  for (size_t i = 0; i < listener_count; i++) {
+    bench.lock().register_listener(STREAM_DPS[i % sizeof(STREAM_DPS)],
+                                   [&dispatched](const TuyaDoorLockDatapoint &dp) { dispatched += dp.len; });
+  }
+  if (!bench.start()) {
+    fprintf(stderr, "handshake failed\n");
+    exit(1);
+  }
+
+  const uint32_t frames_before = bench.lock().get_rx_frame_count();
+  // Like the MCU, the next report only goes out once the previous one is acked
+  const std::vector<std::vector<uint8_t>> frames = bench::report_frames(2, frame_count, payload_size);
+  const size_t acks_before = bench.mcu().get_received().size();
+  size_t sent = 0;
+  RxRun result{0, 0, 0, 0};
+  allocations = 0;
+  while (bench.lock().get_rx_frame_count() - frames_before < frame_count) {
+    bench.poll_mcu();
+    if (sent < frames.size() && bench.mcu().get_received().size() - acks_before >= sent)
+      bench.mcu().send_raw(frames[sent++]);
+    TuyaDoorLockTxScheduler::get_instance()->loop();
+    const int64_t live_before = live_bytes;
+    peak_bytes = live_bytes;
+    const uint64_t started = bench::wall_ns();
+    counting = true;
+    bench.lock().loop();
+    counting = false;
+    result.loop_ns += bench::wall_ns() - started;
+    result.peak_bytes = std::max(result.peak_bytes, peak_bytes - live_before);
+    bench.clock().advance_us(1000);
+  }
+  result.frames = bench.lock().get_rx_frame_count() - frames_before;
+  result.allocations = allocations;
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const bool quick = bench::is_quick(argc, argv);
+  const size_t frame_count = quick ? 200 : 20000;
+
+  // Warm up caches and the allocator
+  run(1, 8, frame_count);
+
+  printf("%-9s %-8s %12s %10s %12s %10s\n", "listeners", "payload", "frames/s", "ns/frame", "allocs/frame",
+         "peak heap");
+  for (size_t listener_count : {1, 12, 48}) {
+    for (size_t payload_size : {8, 64, 255}) {
+      const RxRun result = run(listener_count, payload_size, frame_count);
+      printf("%-9zu %-8zu %12.0f %10.0f %12.2f %10lld\n", listener_count, payload_size,
+             result.frames / (result.loop_ns / 1e9), (double) result.loop_ns / result.frames,
+             (double) result.allocations / result.frames, (long long) result.peak_bytes);
+    }
+  }
+  return 0;
+}
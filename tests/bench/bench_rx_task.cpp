@@ -0,0 +1,125 @@
+// Byte arrival to listener dispatch latency under synthetic main-loop load, with the UART read from loop() and with
+// the RX task (rx_task_core) running on a std::thread. Real clock and real threads.
+
+#include <thread>
+
+#include "bench.h"
+#include "threaded_lock.h"
+#include "threaded_uart.h"
+
+using namespace esphome;
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+// ESPHome's default loop interval
+static const uint32_t LOOP_INTERVAL_US = 16000;
+
+struct Load {
+  const char *name;
+  uint32_t busy_us;   // other components, every loop iteration
+  uint32_t stall_us;  // one slow component, every stall_every_us
+  uint32_t stall_every_us;
+  uint32_t burst_size;  // reports the MCU sends back to back, every burst_period_ms
+  uint32_t burst_period_ms;
+};
+
+struct LatencyRun {
+  std::vector<uint64_t> latencies_us;
+  size_t sent;
+  size_t overflowed_bytes;
+};
+
+static void spin_us(uint32_t us) {
+  const uint32_t started = micros();
+  while (micros() - started < us) {
+  }
+}
+
+static LatencyRun run(bool rx_task, const Load &load, uint32_t duration_ms) {
+  TuyaDoorLockThreadedUART uart(9600);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  lock.set_retransmit_window(0);
+  std::vector<uint32_t> arrived_at;
+  std::vector<uint32_t> dispatched_at;
+  lock.register_listener(1, [&](const TuyaDoorLockDatapoint &dp) {
+    if (dp.value_uint < dispatched_at.size())
+      dispatched_at[dp.value_uint] = micros();
+  });
+  lock.setup();
+  if (rx_task)
+    lock.start_rx_task();
+
+  // 15 byte frames, 15.6ms each at 9600 baud
+  const size_t count = duration_ms / load.burst_period_ms * load.burst_size;
+  arrived_at.resize(count);
+  dispatched_at.assign(count, 0);
+  std::atomic<bool> mcu_done{false};
+  std::thread mcu([&] {
+    for (uint32_t i = 0; i < count; i++) {
+      arrived_at[i] = uart.send(
+          encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_int_datapoint(1, i)));
+      if (i % load.burst_size == load.burst_size - 1)
+        std::this_thread::sleep_for(std::chrono::milliseconds(load.burst_period_ms));
+    }
+    mcu_done = true;
+  });
+
+  const uint32_t started = micros();
+  uint32_t next_stall = started + load.stall_every_us;
+  while (!mcu_done || micros() - started < duration_ms * 1000) {
+    const uint32_t iteration = micros();
+    lock.loop();
+    spin_us(load.busy_us);
+    if (load.stall_us > 0 && (int32_t)(micros() - next_stall) >= 0) {
+      spin_us(load.stall_us);
+      next_stall += load.stall_every_us;
+    }
+    const uint32_t elapsed = micros() - iteration;
+    if (elapsed < LOOP_INTERVAL_US)
+      std::this_thread::sleep_for(std::chrono::microseconds(LOOP_INTERVAL_US - elapsed));
+  }
+  // Dispatch what is still queued
+  for (int i = 0; i < 50; i++) {
+    lock.loop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  mcu.join();
+  lock.stop_rx_task();
+
+  LatencyRun result;
+  result.sent = count;
+  result.overflowed_bytes = uart.get_overflow_count();
+  for (size_t i = 0; i < count; i++) {
+    if (dispatched_at[i] != 0)
+      result.latencies_us.push_back(dispatched_at[i] - arrived_at[i]);
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const bool quick = bench::is_quick(argc, argv);
+  const uint32_t duration_ms = quick ? 1000 : 8000;
+  const Load loads[] = {
+      {"idle", 0, 0, 0, 4, 250},
+      {"busy 5ms/loop", 5000, 0, 0, 4, 250},
+      {"stall 300ms/2s", 0, 300000, 2000000, 4, 250},
+      // 300 bytes, more than the driver buffer holds
+      {"stall+burst 20", 0, 300000, 2000000, 20, 1000},
+  };
+
+  printf("%-16s %-8s %8s %8s %8s %8s %10s\n", "load", "reader", "p50 us", "p99 us", "max us", "lost", "overflow B");
+  for (const Load &load : loads) {
+    for (bool rx_task : {false, true}) {
+      LatencyRun result = run(rx_task, load, duration_ms);
+      const size_t lost = result.sent - result.latencies_us.size();
+      const uint64_t p50 = bench::percentile(result.latencies_us, 50);
+      const uint64_t p99 = bench::percentile(result.latencies_us, 99);
+      const uint64_t max = result.latencies_us.empty() ? 0 : result.latencies_us.back();
+      printf("%-16s %-8s %8llu %8llu %8llu %8zu %10zu\n", load.name, rx_task ? "rx task" : "loop",
+             (unsigned long long) p50, (unsigned long long) p99, (unsigned long long) max, lost,
+             result.overflowed_bytes);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,128 @@
+// Readers hammering read_snapshot() on other threads while the lock receives report bursts through the RX task and
+// publishes a snapshot after every frame. Real clock and real threads.
+
+#include <thread>
+
+#include "bench.h"
+#include "threaded_lock.h"
+#include "threaded_uart.h"
+
+using namespace esphome;
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+struct SnapshotRun {
+  uint64_t reads;
+  uint64_t failed_reads;
+  std::vector<uint64_t> read_ns;  // every 64th read
+  std::vector<uint64_t> dispatch_us;
+  size_t sent;
+  uint64_t elapsed_ns;
+};
+
+static SnapshotRun run(uint32_t reader_count, uint32_t duration_ms) {
+  TuyaDoorLockThreadedUART uart(115200);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  lock.set_retransmit_window(0);
+  // Bursts of 16 reports 50ms apart, 4 datapoints each: 45 byte frames, a burst takes 63ms at 115200 baud
+  const size_t count = duration_ms / 113 * 16;
+  std::vector<uint32_t> arrived_at(count);
+  std::vector<uint32_t> dispatched_at(count, 0);
+  lock.register_listener(1, [&](const TuyaDoorLockDatapoint &dp) {
+    if (dp.value_uint < count)
+      dispatched_at[dp.value_uint] = micros();
+  });
+  lock.setup();
+  lock.start_rx_task();
+
+  SnapshotRun result{0, 0, {}, {}, count, 0};
+  std::atomic<bool> running{true};
+  std::atomic<uint64_t> reads{0};
+  std::atomic<uint64_t> failed_reads{0};
+  std::vector<std::vector<uint64_t>> read_ns(reader_count);
+  std::vector<std::thread> readers;
+  for (uint32_t r = 0; r < reader_count; r++) {
+    readers.emplace_back([&, r] {
+      TuyaDoorLockSnapshot snapshot{};
+      uint64_t local_reads = 0;
+      uint64_t local_failed = 0;
+      while (running.load(std::memory_order_relaxed)) {
+        const bool timed = (local_reads & 63) == 0;
+        const uint64_t started = timed ? bench::wall_ns() : 0;
+        if (!lock.read_snapshot(snapshot))
+          local_failed++;
+        if (timed)
+          read_ns[r].push_back(bench::wall_ns() - started);
+        local_reads++;
+      }
+      reads += local_reads;
+      failed_reads += local_failed;
+    });
+  }
+
+  std::atomic<bool> mcu_done{false};
+  std::thread mcu([&] {
+    std::vector<uint8_t> records;
+    for (uint32_t i = 0; i < count; i++) {
+      records = encode_int_datapoint(1, i);
+      for (const std::vector<uint8_t> &record :
+           {encode_enum_datapoint(8, i % 13), encode_bool_datapoint(19, i % 2),
+            encode_raw_datapoint(33, std::vector<uint8_t>(16, (uint8_t) i))})
+        records.insert(records.end(), record.begin(), record.end());
+      arrived_at[i] = uart.send(encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, records));
+      // 50ms of quiet once the burst has arrived
+      if (i % 16 == 15) {
+        while ((int32_t)(micros() - arrived_at[i]) < 0)
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      }
+    }
+    mcu_done = true;
+  });
+
+  const uint64_t started = bench::wall_ns();
+  // Until the last burst is dispatched
+  uint32_t drain_until = 0;
+  while (!mcu_done || (int32_t)(millis() - drain_until) < 0) {
+    if (mcu_done && drain_until == 0)
+      drain_until = millis() + 100;
+    lock.loop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  running = false;
+  result.elapsed_ns = bench::wall_ns() - started;
+  for (auto &reader : readers)
+    reader.join();
+  mcu.join();
+  lock.stop_rx_task();
+
+  result.reads = reads;
+  result.failed_reads = failed_reads;
+  for (auto &samples : read_ns)
+    result.read_ns.insert(result.read_ns.end(), samples.begin(), samples.end());
+  for (size_t i = 0; i < count; i++) {
+    if (dispatched_at[i] != 0)
+      result.dispatch_us.push_back(dispatched_at[i] - arrived_at[i]);
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  const bool quick = bench::is_quick(argc, argv);
+  const uint32_t duration_ms = quick ? 300 : 3000;
+
+  printf("threads available: %u\n", std::thread::hardware_concurrency());
+  printf("%-7s %12s %8s %10s %10s %14s %8s\n", "readers", "reads/s", "failed", "read p50", "read p99",
+         "dispatch p99", "lost");
+  for (uint32_t reader_count : {0, 1, 2, 4}) {
+    SnapshotRun result = run(reader_count, duration_ms);
+    const uint64_t read_p50 = bench::percentile(result.read_ns, 50);
+    const uint64_t read_p99 = bench::percentile(result.read_ns, 99);
+    const uint64_t dispatch_p99 = bench::percentile(result.dispatch_us, 99);
+    printf("%-7u %12.0f %8llu %8lluns %8lluns %12lluus %8zu\n", reader_count, result.reads / (result.elapsed_ns / 1e9),
+           (unsigned long long) result.failed_reads, (unsigned long long) read_p50, (unsigned long long) read_p99,
+           (unsigned long long) dispatch_p99, result.sent - result.dispatch_us.size());
+  }
+  return 0;
+}
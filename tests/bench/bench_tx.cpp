@@ -0,0 +1,97 @@
+// Main loop blocking while a burst of datapoint writes goes out, on the virtual clock with the fake UART's 128 byte
+// TX FIFO. "synchronous" replays the TX path this component had before the buffered one: the whole frame handed to
+// write_array() from loop() once COMMAND_DELAY (10ms) passed since the previous write started, which blocks while
+// the FIFO is full. "buffered" is the lock's own TX path. Deterministic, the numbers do not depend on the host.
+
+#include "bench.h"
+#include "harness.h"
+
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+// ESPHome's default loop interval
+static const uint32_t LOOP_INTERVAL_US = 16000;
+static const uint32_t SYNCHRONOUS_COMMAND_DELAY_MS = 10;
+static const uint8_t RAW_DP = 33;
+
+struct TxRun {
+  uint64_t max_blocked_us;  // longest single loop() stall on the UART
+  uint64_t blocked_us;      // all of them
+  uint64_t sent_us;         // from queueing the burst to the last byte leaving the wire
+};
+
+static std::vector<uint8_t> raw_value(size_t size, size_t i) { return std::vector<uint8_t>(size, (uint8_t) (i + 1)); }
+
+static TxRun run_synchronous(uint32_t baud_rate, size_t value_size, size_t count) {
+  TuyaDoorLockVirtualClock clock;
+  TuyaDoorLockFakeUART uart(&clock, baud_rate);
+  std::vector<std::vector<uint8_t>> queue;
+  for (size_t i = 0; i < count; i++) {
+    queue.push_back(encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::MODULE_SEND_COMMAND,
+                                     encode_raw_datapoint(RAW_DP, raw_value(value_size, i))));
+  }
+
+  const uint64_t started = clock.now_us();
+  uint64_t last_write_us = 0;
+  bool written = false;
+  while (!queue.empty() || uart.tx_in_flight() > 0) {
+    uart.deliver([](uint8_t, uint64_t) {});
+    const uint64_t now = clock.now_us();
+    if (!queue.empty() && (!written || now - last_write_us > SYNCHRONOUS_COMMAND_DELAY_MS * 1000)) {
+      last_write_us = now;
+      written = true;
+      uart.write_array(queue.front().data(), queue.front().size());
+      queue.erase(queue.begin());
+    }
+    clock.advance_us(LOOP_INTERVAL_US);
+  }
+  return TxRun{uart.get_max_blocked_us(), uart.get_blocked_us(), uart.get_tx_line_free_at() - started};
+}
+
+static TxRun run_buffered(uint32_t baud_rate, size_t value_size, size_t count) {
+  TuyaDoorLockHarness bench(nullptr, baud_rate);
+  bench.set_loop_interval_us(LOOP_INTERVAL_US);
+  if (!bench.start())
+    return TxRun{};
+  bench.mcu().report(encode_raw_datapoint(RAW_DP, raw_value(value_size, count)));
+  bench.run_for(1000);
+
+  const uint64_t blocked_before = bench.uart().get_blocked_us();
+  const uint64_t started = bench.clock().now_us();
+  for (size_t i = 0; i < count; i++)
+    bench.lock().set_raw_datapoint_value(RAW_DP, raw_value(value_size, i));
+  uint64_t max_blocked = 0;
+  uint64_t blocked = bench.uart().get_blocked_us();
+  auto &lock = bench.lock();
+  bench.run_until(
+      [&] {
+        const uint64_t now_blocked = bench.uart().get_blocked_us();
+        max_blocked = std::max(max_blocked, now_blocked - blocked);
+        blocked = now_blocked;
+        return lock.command_queue_.empty() &&
+               bench.mcu().count_received(TuyaDoorLockCommandType::MODULE_SEND_COMMAND) >= count;
+      },
+      60000);
+  return TxRun{max_blocked, bench.uart().get_blocked_us() - blocked_before,
+               bench.uart().get_tx_line_free_at() - started};
+}
+
+int main(int argc, char **argv) {
+  const size_t count = bench::is_quick(argc, argv) ? 3 : 10;
+
+  printf("%7s %7s %-12s %14s %14s %10s\n", "baud", "frame", "tx path", "max stall us", "total stall us", "sent ms");
+  for (uint32_t baud_rate : {9600, 115200}) {
+    // 40 byte frames, the usual MODULE_SEND_COMMAND, and frames larger than the FIFO
+    for (size_t value_size : {29, 255}) {
+      const size_t frame_size = 11 + value_size;
+      for (bool buffered : {false, true}) {
+        const TxRun result =
+            buffered ? run_buffered(baud_rate, value_size, count) : run_synchronous(baud_rate, value_size, count);
+        printf("%7u %7zu %-12s %14llu %14llu %10llu\n", baud_rate, frame_size, buffered ? "buffered" : "synchronous",
+               (unsigned long long) result.max_blocked_us, (unsigned long long) result.blocked_us,
+               (unsigned long long) result.sent_us / 1000);
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+// Datapoint writes from several producer threads: the raw MPSC queue, and the public setters drained by
+// apply_writes_() into commands like loop() does. Checks each producer's order and counts writes dropped on a full
+// queue.
+
+#include <thread>
+
+#include "bench.h"
+#include "mpsc_queue.h"
+#include "threaded_lock.h"
+#include "threaded_uart.h"
+
+using namespace esphome;
+using namespace esphome::tuya_door_lock;
+using namespace esphome::tuya_door_lock::testing;
+
+struct IntakeRun {
+  uint64_t elapsed_ns;
+  uint64_t applied;
+  uint64_t dropped;
+  uint64_t out_of_order;
+};
+
+// Producers retry on a full queue, nothing is dropped
+static IntakeRun run_queue(uint32_t producer_count, uint32_t per_producer) {
+  TuyaDoorLockMpscQueue<TuyaDoorLockDatapointWrite> queue(16);
+  std::atomic<uint32_t> done{0};
+  const uint64_t started = bench::wall_ns();
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < producer_count; p++) {
+    producers.emplace_back([&, p] {
+      for (uint32_t i = 0; i < per_producer;) {
+        if (queue.push(TuyaDoorLockDatapointWrite{(uint8_t) p, TuyaDoorLockDatapointType::INTEGER, 4, false, i, {}})) {
+          i++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      done++;
+    });
+  }
+  IntakeRun run{0, 0, 0, 0};
+  std::vector<int64_t> last(producer_count, -1);
+  TuyaDoorLockDatapointWrite write;
+  while (run.applied < (uint64_t) producer_count * per_producer) {
+    if (!queue.pop(write)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if ((int64_t) write.value <= last[write.datapoint_id])
+      run.out_of_order++;
+    last[write.datapoint_id] = write.value;
+    run.applied++;
+  }
+  run.elapsed_ns = bench::wall_ns() - started;
+  for (auto &producer : producers)
+    producer.join();
+  return run;
+}
+
+// Setters as a web server or API task would call them, loop() draining the intake every interval_us
+static IntakeRun run_setters(uint32_t producer_count, uint32_t per_producer, uint32_t interval_us) {
+  TuyaDoorLockThreadedUART uart(115200);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  // Nothing goes out, every applied write lands in command_queue_
+  lock.set_command_delay(UINT32_MAX);
+  std::atomic<uint32_t> done{0};
+  const uint64_t started = bench::wall_ns();
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < producer_count; p++) {
+    producers.emplace_back([&, p] {
+      for (uint32_t i = 0; i < per_producer; i++)
+        lock.set_integer_datapoint_value(100 + p, i);
+      done++;
+    });
+  }
+  IntakeRun run{0, 0, 0, 0};
+  std::vector<int64_t> last(producer_count, -1);
+  while (true) {
+    const bool finished = done == producer_count;
+    lock.apply_writes_();
+    for (const TuyaDoorLockCommand &command : lock.command_queue_) {
+      const uint32_t p = command.payload[0] - 100;
+      const int64_t value =
+          encode_uint32(command.payload[4], command.payload[5], command.payload[6], command.payload[7]);
+      if (value <= last[p])
+        run.out_of_order++;
+      last[p] = value;
+      run.applied++;
+    }
+    lock.command_queue_.clear();
+    if (finished)
+      break;
+    if (interval_us > 0)
+      std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+  }
+  run.elapsed_ns = bench::wall_ns() - started;
+  for (auto &producer : producers)
+    producer.join();
+  run.dropped = lock.write_intake_dropped_.load();
+  return run;
+}
+
+static void print(const char *path, uint32_t producer_count, const IntakeRun &run) {
+  const uint64_t total = run.applied + run.dropped;
+  printf("%-22s %9u %12.0f %9.1f %10llu %12llu\n", path, producer_count, run.applied / (run.elapsed_ns / 1e9),
+         (double) run.elapsed_ns / total, (unsigned long long) run.dropped, (unsigned long long) run.out_of_order);
+}
+
+int main(int argc, char **argv) {
+  const bool quick = bench::is_quick(argc, argv);
+  const uint32_t per_producer = quick ? 2000 : 200000;
+
+  printf("threads available: %u\n", std::thread::hardware_concurrency());
+  printf("%-22s %9s %12s %9s %10s %12s\n", "path", "producers", "writes/s", "ns/write", "dropped", "out of order");
+  uint64_t out_of_order = 0;
+  for (uint32_t producer_count : {1, 2, 4, 8}) {
+    const IntakeRun run = run_queue(producer_count, per_producer);
+    print("queue, retry when full", producer_count, run);
+    out_of_order += run.out_of_order;
+  }
+  for (uint32_t producer_count : {1, 2, 4, 8}) {
+    const IntakeRun run = run_setters(producer_count, per_producer / 10, 0);
+    print("setters, busy loop()", producer_count, run);
+    out_of_order += run.out_of_order;
+  }
+  for (uint32_t producer_count : {1, 2, 4, 8}) {
+    const IntakeRun run = run_setters(producer_count, per_producer / 100, 16000);
+    print("setters, 16ms loop()", producer_count, run);
+    out_of_order += run.out_of_order;
+  }
+  return out_of_order == 0 ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include "fake_uart.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+TuyaDoorLockFakeUART::TuyaDoorLockFakeUART(TuyaDoorLockVirtualClock *clock, uint32_t baud_rate, size_t fifo_size)
+    : clock_(clock), fifo_size_(fifo_size) {
+  this->baud_rate_ = baud_rate;
+}
+
+void TuyaDoorLockFakeUART::write_array(const uint8_t *data, size_t len) {
+  this->write_calls_++;
+  this->written_bytes_ += len;
+  const uint64_t start = this->clock_->now_us();
+  const uint64_t byte_time = this->byte_time_us();
+  for (size_t i = 0; i < len; i++) {
+    // Bytes that started on the wire have left the FIFO
+    size_t waiting = 0;
+    for (auto it = this->tx_.rbegin(); it != this->tx_.rend() && it->at > this->clock_->now_us(); ++it)
+      waiting++;
+    if (waiting >= this->fifo_size_) {
+      // Block until the oldest waiting byte starts on the wire
+      this->clock_->advance_to_us(this->tx_[this->tx_.size() - waiting].at);
+    }
+    const uint64_t at = std::max(this->clock_->now_us(), this->tx_line_free_at_);
+    this->tx_.push_back(TimedByte{at, data[i]});
+    this->tx_line_free_at_ = at + byte_time;
+  }
+  const uint64_t blocked = this->clock_->now_us() - start;
+  this->blocked_us_ += blocked;
+  this->max_blocked_us_ = std::max(this->max_blocked_us_, blocked);
+}
+
+int TuyaDoorLockFakeUART::available() {
+  const uint64_t now = this->clock_->now_us();
+  int count = 0;
+  for (auto &byte : this->rx_) {
+    if (byte.at > now)
+      break;
+    count++;
+  }
+  return count;
+}
+
+bool TuyaDoorLockFakeUART::peek_byte(uint8_t *data) {
+  if (this->available() == 0)
+    return false;
+  *data = this->rx_.front().data;
+  return true;
+}
+
+bool TuyaDoorLockFakeUART::read_array(uint8_t *data, size_t len) {
+  if ((size_t) this->available() < len)
+    return false;
+  for (size_t i = 0; i < len; i++) {
+    data[i] = this->rx_.front().data;
+    this->rx_.pop_front();
+  }
+  return true;
+}
+
+void TuyaDoorLockFakeUART::flush() {
+  // Wait until the last byte has left the wire
+  this->clock_->advance_to_us(this->tx_line_free_at_);
+}
+
+void TuyaDoorLockFakeUART::inject(const uint8_t *data, size_t len) {
+  const uint64_t byte_time = this->byte_time_us();
+  uint64_t at = std::max(this->clock_->now_us(), this->rx_line_free_at_);
+  for (size_t i = 0; i < len; i++) {
+    at += byte_time;
+    this->rx_.push_back(TimedByte{at, data[i]});
+  }
+  this->rx_line_free_at_ = at;
+}
+
+void TuyaDoorLockFakeUART::deliver(const std::function<void(uint8_t, uint64_t)> &sink) {
+  const uint64_t now = this->clock_->now_us();
+  const uint64_t byte_time = this->byte_time_us();
+  while (!this->tx_.empty() && this->tx_.front().at + byte_time <= now) {
+    const TimedByte byte = this->tx_.front();
+    this->tx_.pop_front();
+    sink(byte.data, byte.at + byte_time);
+  }
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "esphome/components/uart/uart.h"
+#include "virtual_clock.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// In-memory 8N1 UART timed by a virtual clock. Written bytes wait in a TX FIFO of fifo_size bytes and leave the
+// wire one byte time apart. write_array() blocks like the ESP-IDF driver when the FIFO is full, which here means it
+// advances the clock until there is room. Injected bytes arrive on the RX line one byte time apart and become
+// available once their stop bit was received.
+class TuyaDoorLockFakeUART : public uart::UARTComponent {
+ public:
+  static const size_t HARDWARE_FIFO_SIZE = 128;
+
+  explicit TuyaDoorLockFakeUART(TuyaDoorLockVirtualClock *clock, uint32_t baud_rate = 9600,
+                                size_t fifo_size = HARDWARE_FIFO_SIZE);
+
+  // 8N1: start bit + 8 data bits + stop bit
+  uint32_t byte_time_us() const { return 10000000 / this->baud_rate_; }
+
+  void write_array(const uint8_t *data, size_t len) override;
+  bool peek_byte(uint8_t *data) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override;
+
+  // Far end: queues bytes on the RX line behind whatever is still arriving
+  void inject(const uint8_t *data, size_t len);
+  void inject(const std::vector<uint8_t> &data) { this->inject(data.data(), data.size()); }
+  // Far end: hands every byte whose stop bit has left the wire to sink, with the time it did
+  void deliver(const std::function<void(uint8_t, uint64_t)> &sink);
+
+  // Bytes handed to write_array() that have not left the wire yet
+  size_t tx_in_flight() const { return this->tx_.size(); }
+  uint64_t get_tx_line_free_at() const { return this->tx_line_free_at_; }
+  uint64_t get_rx_line_free_at() const { return this->rx_line_free_at_; }
+  // Time write_array() spent waiting for FIFO room
+  uint64_t get_blocked_us() const { return this->blocked_us_; }
+  uint64_t get_max_blocked_us() const { return this->max_blocked_us_; }
+  size_t get_write_calls() const { return this->write_calls_; }
+  // Every byte handed to write_array() so far
+  size_t get_written_bytes() const { return this->written_bytes_; }
+
+ protected:
+  void check_logger_conflict() override {}
+
+  struct TimedByte {
+    uint64_t at;  // TX: when the byte starts on the wire, RX: when it was received
+    uint8_t data;
+  };
+
+  TuyaDoorLockVirtualClock *clock_;
+  size_t fifo_size_;
+  std::deque<TimedByte> tx_;
+  std::deque<TimedByte> rx_;
+  uint64_t tx_line_free_at_{0};
+  uint64_t rx_line_free_at_{0};
+  uint64_t blocked_us_{0};
+  uint64_t max_blocked_us_{0};
+  size_t write_calls_{0};
+  size_t written_bytes_{0};
+};
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
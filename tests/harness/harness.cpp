@@ -0,0 +1,54 @@
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+static TuyaDoorLockVirtualClock *own_or(std::unique_ptr<TuyaDoorLockVirtualClock> &own, TuyaDoorLockVirtualClock *clock) {
+  if (clock == nullptr) {
+    own.reset(new TuyaDoorLockVirtualClock());
+    clock = own.get();
+  }
+  return clock;
+}
+
+TuyaDoorLockHarness::TuyaDoorLockHarness(TuyaDoorLockVirtualClock *clock, uint32_t baud_rate)
+    : clock_(own_or(this->own_clock_, clock)),
+      uart_(this->clock_, baud_rate),
+      mcu_(this->clock_, &this->uart_),
+      lock_(this->clock_) {
+  this->lock_.set_uart_parent(&this->uart_);
+}
+
+bool TuyaDoorLockHarness::start(uint32_t timeout_ms) {
+  this->lock_.setup();
+  return this->run_until([this] { return this->lock_.get_init_state() == TuyaDoorLockInitState::INIT_DONE; },
+                         timeout_ms);
+}
+
+void TuyaDoorLockHarness::step() {
+  this->mcu_.poll();
+  TuyaDoorLockTxScheduler::get_instance()->loop();
+  this->lock_.loop();
+  this->clock_->advance_us(this->loop_interval_us_);
+}
+
+void TuyaDoorLockHarness::run_for(uint32_t ms) {
+  const uint64_t until = this->clock_->now_us() + uint64_t(ms) * 1000;
+  while (this->clock_->now_us() < until)
+    this->step();
+}
+
+bool TuyaDoorLockHarness::run_until(const std::function<bool()> &done, uint32_t timeout_ms) {
+  const uint64_t until = this->clock_->now_us() + uint64_t(timeout_ms) * 1000;
+  while (!done()) {
+    if (this->clock_->now_us() >= until)
+      return false;
+    this->step();
+  }
+  return true;
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "fake_uart.h"
+#include "mcu_emulator.h"
+#include "tuya_door_lock.h"
+#include "virtual_clock.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// TuyaDoorLock on the virtual clock, with the internals tests look at made public
+class TuyaDoorLockUnderTest : public TuyaDoorLock {
+ public:
+  explicit TuyaDoorLockUnderTest(TuyaDoorLockVirtualClock *clock) : clock_(clock) {}
+
+  using TuyaDoorLock::capture_byte_;
+  using TuyaDoorLock::collision_count_;
+  using TuyaDoorLock::command_queue_;
+  using TuyaDoorLock::datapoints_;
+  using TuyaDoorLock::get_response_timeout_;
+  using TuyaDoorLock::init_failed_;
+  using TuyaDoorLock::is_rx_idle_;
+  using TuyaDoorLock::last_command_timestamp_;
+  using TuyaDoorLock::pending_responses_;
+  using TuyaDoorLock::recent_frames_;
+  using TuyaDoorLock::recovery_attempts_;
+  using TuyaDoorLock::recovery_backoff_;
+  using TuyaDoorLock::rtt_stats_;
+  using TuyaDoorLock::tx_drain_at_;
+  using TuyaDoorLock::tx_max_blocking_us_;
+
+ protected:
+  uint32_t now_ms_() override { return this->clock_->millis(); }
+  uint32_t now_us_() override { return this->clock_->micros(); }
+
+  TuyaDoorLockVirtualClock *clock_;
+};
+
+// One lock wired to a scripted MCU through a fake UART, all on one virtual clock. step() runs a main loop
+// iteration: the MCU sees what the lock wrote so far and sends what is due, then the lock runs its loop().
+class TuyaDoorLockHarness {
+ public:
+  // Shares clock with other harnesses when given, so several locks can run on one main loop
+  explicit TuyaDoorLockHarness(TuyaDoorLockVirtualClock *clock = nullptr, uint32_t baud_rate = 9600);
+
+  TuyaDoorLockVirtualClock &clock() { return *this->clock_; }
+  TuyaDoorLockFakeUART &uart() { return this->uart_; }
+  TuyaDoorLockMcuEmulator &mcu() { return this->mcu_; }
+  TuyaDoorLockUnderTest &lock() { return this->lock_; }
+
+  // Time between two main loop iterations
+  void set_loop_interval_us(uint32_t loop_interval_us) { this->loop_interval_us_ = loop_interval_us; }
+
+  // Runs setup() and the loop until the product query was answered, false on timeout
+  bool start(uint32_t timeout_ms = 2000);
+  // The MCU side of an iteration, for running several locks on one loop
+  void poll_mcu() { this->mcu_.poll(); }
+  void step();
+  void run_for(uint32_t ms);
+  // Steps until done returns true, false when timeout ms passed first
+  bool run_until(const std::function<bool()> &done, uint32_t timeout_ms);
+
+ protected:
+  std::unique_ptr<TuyaDoorLockVirtualClock> own_clock_;
+  TuyaDoorLockVirtualClock *clock_;
+  TuyaDoorLockFakeUART uart_;
+  TuyaDoorLockMcuEmulator mcu_;
+  TuyaDoorLockUnderTest lock_;
+  uint32_t loop_interval_us_{1000};
+};
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
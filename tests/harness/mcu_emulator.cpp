@@ -0,0 +1,146 @@
+#include "mcu_emulator.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+TuyaDoorLockMcuEmulator::TuyaDoorLockMcuEmulator(TuyaDoorLockVirtualClock *clock, TuyaDoorLockFakeUART *uart)
+    : clock_(clock), uart_(uart) {
+  this->on_command(TuyaDoorLockCommandType::PRODUCT_QUERY,
+                   [](TuyaDoorLockMcuEmulator &mcu, const TuyaDoorLockEmulatedFrame &) {
+                     mcu.send(TuyaDoorLockCommandType::PRODUCT_QUERY,
+                              std::vector<uint8_t>(mcu.product_.begin(), mcu.product_.end()));
+                   });
+}
+
+void TuyaDoorLockMcuEmulator::poll() {
+  this->uart_->deliver([this](uint8_t c, uint64_t at_us) { this->on_byte_(c, at_us); });
+
+  const uint64_t now = this->clock_->now_us();
+  for (auto &report : this->unacked_) {
+    if (report.retries >= this->report_retries_ || now - report.sent_at_us < this->report_timeout_us_)
+      continue;
+    report.retries++;
+    report.sent_at_us = now;
+    this->resent_count_++;
+    this->schedule_(report.command, report.payload, now);
+  }
+  this->unacked_.erase(std::remove_if(this->unacked_.begin(), this->unacked_.end(),
+                                      [this, now](const UnackedReport &report) {
+                                        return report.retries >= this->report_retries_ &&
+                                               now - report.sent_at_us >= this->report_timeout_us_;
+                                      }),
+                       this->unacked_.end());
+
+  // Frames are injected in the order they were scheduled, the fake UART serializes them on the RX line
+  auto due = std::stable_partition(this->scheduled_.begin(), this->scheduled_.end(),
+                                   [now](const ScheduledFrame &frame) { return frame.at_us <= now; });
+  for (auto it = this->scheduled_.begin(); it != due; ++it)
+    this->uart_->inject(it->bytes);
+  this->scheduled_.erase(this->scheduled_.begin(), due);
+}
+
+void TuyaDoorLockMcuEmulator::send(uint8_t command, const std::vector<uint8_t> &payload, uint32_t delay_ms) {
+  this->schedule_(command, payload, this->clock_->now_us() + uint64_t(delay_ms) * 1000);
+}
+
+void TuyaDoorLockMcuEmulator::report(const std::vector<uint8_t> &records, uint32_t delay_ms) {
+  const uint8_t command = static_cast<uint8_t>(TuyaDoorLockCommandType::DATAPOINT_REPORT);
+  this->send(command, records, delay_ms);
+  this->unacked_.push_back(
+      UnackedReport{command, records, this->clock_->now_us() + uint64_t(delay_ms) * 1000, 0});
+}
+
+size_t TuyaDoorLockMcuEmulator::count_received(TuyaDoorLockCommandType command) const {
+  return std::count_if(this->received_.begin(), this->received_.end(), [command](const TuyaDoorLockEmulatedFrame &f) {
+    return f.command == static_cast<uint8_t>(command);
+  });
+}
+
+void TuyaDoorLockMcuEmulator::on_byte_(uint8_t c, uint64_t at_us) {
+  if (this->parser_.feed(c) != TuyaDoorLockParseResult::FRAME)
+    return;
+  const TuyaDoorLockFrame frame = this->parser_.get_frame();
+  TuyaDoorLockEmulatedFrame received{frame.command, std::vector<uint8_t>(frame.data, frame.data + frame.len), at_us};
+  auto drop = this->drops_.find(frame.command);
+  if (drop != this->drops_.end() && drop->second > 0) {
+    drop->second--;
+    this->dropped_count_++;
+    return;
+  }
+  this->received_.push_back(received);
+  this->on_frame_(received);
+}
+
+void TuyaDoorLockMcuEmulator::on_frame_(const TuyaDoorLockEmulatedFrame &frame) {
+  // An ack settles the oldest report of its command
+  if (frame.command == static_cast<uint8_t>(TuyaDoorLockCommandType::DATAPOINT_REPORT) ||
+      frame.command == static_cast<uint8_t>(TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT)) {
+    for (auto it = this->unacked_.begin(); it != this->unacked_.end(); ++it) {
+      if (it->command == frame.command) {
+        this->unacked_.erase(it);
+        break;
+      }
+    }
+  }
+  auto responder = this->responders_.find(frame.command);
+  if (responder != this->responders_.end() && responder->second)
+    responder->second(*this, frame);
+}
+
+void TuyaDoorLockMcuEmulator::schedule_(uint8_t command, const std::vector<uint8_t> &payload, uint64_t at_us) {
+  this->scheduled_.push_back(ScheduledFrame{at_us + this->reply_delay_us_, encode_mcu_frame(command, payload)});
+}
+
+std::vector<uint8_t> encode_bool_datapoint(uint8_t id, bool value) {
+  std::vector<uint8_t> out;
+  const uint8_t data = value;
+  encode_datapoint(id, TuyaDoorLockDatapointType::BOOLEAN, &data, 1, out);
+  return out;
+}
+
+std::vector<uint8_t> encode_int_datapoint(uint8_t id, uint32_t value) {
+  std::vector<uint8_t> out;
+  const uint8_t data[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t) value};
+  encode_datapoint(id, TuyaDoorLockDatapointType::INTEGER, data, 4, out);
+  return out;
+}
+
+std::vector<uint8_t> encode_enum_datapoint(uint8_t id, uint8_t value) {
+  std::vector<uint8_t> out;
+  encode_datapoint(id, TuyaDoorLockDatapointType::ENUM, &value, 1, out);
+  return out;
+}
+
+std::vector<uint8_t> encode_bitmask_datapoint(uint8_t id, uint32_t value) {
+  std::vector<uint8_t> out;
+  const uint8_t data[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t) value};
+  encode_datapoint(id, TuyaDoorLockDatapointType::BITMASK, data, 4, out);
+  return out;
+}
+
+std::vector<uint8_t> encode_raw_datapoint(uint8_t id, const std::vector<uint8_t> &value) {
+  std::vector<uint8_t> out;
+  encode_datapoint(id, TuyaDoorLockDatapointType::RAW, value.data(), value.size(), out);
+  return out;
+}
+
+std::vector<uint8_t> encode_string_datapoint(uint8_t id, const std::string &value) {
+  std::vector<uint8_t> out;
+  encode_datapoint(id, TuyaDoorLockDatapointType::STRING, reinterpret_cast<const uint8_t *>(value.data()),
+                   value.size(), out);
+  return out;
+}
+
+std::vector<uint8_t> encode_mcu_frame(uint8_t command, const std::vector<uint8_t> &payload) {
+  std::vector<uint8_t> out;
+  // The MCU answers with protocol version 3
+  encode_frame(0x03, command, payload.data(), payload.size(), out);
+  return out;
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "fake_uart.h"
+#include "protocol.h"
+#include "virtual_clock.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// A frame the emulator received from the lock
+struct TuyaDoorLockEmulatedFrame {
+  uint8_t command;
+  std::vector<uint8_t> payload;
+  uint64_t at_us;  // when its last byte left the wire
+};
+
+// Scripted Tuya lock MCU on the far end of a TuyaDoorLockFakeUART. Answers the product query out of the box, acks
+// nothing else unless told to, and resends its reports like the real MCU when the lock's ack does not come back.
+// Tests script everything else with on_command(), drop_next() and send().
+class TuyaDoorLockMcuEmulator {
+ public:
+  using Responder = std::function<void(TuyaDoorLockMcuEmulator &, const TuyaDoorLockEmulatedFrame &)>;
+
+  TuyaDoorLockMcuEmulator(TuyaDoorLockVirtualClock *clock, TuyaDoorLockFakeUART *uart);
+
+  // Moves the bytes the lock wrote into the emulator and sends the frames that are due, once per main loop iteration
+  void poll();
+
+  // Replaces the answer to command, a null responder makes the MCU ignore it
+  void on_command(uint8_t command, Responder responder) { this->responders_[command] = std::move(responder); }
+  void on_command(TuyaDoorLockCommandType command, Responder responder) {
+    this->on_command(static_cast<uint8_t>(command), std::move(responder));
+  }
+  // The next count frames of command are lost on the way to the MCU
+  void drop_next(TuyaDoorLockCommandType command, size_t count = 1) {
+    this->drops_[static_cast<uint8_t>(command)] += count;
+  }
+  void set_product(const std::string &product) { this->product_ = product; }
+  // Time the MCU takes to start answering
+  void set_reply_delay_ms(uint32_t reply_delay_ms) { this->reply_delay_us_ = uint64_t(reply_delay_ms) * 1000; }
+  // Reports not acked within timeout ms are resent up to retries times, 0 retries disables resending
+  void set_report_retransmit(uint32_t timeout, uint8_t retries) {
+    this->report_timeout_us_ = uint64_t(timeout) * 1000;
+    this->report_retries_ = retries;
+  }
+
+  // Sends a frame delay_ms from now, after the frames already queued
+  void send(uint8_t command, const std::vector<uint8_t> &payload, uint32_t delay_ms = 0);
+  void send(TuyaDoorLockCommandType command, const std::vector<uint8_t> &payload, uint32_t delay_ms = 0) {
+    this->send(static_cast<uint8_t>(command), payload, delay_ms);
+  }
+  // Sends a DATAPOINT_REPORT with records and resends it until acked
+  void report(const std::vector<uint8_t> &records, uint32_t delay_ms = 0);
+  // Sends raw bytes, framed or not, straight away
+  void send_raw(const std::vector<uint8_t> &bytes) { this->uart_->inject(bytes); }
+
+  const std::vector<TuyaDoorLockEmulatedFrame> &get_received() const { return this->received_; }
+  size_t count_received(TuyaDoorLockCommandType command) const;
+  void clear_received() { this->received_.clear(); }
+  size_t get_dropped_count() const { return this->dropped_count_; }
+  size_t get_resent_count() const { return this->resent_count_; }
+  // Reports still waiting for their ack
+  size_t get_unacked_count() const { return this->unacked_.size(); }
+
+ protected:
+  struct ScheduledFrame {
+    uint64_t at_us;
+    std::vector<uint8_t> bytes;
+  };
+  struct UnackedReport {
+    uint8_t command;
+    std::vector<uint8_t> payload;
+    uint64_t sent_at_us;
+    uint8_t retries;
+  };
+
+  void on_byte_(uint8_t c, uint64_t at_us);
+  void on_frame_(const TuyaDoorLockEmulatedFrame &frame);
+  void schedule_(uint8_t command, const std::vector<uint8_t> &payload, uint64_t at_us);
+
+  TuyaDoorLockVirtualClock *clock_;
+  TuyaDoorLockFakeUART *uart_;
+  TuyaDoorLockFrameParser parser_;
+  std::map<uint8_t, Responder> responders_;
+  std::map<uint8_t, size_t> drops_;
+  std::string product_{R"({"p":"emulatedlock","v":"1.0.0"})"};
+  uint64_t reply_delay_us_{5000};
+  uint64_t report_timeout_us_{500000};
+  uint8_t report_retries_{3};
+  std::vector<ScheduledFrame> scheduled_;
+  std::vector<UnackedReport> unacked_;
+  std::vector<TuyaDoorLockEmulatedFrame> received_;
+  size_t dropped_count_{0};
+  size_t resent_count_{0};
+};
+
+// Datapoint records in the wire layout, for building reports
+std::vector<uint8_t> encode_bool_datapoint(uint8_t id, bool value);
+std::vector<uint8_t> encode_int_datapoint(uint8_t id, uint32_t value);
+std::vector<uint8_t> encode_enum_datapoint(uint8_t id, uint8_t value);
+std::vector<uint8_t> encode_bitmask_datapoint(uint8_t id, uint32_t value);
+std::vector<uint8_t> encode_raw_datapoint(uint8_t id, const std::vector<uint8_t> &value);
+std::vector<uint8_t> encode_string_datapoint(uint8_t id, const std::string &value);
+// A complete frame from the MCU
+std::vector<uint8_t> encode_mcu_frame(uint8_t command, const std::vector<uint8_t> &payload);
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// Non-blocking pseudo terminal master, the slave path goes to a TuyaDoorLockHostUART. -1 when none could be opened.
+inline int open_pty(std::string *slave_path) {
+  const int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0)
+    return -1;
+  if (grantpt(fd) != 0 || unlockpt(fd) != 0 || ptsname(fd) == nullptr) {
+    close(fd);
+    return -1;
+  }
+  *slave_path = ptsname(fd);
+  return fd;
+}
+
+// Reads len bytes from a non-blocking fd, false when they did not all arrive within timeout_ms
+inline bool read_exactly(int fd, uint8_t *data, size_t len, int timeout_ms) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (len > 0) {
+    const ssize_t got = read(fd, data, len);
+    if (got > 0) {
+      data += got;
+      len -= got;
+      continue;
+    }
+    const auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (left.count() < 0)
+      return false;
+    struct pollfd pfd = {fd, POLLIN, 0};
+    poll(&pfd, 1, (int) left.count() + 1);
+  }
+  return true;
+}
+
+// Discards whatever is waiting on a non-blocking fd
+inline void drain(int fd) {
+  uint8_t scratch[256];
+  while (read(fd, scratch, sizeof(scratch)) > 0) {
+  }
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
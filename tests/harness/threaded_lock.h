@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "tuya_door_lock.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// TuyaDoorLock on the real clock. start_rx_task() runs the RX task on a std::thread the way rx_task_core runs it on
+// ESP32: draining the UART and framing off the main loop, handing frames to loop() through the SPSC ring.
+class TuyaDoorLockThreadedUnderTest : public TuyaDoorLock {
+ public:
+  using TuyaDoorLock::apply_writes_;
+  using TuyaDoorLock::command_queue_;
+  using TuyaDoorLock::write_intake_dropped_;
+
+  ~TuyaDoorLockThreadedUnderTest() override { this->stop_rx_task(); }
+
+  void start_rx_task() {
+    this->rx_ring_ = new TuyaDoorLockSpscRing<TuyaDoorLockRxFrame, RX_RING_SIZE>();  // NOLINT
+    this->rx_task_running_ = true;
+    this->rx_thread_ = std::thread([this] {
+      while (this->rx_task_running_.load(std::memory_order_relaxed)) {
+        // One FreeRTOS tick, like vTaskDelay(RX_TASK_IDLE_TICKS)
+        if (!this->rx_task_poll_())
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    });
+  }
+  void stop_rx_task() {
+    if (!this->rx_thread_.joinable())
+      return;
+    this->rx_task_running_ = false;
+    this->rx_thread_.join();
+    delete this->rx_ring_;
+    this->rx_ring_ = nullptr;
+  }
+
+  uint32_t get_rx_dropped_frames() const { return this->rx_dropped_frames_.load(); }
+
+ protected:
+  std::thread rx_thread_;
+  std::atomic<bool> rx_task_running_{false};
+};
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
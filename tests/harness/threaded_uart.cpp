@@ -0,0 +1,80 @@
+#include "threaded_uart.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+TuyaDoorLockThreadedUART::TuyaDoorLockThreadedUART(uint32_t baud_rate, size_t rx_buffer_size)
+    : rx_buffer_size_(rx_buffer_size) {
+  this->baud_rate_ = baud_rate;
+}
+
+uint32_t TuyaDoorLockThreadedUART::send(const std::vector<uint8_t> &data) {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  const uint32_t now = micros();
+  uint32_t at = (int32_t)(this->line_free_at_ - now) > 0 ? this->line_free_at_ : now;
+  for (uint8_t c : data) {
+    at += this->byte_time_us();
+    this->wire_.push_back(TimedByte{at, c});
+  }
+  this->line_free_at_ = at;
+  return at;
+}
+
+void TuyaDoorLockThreadedUART::receive_() {
+  const uint32_t now = micros();
+  while (!this->wire_.empty() && (int32_t)(now - this->wire_.front().at) >= 0) {
+    if (this->rx_.size() < this->rx_buffer_size_) {
+      this->rx_.push_back(this->wire_.front().data);
+    } else {
+      this->overflow_count_++;
+    }
+    this->wire_.pop_front();
+  }
+}
+
+int TuyaDoorLockThreadedUART::available() {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  this->receive_();
+  return this->rx_.size();
+}
+
+bool TuyaDoorLockThreadedUART::peek_byte(uint8_t *data) {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  this->receive_();
+  if (this->rx_.empty())
+    return false;
+  *data = this->rx_.front();
+  return true;
+}
+
+bool TuyaDoorLockThreadedUART::read_array(uint8_t *data, size_t len) {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  this->receive_();
+  if (this->rx_.size() < len)
+    return false;
+  for (size_t i = 0; i < len; i++) {
+    data[i] = this->rx_.front();
+    this->rx_.pop_front();
+  }
+  return true;
+}
+
+void TuyaDoorLockThreadedUART::write_array(const uint8_t *, size_t len) {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  this->written_count_ += len;
+}
+
+size_t TuyaDoorLockThreadedUART::get_overflow_count() {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  return this->overflow_count_;
+}
+
+size_t TuyaDoorLockThreadedUART::get_written_count() {
+  std::lock_guard<std::mutex> guard(this->mutex_);
+  return this->written_count_;
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "esphome/components/uart/uart.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// 8N1 UART on the real clock that any thread can feed while another reads, for running the RX task on a thread.
+// Sent bytes arrive one byte time apart into an RX buffer of rx_buffer_size bytes, like the ESP-IDF driver's;
+// bytes arriving while it is full are lost. Written bytes are only counted.
+class TuyaDoorLockThreadedUART : public uart::UARTComponent {
+ public:
+  // ESPHome's default rx_buffer_size
+  static const size_t DRIVER_RX_BUFFER_SIZE = 256;
+
+  explicit TuyaDoorLockThreadedUART(uint32_t baud_rate = 9600, size_t rx_buffer_size = DRIVER_RX_BUFFER_SIZE);
+
+  uint32_t byte_time_us() const { return 10000000 / this->baud_rate_; }
+
+  // Far end, any thread: queues bytes behind whatever is still arriving, returns micros() when the last one arrives
+  uint32_t send(const std::vector<uint8_t> &data);
+
+  void write_array(const uint8_t *data, size_t len) override;
+  bool peek_byte(uint8_t *data) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override {}
+
+  size_t get_overflow_count();
+  size_t get_written_count();
+
+ protected:
+  void check_logger_conflict() override {}
+  // Moves bytes that arrived by now from the wire into the RX buffer, caller holds mutex_
+  void receive_();
+
+  struct TimedByte {
+    uint32_t at;
+    uint8_t data;
+  };
+
+  std::mutex mutex_;
+  size_t rx_buffer_size_;
+  std::deque<TimedByte> wire_;
+  std::deque<uint8_t> rx_;
+  uint32_t line_free_at_{0};
+  size_t overflow_count_{0};
+  size_t written_count_{0};
+};
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// Time as seen by the locks, the fake UARTs and the MCU emulators of a test. Only moves when advanced, so a test
+// replays the same byte timing on every run.
+class TuyaDoorLockVirtualClock {
+ public:
+  // Starts one second after boot, so nothing looks like it happened at time 0
+  explicit TuyaDoorLockVirtualClock(uint64_t start_us = 1000000) : now_us_(start_us) {}
+
+  uint64_t now_us() const { return this->now_us_; }
+  uint32_t millis() const { return (uint32_t)(this->now_us_ / 1000); }
+  uint32_t micros() const { return (uint32_t) this->now_us_; }
+
+  void advance_us(uint64_t us) { this->now_us_ += us; }
+  void advance_ms(uint32_t ms) { this->now_us_ += uint64_t(ms) * 1000; }
+  // Moves forward to at, never back
+  void advance_to_us(uint64_t at) {
+    if (at > this->now_us_)
+      this->now_us_ = at;
+  }
+
+ protected:
+  uint64_t now_us_;
+};
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  // Like ESPHome, callbacks only run for the first state and for changes
+  void publish_state(bool state) {
+    const bool changed = !this->has_state_ || this->state != state;
+    this->state = state;
+    this->has_state_ = true;
+    if (changed) {
+      for (auto &callback : this->state_callbacks_)
+        callback(state);
+    }
+  }
+  bool has_state() const { return this->has_state_; }
+  void add_on_state_callback(std::function<void(bool)> &&callback) {
+    this->state_callbacks_.push_back(std::move(callback));
+  }
+
+  bool state{false};
+
+ protected:
+  bool has_state_{false};
+  std::vector<std::function<void(bool)>> state_callbacks_;
+};
+
+}  // namespace binary_sensor
+}  // namespace esphome
+
+#define LOG_BINARY_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) { \
+    ESP_LOGCONFIG(TAG, "%s%s", prefix, type); \
+  }
@@ -0,0 +1,10 @@
+#pragma once
+
+namespace esphome {
+namespace network {
+
+// Follows shim::network_connected on the host
+bool is_connected();
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace text {
+
+class Text {
+ public:
+  void publish_state(const std::string &state) { this->state = state; }
+
+  std::string state;
+};
+
+}  // namespace text
+}  // namespace esphome
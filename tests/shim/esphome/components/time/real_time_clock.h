@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "esphome/core/time.h"
+
+namespace esphome {
+namespace time {
+
+// Time source of the host tests, set by the test instead of synchronized
+class RealTimeClock {
+ public:
+  ESPTime now() { return this->now_; }
+  ESPTime utcnow() { return this->utcnow_; }
+  void add_on_time_sync_callback(std::function<void()> callback) { this->callbacks_.push_back(std::move(callback)); }
+
+  void set_time(const ESPTime &now, const ESPTime &utcnow) {
+    this->now_ = now;
+    this->utcnow_ = utcnow;
+  }
+  void synchronize() {
+    for (auto &callback : this->callbacks_)
+      callback();
+  }
+
+ protected:
+  ESPTime now_{};
+  ESPTime utcnow_{};
+  std::vector<std::function<void()>> callbacks_;
+};
+
+}  // namespace time
+}  // namespace esphome
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+
+namespace esphome {
+
+// Automations are not run on the host, a test may attach a callback to see what a trigger fired with
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts... x) {
+    if (this->on_trigger_)
+      this->on_trigger_(x...);
+  }
+  void set_on_trigger(std::function<void(Ts...)> on_trigger) { this->on_trigger_ = std::move(on_trigger); }
+
+ protected:
+  std::function<void(Ts...)> on_trigger_;
+};
+
+template<typename... Ts> class Action {
+ public:
+  virtual ~Action() = default;
+  virtual void play(Ts... x) = 0;
+};
+
+template<typename T> class Parented {
+ public:
+  Parented() = default;
+  Parented(T *parent) : parent_(parent) {}
+  T *get_parent() const { return this->parent_; }
+  void set_parent(T *parent) { this->parent_ = parent; }
+
+ protected:
+  T *parent_{nullptr};
+};
+
+}  // namespace esphome
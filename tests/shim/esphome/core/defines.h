@@ -0,0 +1,3 @@
+#pragma once
+
+// Generated by the ESPHome build, the host tests set USE_HOST and USE_TIME on the command line instead
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+
+class GPIOPin {
+ public:
+  virtual ~GPIOPin() = default;
+  virtual void setup() {}
+  virtual void digital_write(bool value) { this->value_ = value; }
+  virtual bool digital_read() { return this->value_; }
+  virtual std::string dump_summary() const { return "test pin"; }
+
+ protected:
+  bool value_{false};
+};
+
+}  // namespace esphome
+
+#define LOG_PIN(prefix, pin) \
+  if ((pin) != nullptr) { \
+    ESP_LOGCONFIG(TAG, prefix "%s", (pin)->dump_summary().c_str()); \
+  }
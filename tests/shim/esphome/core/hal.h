@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+
+#include "esphome/core/gpio.h"
+
+namespace esphome {
+
+// Monotonic host time, the lock itself reads the harness clock through now_ms_() / now_us_()
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+}  // namespace esphome
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+
+namespace esphome {
+
+struct ESPTime {
+  uint8_t second;
+  uint8_t minute;
+  uint8_t hour;
+  uint8_t day_of_week;  // 1 is Sunday
+  uint8_t day_of_month;
+  uint16_t day_of_year;
+  uint8_t month;
+  uint16_t year;
+  bool is_dst;
+  time_t timestamp;
+
+  bool is_valid() const { return this->year >= 2019; }
+  static ESPTime from_epoch_utc(time_t epoch);
+};
+
+}  // namespace esphome
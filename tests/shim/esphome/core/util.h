@@ -0,0 +1,8 @@
+#pragma once
+
+namespace esphome {
+
+// Follows shim::remote_connected on the host
+bool remote_is_connected();
+
+}  // namespace esphome
@@ -0,0 +1,140 @@
+#include "shim.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "esphome/components/network/util.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/core/time.h"
+#include "esphome/core/util.h"
+
+namespace esphome {
+
+namespace shim {
+
+bool network_connected = true;
+bool remote_connected = true;
+size_t high_frequency_requests = 0;
+size_t logged_warnings = 0;
+std::vector<std::string> *log_lines = nullptr;
+
+}  // namespace shim
+
+static int log_level() {
+  static const int level = [] {
+    const char *env = std::getenv("TUYA_TEST_LOG_LEVEL");
+    return env != nullptr ? std::atoi(env) : 0;
+  }();
+  return level;
+}
+
+void shim_log(int level, const char *tag, int line, const char *format, ...) {
+  if (level <= ESPHOME_LOG_LEVEL_WARN)
+    shim::logged_warnings++;
+  va_list args;
+  va_start(args, format);
+  if (shim::log_lines != nullptr) {
+    char message[1024];
+    va_list copy;
+    va_copy(copy, args);
+    std::vsnprintf(message, sizeof(message), format, copy);
+    va_end(copy);
+    shim::log_lines->push_back(message);
+  }
+  if (level <= log_level()) {
+    static const char LETTERS[] = "?EWICDVV";
+    std::fprintf(stderr, "[%c][%s:%d]: ", LETTERS[level], tag, line);
+    std::vfprintf(stderr, format, args);
+    std::fputc('\n', stderr);
+  }
+  va_end(args);
+}
+
+static std::chrono::steady_clock::time_point start_time() {
+  static const auto start = std::chrono::steady_clock::now();
+  return start;
+}
+
+uint32_t millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time())
+      .count();
+}
+
+uint32_t micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time())
+      .count();
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+std::string format_hex_pretty(const uint8_t *data, size_t length) {
+  if (length == 0)
+    return "";
+  std::string ret;
+  ret.resize(3 * length - 1);
+  for (size_t i = 0; i < length; i++) {
+    ret[3 * i] = format_hex_char(data[i] >> 4);
+    ret[3 * i + 1] = format_hex_char(data[i] & 0x0F);
+    if (i != length - 1)
+      ret[3 * i + 2] = '.';
+  }
+  return ret + " (" + std::to_string(length) + ")";
+}
+
+std::string format_hex_pretty(const std::vector<uint8_t> &data) { return format_hex_pretty(data.data(), data.size()); }
+
+uint32_t random_uint32() {
+  // Fixed seed, a failing test reruns the same jitter
+  static std::mt19937 rng(0x7475);
+  return rng();
+}
+
+void HighFrequencyLoopRequester::start() {
+  if (this->started_)
+    return;
+  this->started_ = true;
+  shim::high_frequency_requests++;
+}
+
+void HighFrequencyLoopRequester::stop() {
+  if (!this->started_)
+    return;
+  this->started_ = false;
+  shim::high_frequency_requests--;
+}
+
+bool HighFrequencyLoopRequester::is_high_frequency() { return shim::high_frequency_requests > 0; }
+
+ESPTime ESPTime::from_epoch_utc(time_t epoch) {
+  struct tm c {};
+  gmtime_r(&epoch, &c);
+  ESPTime res{};
+  res.second = c.tm_sec;
+  res.minute = c.tm_min;
+  res.hour = c.tm_hour;
+  res.day_of_week = c.tm_wday + 1;
+  res.day_of_month = c.tm_mday;
+  res.day_of_year = c.tm_yday + 1;
+  res.month = c.tm_mon + 1;
+  res.year = c.tm_year + 1900;
+  res.is_dst = false;
+  res.timestamp = epoch;
+  return res;
+}
+
+bool remote_is_connected() { return shim::remote_connected; }
+
+namespace network {
+
+bool is_connected() { return shim::network_connected; }
+
+}  // namespace network
+
+}  // namespace esphome
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Knobs of the ESPHome stand-ins, for tests that need a particular environment
+namespace esphome {
+namespace shim {
+
+extern bool network_connected;
+extern bool remote_connected;
+// Requesters currently holding HighFrequencyLoopRequester
+extern size_t high_frequency_requests;
+// Errors and warnings logged so far, counted whatever TUYA_TEST_LOG_LEVEL is
+extern size_t logged_warnings;
+// When set, every message logged is also appended here, formatted and without the level and tag prefix
+extern std::vector<std::string> *log_lines;
+
+}  // namespace shim
+}  // namespace esphome
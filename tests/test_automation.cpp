@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+
+#include "automation.h"
+#include "harness.h"
+#include "shim.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// The conditions below are written the way datapoint_condition_expression() in __init__.py compiles them
+class AutomationTest : public ::testing::Test {
+ protected:
+  void report(const std::vector<uint8_t> &records) {
+    this->bench_.mcu().report(records);
+    ASSERT_TRUE(this->bench_.run_until([this] { return this->bench_.mcu().get_unacked_count() == 0; }, 500));
+  }
+
+  TuyaDoorLockHarness bench_;
+};
+
+TEST_F(AutomationTest, MinAndMax) {
+  TuyaDoorLockIntDatapointUpdateTrigger trigger(&this->bench_.lock(), 8);
+  trigger.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return dp.value_int >= -5 && dp.value_int <= 20; });
+  std::vector<int> fired;
+  trigger.set_on_trigger([&](int value) { fired.push_back(value); });
+  ASSERT_TRUE(this->bench_.start());
+  for (int value : {-6, -5, 0, 20, 21})
+    this->report(encode_int_datapoint(8, value));
+  EXPECT_EQ(fired, (std::vector<int>{-5, 0, 20}));
+}
+
+TEST_F(AutomationTest, EqualsAndIn) {
+  TuyaDoorLockEnumDatapointUpdateTrigger equals(&this->bench_.lock(), 8);
+  equals.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return dp.value_enum == 2u; });
+  TuyaDoorLockEnumDatapointUpdateTrigger in(&this->bench_.lock(), 8);
+  in.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return (dp.value_enum == 1u || dp.value_enum == 3u); });
+  std::vector<uint8_t> fired_equals, fired_in;
+  equals.set_on_trigger([&](uint8_t value) { fired_equals.push_back(value); });
+  in.set_on_trigger([&](uint8_t value) { fired_in.push_back(value); });
+  ASSERT_TRUE(this->bench_.start());
+  for (uint8_t value : {0, 1, 2, 3, 4})
+    this->report(encode_enum_datapoint(8, value));
+  EXPECT_EQ(fired_equals, std::vector<uint8_t>{2});
+  EXPECT_EQ(fired_in, (std::vector<uint8_t>{1, 3}));
+}
+
+TEST_F(AutomationTest, EqualsOnBoolAndString) {
+  TuyaDoorLockBoolDatapointUpdateTrigger on_bool(&this->bench_.lock(), 8);
+  on_bool.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return dp.value_bool == true; });
+  TuyaDoorLockStringDatapointUpdateTrigger on_string(&this->bench_.lock(), 9);
+  on_string.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return dp.value_string == "open"; });
+  std::vector<bool> fired_bool;
+  std::vector<std::string> fired_string;
+  on_bool.set_on_trigger([&](bool value) { fired_bool.push_back(value); });
+  on_string.set_on_trigger([&](const std::string &value) { fired_string.push_back(value); });
+  ASSERT_TRUE(this->bench_.start());
+  this->report(encode_bool_datapoint(8, false));
+  this->report(encode_bool_datapoint(8, true));
+  this->report(encode_string_datapoint(9, "opened"));
+  this->report(encode_string_datapoint(9, "open"));
+  EXPECT_EQ(fired_bool, std::vector<bool>{true});
+  EXPECT_EQ(fired_string, std::vector<std::string>{"open"});
+}
+
+TEST_F(AutomationTest, BitsAllAndAny) {
+  TuyaDoorLockBitmaskDatapointUpdateTrigger all(&this->bench_.lock(), 8);
+  all.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return (dp.value_uint & 0x5u) == 0x5u; });
+  TuyaDoorLockBitmaskDatapointUpdateTrigger any(&this->bench_.lock(), 8);
+  any.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return (dp.value_uint & 0x5u) != 0; });
+  std::vector<uint32_t> fired_all, fired_any;
+  all.set_on_trigger([&](uint32_t value) { fired_all.push_back(value); });
+  any.set_on_trigger([&](uint32_t value) { fired_any.push_back(value); });
+  ASSERT_TRUE(this->bench_.start());
+  for (uint32_t value : {0x0u, 0x1u, 0x2u, 0x5u, 0xFu})
+    this->report(encode_bitmask_datapoint(8, value));
+  EXPECT_EQ(fired_all, (std::vector<uint32_t>{0x5, 0xF}));
+  EXPECT_EQ(fired_any, (std::vector<uint32_t>{0x1, 0x5, 0xF}));
+}
+
+TEST_F(AutomationTest, ChangedOnlyComparesNumericValues) {
+  TuyaDoorLockUIntDatapointUpdateTrigger trigger(&this->bench_.lock(), 8);
+  trigger.set_changed_only(true);
+  std::vector<uint32_t> fired;
+  trigger.set_on_trigger([&](uint32_t value) { fired.push_back(value); });
+  ASSERT_TRUE(this->bench_.start());
+  for (uint32_t value : {7u, 7u, 8u, 7u, 0xFFFFFFFFu, 0xFFFFFFFFu})
+    this->report(encode_int_datapoint(8, value));
+  EXPECT_EQ(fired, (std::vector<uint32_t>{7, 8, 7, 0xFFFFFFFF}));
+}
+
+TEST_F(AutomationTest, ChangedOnlyComparesRawAndStringContents) {
+  TuyaDoorLockRawDatapointUpdateTrigger raw(&this->bench_.lock(), 8);
+  raw.set_changed_only(true);
+  TuyaDoorLockStringDatapointUpdateTrigger string(&this->bench_.lock(), 9);
+  string.set_changed_only(true);
+  size_t fired_raw = 0, fired_string = 0;
+  raw.set_on_trigger([&](const std::vector<uint8_t> &) { fired_raw++; });
+  string.set_on_trigger([&](const std::string &) { fired_string++; });
+  ASSERT_TRUE(this->bench_.start());
+  this->report(encode_raw_datapoint(8, {1, 2, 3}));
+  this->report(encode_raw_datapoint(8, {1, 2, 3}));
+  this->report(encode_raw_datapoint(8, {1, 2, 4}));
+  this->report(encode_string_datapoint(9, "a"));
+  this->report(encode_string_datapoint(9, "a"));
+  this->report(encode_string_datapoint(9, "b"));
+  EXPECT_EQ(fired_raw, 2u);
+  EXPECT_EQ(fired_string, 2u);
+}
+
+TEST_F(AutomationTest, ChangedOnlyRunsBeforeTheCondition) {
+  TuyaDoorLockIntDatapointUpdateTrigger trigger(&this->bench_.lock(), 8);
+  trigger.set_changed_only(true);
+  trigger.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return dp.value_int >= 10; });
+  std::vector<int> fired;
+  trigger.set_on_trigger([&](int value) { fired.push_back(value); });
+  ASSERT_TRUE(this->bench_.start());
+  // A value failing the condition still becomes the previous value
+  for (int value : {10, 5, 10, 10})
+    this->report(encode_int_datapoint(8, value));
+  EXPECT_EQ(fired, (std::vector<int>{10, 10}));
+}
+
+TEST_F(AutomationTest, TypedTriggerWarnsOnceAboutAnotherType) {
+  TuyaDoorLockBoolDatapointUpdateTrigger trigger(&this->bench_.lock(), 8);
+  size_t fired = 0;
+  trigger.set_on_trigger([&](bool) { fired++; });
+  ASSERT_TRUE(this->bench_.start());
+  const size_t warnings = shim::logged_warnings;
+  this->report(encode_int_datapoint(8, 1));
+  this->report(encode_int_datapoint(8, 2));
+  EXPECT_EQ(shim::logged_warnings - warnings, 1u);
+  EXPECT_EQ(fired, 2u);
+}
+
+// datapoint_type any: no type check, the conditions test value_int and value_uint whatever the type
+TEST_F(AutomationTest, AnyTypeSkipsTheTypeCheck) {
+  TuyaDoorLockDatapointUpdateTrigger trigger(&this->bench_.lock(), 8);
+  trigger.set_condition([](TuyaDoorLockDatapoint dp) -> bool { return dp.value_int >= 1 && dp.value_int <= 3; });
+  trigger.set_changed_only(true);
+  std::vector<TuyaDoorLockDatapointType> fired;
+  trigger.set_on_trigger([&](const TuyaDoorLockDatapoint &dp) { fired.push_back(dp.type); });
+  ASSERT_TRUE(this->bench_.start());
+  const size_t warnings = shim::logged_warnings;
+  this->report(encode_int_datapoint(8, 1));
+  // Same value as before, another type
+  this->report(encode_enum_datapoint(8, 1));
+  this->report(encode_bool_datapoint(8, true));
+  this->report(encode_bool_datapoint(8, true));
+  this->report(encode_int_datapoint(8, 4));
+  EXPECT_EQ(shim::logged_warnings, warnings);
+  EXPECT_EQ(fired, (std::vector<TuyaDoorLockDatapointType>{TuyaDoorLockDatapointType::INTEGER,
+                                                           TuyaDoorLockDatapointType::ENUM,
+                                                           TuyaDoorLockDatapointType::BOOLEAN}));
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+#include "harness.h"
+#include "shim.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class CaptureTest : public ::testing::Test {
+ protected:
+  void TearDown() override { shim::log_lines = nullptr; }
+
+  // Entry i of the test pattern, RX and TX alternating
+  void capture(uint32_t i) {
+    this->bench_.lock().capture_byte_(
+        i % 2 ? TuyaDoorLockCaptureDirection::TX : TuyaDoorLockCaptureDirection::RX, 0x01020300 + i, 0xA0 + i);
+  }
+
+  // The dump format of entry i: timestamp little endian, direction, data
+  static std::string record(uint32_t i) {
+    char hex[13];
+    std::snprintf(hex, sizeof(hex), "%02X030201%02X%02X", (uint8_t) i, i % 2, (uint8_t)(0xA0 + i));
+    return hex;
+  }
+
+  // The lines logged by dump_capture()
+  std::vector<std::string> dump() {
+    std::vector<std::string> lines;
+    shim::log_lines = &lines;
+    this->bench_.lock().dump_capture();
+    shim::log_lines = nullptr;
+    return lines;
+  }
+
+  TuyaDoorLockHarness bench_;
+};
+
+TEST_F(CaptureTest, WrappedRingIsDumpedOldestFirst) {
+  this->bench_.lock().set_capture_size(4);
+  // Whatever setup() sends is overwritten by the pattern
+  this->bench_.lock().setup();
+  for (uint32_t i = 0; i < 6; i++)
+    this->capture(i);
+  const std::vector<std::string> lines = this->dump();
+  ASSERT_EQ(lines.size(), 2u);
+  EXPECT_EQ(lines[0], "capture v1 entries=4 baud=9600");
+  // Entries 0 and 1 were overwritten
+  EXPECT_EQ(lines[1], "capture " + record(2) + record(3) + record(4) + record(5));
+}
+
+TEST_F(CaptureTest, SixteenRecordsPerLine) {
+  this->bench_.lock().set_capture_size(20);
+  this->bench_.lock().setup();
+  for (uint32_t i = 0; i < 25; i++)
+    this->capture(i);
+  const std::vector<std::string> lines = this->dump();
+  ASSERT_EQ(lines.size(), 3u);
+  EXPECT_EQ(lines[0], "capture v1 entries=20 baud=9600");
+  std::string first = "capture ", second = "capture ";
+  for (uint32_t i = 5; i < 21; i++)
+    first += record(i);
+  for (uint32_t i = 21; i < 25; i++)
+    second += record(i);
+  EXPECT_EQ(lines[1], first);
+  EXPECT_EQ(lines[2], second);
+}
+
+TEST_F(CaptureTest, RecordsBothDirectionsOfTheWire) {
+  this->bench_.lock().set_capture_size(256);
+  ASSERT_TRUE(this->bench_.start());
+  // Direction and data of every record, without the timestamps
+  std::vector<std::string> bytes;
+  const std::vector<std::string> lines = this->dump();
+  for (size_t i = 1; i < lines.size(); i++) {
+    for (size_t pos = 8; pos + 12 <= lines[i].size(); pos += 12)
+      bytes.push_back(lines[i].substr(pos + 8, 4));
+  }
+  // Our product query, then the MCU's answer
+  const std::vector<std::string> query = {"0155", "01AA", "0100", "0101", "0100", "0100", "0100"};
+  ASSERT_GT(bytes.size(), query.size());
+  EXPECT_EQ(std::vector<std::string>(bytes.begin(), bytes.begin() + query.size()), query);
+  EXPECT_EQ(bytes[query.size()], "0055");
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
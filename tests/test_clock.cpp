@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/time/real_time_clock.h"
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// 2026-10-19 12:00:00
+static const time_t START = 1792411200;
+static const uint8_t RECORD_LOCAL = 0x01;
+static const uint8_t RECORD_GMT = 0x02;
+
+class ClockTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->set_time(START);
+    this->bench_.lock().set_time_id(&this->rtc_);
+    this->bench_.lock().set_en_binary_sensor(&this->en_);
+    this->bench_.lock().set_time_push_threshold(30);
+    ASSERT_TRUE(this->bench_.start());
+  }
+
+  void set_time(time_t now) {
+    this->now_ = now;
+    this->rtc_.set_time(ESPTime::from_epoch_utc(now + this->utc_offset_), ESPTime::from_epoch_utc(now));
+  }
+
+  // Moves our local time zone utc_offset seconds away from GMT
+  void set_time_zone(int utc_offset) {
+    this->utc_offset_ = utc_offset;
+    this->set_time(this->now_);
+  }
+
+  // Lets hours pass on both clocks, with a coarse main loop to keep it quick
+  void advance_hours(uint32_t hours) {
+    this->bench_.set_loop_interval_us(100000);
+    this->bench_.run_for(hours * 3600000);
+    this->bench_.set_loop_interval_us(1000);
+    this->set_time(this->now_ + hours * 3600);
+  }
+
+  // A record report stamped offset seconds away from our local or GMT clock, as flag says
+  void record(int offset, uint8_t flag = RECORD_LOCAL) {
+    const ESPTime stamp = ESPTime::from_epoch_utc(this->now_ + offset + (flag == RECORD_LOCAL ? this->utc_offset_ : 0));
+    std::vector<uint8_t> payload = {flag,
+                                    (uint8_t)(stamp.year - 2000),
+                                    stamp.month,
+                                    stamp.day_of_month,
+                                    stamp.hour,
+                                    stamp.minute,
+                                    stamp.second};
+    const std::vector<uint8_t> records = encode_enum_datapoint(12, 1);
+    payload.insert(payload.end(), records.begin(), records.end());
+    const size_t acks = this->bench_.mcu().count_received(TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT);
+    this->bench_.mcu().send(TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT, payload);
+    this->bench_.run_until(
+        [&] {
+          return this->bench_.mcu().count_received(TuyaDoorLockCommandType::DATAPOINT_RECORD_REPORT) > acks;
+        },
+        1000);
+  }
+
+  void wake() {
+    this->en_.publish_state(true);
+    this->bench_.run_for(100);
+    this->en_.publish_state(false);
+    this->bench_.run_for(5000);
+  }
+
+  TuyaDoorLockHarness bench_;
+  time::RealTimeClock rtc_;
+  binary_sensor::BinarySensor en_;
+  time_t now_{0};
+  int utc_offset_{0};
+};
+
+TEST_F(ClockTest, OffsetFromRecordTimestamp) {
+  this->record(42);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_offset(), 42);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_drift_ppm(), 0);
+  this->record(-3);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_offset(), -3);
+}
+
+TEST_F(ClockTest, RecordFlagSelectsLocalOrGmtClock) {
+  this->set_time_zone(2 * 3600);
+  this->record(42, RECORD_LOCAL);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_offset(), 42);
+  this->record(-3, RECORD_GMT);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_offset(), -3);
+  // Whatever time the MCU asked for last
+  this->bench_.mcu().send(TuyaDoorLockCommandType::GMT_TIME_QUERY, {});
+  this->bench_.run_for(100);
+  this->record(5, RECORD_LOCAL);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_offset(), 5);
+}
+
+TEST_F(ClockTest, RecordWithoutTimeIsNotASample) {
+  this->record(42);
+  this->record(1000, 0x00);
+  EXPECT_EQ(this->bench_.lock().get_mcu_clock_offset(), 42);
+}
+
+TEST_F(ClockTest, PushesTimeAtWakeOnceDriftAddsUp) {
+  this->record(10);
+  this->advance_hours(2);
+  this->record(17);
+  // 7s in 2h of the lock's clock
+  EXPECT_NEAR(this->bench_.lock().get_mcu_clock_drift_ppm(), 972, 2);
+
+  this->wake();
+  EXPECT_EQ(this->bench_.lock().get_time_push_count(), 0u);
+
+  // 4h later the MCU should be 17 + 14 seconds off
+  this->advance_hours(4);
+  this->wake();
+  EXPECT_EQ(this->bench_.lock().get_time_push_count(), 1u);
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::LOCAL_TIME_QUERY), 1u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+TEST(CommandHandlerTest, EveryCommandByteGetsItsOwnHandler) {
+  TuyaDoorLockHarness bench;
+  ASSERT_TRUE(bench.start());
+  std::vector<int> received(256, -1);
+  for (int command = 0; command < 256; command++) {
+    bench.lock().register_command_handler(
+        command, [&received, command](const TuyaDoorLockFrame &frame) { received[command] = frame.command; });
+  }
+  for (int command : {0x00, 0x01, 0x30, 0xFE, 0xFF}) {
+    bench.mcu().send_raw(encode_mcu_frame(command, {}));
+    bench.run_for(20);
+    EXPECT_EQ(received[command], command);
+  }
+  EXPECT_EQ(bench.lock().get_unknown_command_count(), 0u);
+}
+
+TEST(CommandHandlerTest, UnregisteredCommandIsCounted) {
+  TuyaDoorLockHarness bench;
+  ASSERT_TRUE(bench.start());
+  bench.mcu().send_raw(encode_mcu_frame(0x42, {}));
+  bench.run_for(20);
+  EXPECT_EQ(bench.lock().get_unknown_command_count(), 1u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
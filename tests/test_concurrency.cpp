@@ -0,0 +1,325 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "mcu_emulator.h"
+#include "mpsc_queue.h"
+#include "snapshot.h"
+#include "spsc_ring.h"
+#include "threaded_lock.h"
+#include "threaded_uart.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+struct SequencedItem {
+  uint32_t sequence;
+  uint32_t check;  // ~sequence, a torn or stale slot does not match
+};
+
+TEST(SpscRingTest, KeepsOrderAcrossThreads) {
+  static const uint32_t COUNT = 1000000;
+  TuyaDoorLockSpscRing<SequencedItem, 8> ring;
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < COUNT;) {
+      SequencedItem *slot = ring.write_slot();
+      if (slot == nullptr) {
+        std::this_thread::yield();
+        continue;
+      }
+      slot->sequence = i;
+      slot->check = ~i;
+      ring.push();
+      i++;
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t mismatches = 0;
+  while (expected < COUNT) {
+    SequencedItem *slot = ring.front();
+    if (slot == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (slot->sequence != expected || slot->check != ~expected)
+      mismatches++;
+    ring.pop();
+    expected++;
+  }
+  producer.join();
+  EXPECT_EQ(mismatches, 0u);
+  EXPECT_EQ(ring.front(), nullptr);
+}
+
+TEST(SpscRingTest, FullRingRefusesSlots) {
+  TuyaDoorLockSpscRing<SequencedItem, 4> ring;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_NE(ring.write_slot(), nullptr);
+    ring.push();
+  }
+  EXPECT_EQ(ring.write_slot(), nullptr);
+  ring.pop();
+  EXPECT_NE(ring.write_slot(), nullptr);
+}
+
+TEST(RxTaskTest, FramesReachListenersInOrder) {
+  TuyaDoorLockThreadedUART uart(115200);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  std::vector<uint32_t> values;
+  lock.register_listener(1, [&](const TuyaDoorLockDatapoint &dp) { values.push_back(dp.value_uint); });
+  lock.setup();
+  lock.start_rx_task();
+
+  static const uint32_t COUNT = 200;
+  std::thread mcu([&] {
+    for (uint32_t i = 0; i < COUNT; i++) {
+      const uint32_t arrives_at = uart.send(
+          encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_int_datapoint(1, i)));
+      // Bursts of 4 frames
+      if (i % 4 == 3) {
+        while ((int32_t)(micros() - arrives_at) < 0)
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+  });
+  const uint32_t started = millis();
+  while (values.size() < COUNT && millis() - started < 10000) {
+    lock.loop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  }
+  mcu.join();
+  lock.stop_rx_task();
+
+  ASSERT_EQ(values.size(), COUNT);
+  for (uint32_t i = 0; i < COUNT; i++)
+    ASSERT_EQ(values[i], i);
+  EXPECT_EQ(lock.get_rx_dropped_frames(), 0u);
+  EXPECT_EQ(uart.get_overflow_count(), 0u);
+}
+
+struct ProducerItem {
+  uint32_t producer;
+  uint32_t sequence;
+};
+
+TEST(MpscQueueTest, KeepsEachProducersOrder) {
+  static const uint32_t PRODUCERS = 4;
+  static const uint32_t PER_PRODUCER = 250000;
+  TuyaDoorLockMpscQueue<ProducerItem> queue(16);
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([&queue, p] {
+      for (uint32_t i = 0; i < PER_PRODUCER;) {
+        if (queue.push(ProducerItem{p, i})) {
+          i++;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<uint32_t> next(PRODUCERS, 0);
+  uint32_t out_of_order = 0;
+  uint32_t received = 0;
+  ProducerItem item;
+  while (received < PRODUCERS * PER_PRODUCER) {
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item.producer >= PRODUCERS || item.sequence != next[item.producer])
+      out_of_order++;
+    else
+      next[item.producer]++;
+    received++;
+  }
+  for (auto &producer : producers)
+    producer.join();
+  EXPECT_EQ(out_of_order, 0u);
+  EXPECT_EQ(next, std::vector<uint32_t>(PRODUCERS, PER_PRODUCER));
+  EXPECT_FALSE(queue.pop(item));
+}
+
+TEST(MpscQueueTest, FullQueueRefusesPush) {
+  TuyaDoorLockMpscQueue<ProducerItem> queue(4);
+  for (uint32_t i = 0; i < 4; i++)
+    ASSERT_TRUE(queue.push(ProducerItem{0, i}));
+  EXPECT_FALSE(queue.push(ProducerItem{0, 4}));
+  ProducerItem item;
+  ASSERT_TRUE(queue.pop(item));
+  EXPECT_EQ(item.sequence, 0u);
+  EXPECT_TRUE(queue.push(ProducerItem{0, 4}));
+}
+
+TEST(WriteIntakeTest, SettersFromManyThreads) {
+  static const uint32_t PRODUCERS = 4;
+  static const uint32_t PER_PRODUCER = 2000;
+  TuyaDoorLockThreadedUART uart(115200);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  // Nothing goes out, every applied write stays in command_queue_
+  lock.set_command_delay(UINT32_MAX);
+
+  std::atomic<uint32_t> done{0};
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < PRODUCERS; p++) {
+    producers.emplace_back([&lock, &done, p] {
+      for (uint32_t i = 0; i < PER_PRODUCER; i++)
+        lock.set_integer_datapoint_value(100 + p, i);
+      done++;
+    });
+  }
+  // The protocol owner drains the intake into commands while the producers run
+  while (done < PRODUCERS)
+    lock.apply_writes_();
+  for (auto &producer : producers)
+    producer.join();
+  lock.apply_writes_();
+
+  std::vector<int64_t> last(PRODUCERS, -1);
+  uint32_t out_of_order = 0;
+  for (const TuyaDoorLockCommand &command : lock.command_queue_) {
+    // id, type, length (2), value (4)
+    ASSERT_EQ(command.payload.size(), 8u);
+    const uint32_t p = command.payload[0] - 100;
+    const int64_t value = encode_uint32(command.payload[4], command.payload[5], command.payload[6], command.payload[7]);
+    if (p >= PRODUCERS || value <= last[p])
+      out_of_order++;
+    else
+      last[p] = value;
+  }
+  EXPECT_EQ(out_of_order, 0u);
+  EXPECT_GT(lock.command_queue_.size(), 0u);
+  EXPECT_EQ(lock.command_queue_.size() + lock.write_intake_dropped_.load(), PRODUCERS * PER_PRODUCER);
+}
+
+TEST(WriteIntakeTest, WritesFromLoopTaskApplyRightAway) {
+  TuyaDoorLockThreadedUART uart(115200);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  lock.set_command_delay(UINT32_MAX);
+  // More than the write queue holds, as an automation setting many datapoints at once would
+  for (uint8_t id = 1; id <= 40; id++)
+    EXPECT_TRUE(lock.set_integer_datapoint_value(id, id));
+  EXPECT_EQ(lock.command_queue_.size(), 40u);
+  EXPECT_EQ(lock.write_intake_dropped_.load(), 0u);
+}
+
+TEST(WriteIntakeTest, FullIntakeRefusesWritesFromOtherTasks) {
+  TuyaDoorLockThreadedUART uart(115200);
+  TuyaDoorLockThreadedUnderTest lock;
+  lock.set_uart_parent(&uart);
+  lock.set_command_delay(UINT32_MAX);
+  lock.set_write_queue_size(4);
+  std::vector<bool> accepted;
+  std::thread producer([&] {
+    for (uint8_t id = 1; id <= 6; id++)
+      accepted.push_back(lock.set_integer_datapoint_value(id, id));
+  });
+  producer.join();
+  EXPECT_EQ(accepted, (std::vector<bool>{true, true, true, true, false, false}));
+  EXPECT_EQ(lock.write_intake_dropped_.load(), 2u);
+  EXPECT_TRUE(lock.command_queue_.empty());
+
+  lock.apply_writes_();
+  ASSERT_EQ(lock.command_queue_.size(), 4u);
+  EXPECT_EQ(lock.command_queue_.front().payload[0], 1u);
+  EXPECT_EQ(lock.command_queue_.back().payload[0], 4u);
+}
+
+static std::vector<TuyaDoorLockDatapoint> numeric_datapoints(size_t count, uint32_t value) {
+  std::vector<TuyaDoorLockDatapoint> datapoints(count);
+  for (size_t i = 0; i < count; i++) {
+    datapoints[i].id = i + 1;
+    datapoints[i].type = TuyaDoorLockDatapointType::INTEGER;
+    datapoints[i].len = 4;
+    datapoints[i].value_uint = value;
+  }
+  return datapoints;
+}
+
+TEST(SnapshotTest, CopiesDatapointsAndFlags) {
+  TuyaDoorLockStateSnapshot snapshot;
+  std::vector<TuyaDoorLockDatapoint> datapoints = numeric_datapoints(2, 7);
+  TuyaDoorLockDatapoint raw{};
+  raw.id = 33;
+  raw.type = TuyaDoorLockDatapointType::RAW;
+  raw.value_raw = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  raw.len = raw.value_raw.size();
+  datapoints.push_back(raw);
+  snapshot.publish(datapoints, 12, 34, true, false);
+
+  TuyaDoorLockSnapshot out{};
+  ASSERT_TRUE(snapshot.read(out));
+  EXPECT_EQ(out.frame_count, 12u);
+  EXPECT_EQ(out.sequence, 34u);
+  EXPECT_TRUE(out.initialized);
+  EXPECT_FALSE(out.degraded);
+  EXPECT_FALSE(out.truncated);
+  ASSERT_EQ(out.count, 3);
+  EXPECT_EQ(out.datapoints[1].id, 2);
+  EXPECT_EQ(out.datapoints[1].value, 7u);
+  EXPECT_EQ(out.datapoints[2].len, 10);
+  EXPECT_EQ(std::vector<uint8_t>(out.datapoints[2].head, out.datapoints[2].head + 8),
+            std::vector<uint8_t>({1, 2, 3, 4, 5, 6, 7, 8}));
+}
+
+TEST(SnapshotTest, TruncatesPastMaxDatapoints) {
+  const size_t max = TuyaDoorLockSnapshot::MAX_DATAPOINTS;
+  TuyaDoorLockStateSnapshot snapshot;
+  snapshot.publish(numeric_datapoints(max + 8, 1), 1, 0, true, true);
+  TuyaDoorLockSnapshot out{};
+  ASSERT_TRUE(snapshot.read(out));
+  EXPECT_EQ(out.count, max);
+  EXPECT_TRUE(out.truncated);
+  EXPECT_TRUE(out.degraded);
+}
+
+TEST(SnapshotTest, ReadersNeverSeeTornState) {
+  static const uint32_t PUBLISHES = 500000;
+  static const uint32_t READERS = 3;
+  TuyaDoorLockStateSnapshot snapshot;
+  snapshot.publish(numeric_datapoints(1, 0), 0, 0, false, false);
+  std::atomic<bool> writing{true};
+  std::atomic<uint32_t> torn{0};
+  std::atomic<uint32_t> backwards{0};
+  std::atomic<uint32_t> reads{0};
+  std::vector<std::thread> readers;
+  for (uint32_t r = 0; r < READERS; r++) {
+    readers.emplace_back([&] {
+      TuyaDoorLockSnapshot out{};
+      uint32_t last = 0;
+      while (writing.load(std::memory_order_relaxed)) {
+        if (!snapshot.read(out))
+          continue;
+        reads++;
+        // Every publish writes frame_count, sequence and all values as the same number, and count as 1 + number % 32
+        bool consistent = out.sequence == out.frame_count && out.count == 1 + out.frame_count % 32;
+        for (uint8_t i = 0; i < out.count; i++)
+          consistent &= out.datapoints[i].id == i + 1 && out.datapoints[i].value == out.frame_count;
+        if (!consistent)
+          torn++;
+        if (out.frame_count < last)
+          backwards++;
+        last = out.frame_count;
+      }
+    });
+  }
+  for (uint32_t k = 1; k <= PUBLISHES; k++)
+    snapshot.publish(numeric_datapoints(1 + k % 32, k), k, k, true, false);
+  writing = false;
+  for (auto &reader : readers)
+    reader.join();
+
+  EXPECT_EQ(torn, 0u);
+  EXPECT_EQ(backwards, 0u);
+  EXPECT_GT(reads, 0u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class FilterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Identical reports here are new readings, not resends
+    this->bench_.lock().set_retransmit_window(0);
+    this->bench_.lock().register_listener(
+        8, [this](const TuyaDoorLockDatapoint &dp) { this->values_.push_back(dp.value_uint); });
+  }
+
+  void report(uint32_t value) {
+    this->bench_.mcu().report(encode_int_datapoint(8, value));
+    this->bench_.run_until([this] { return this->bench_.mcu().get_unacked_count() == 0; }, 500);
+  }
+
+  TuyaDoorLockHarness bench_;
+  std::vector<uint32_t> values_;
+};
+
+TEST_F(FilterTest, UnchangedAndDeadband) {
+  this->bench_.lock().add_datapoint_filter(8, true, 5, 0);
+  ASSERT_TRUE(this->bench_.start());
+  for (uint32_t value : {100, 100, 103, 110, 108})
+    this->report(value);
+  EXPECT_EQ(this->values_, (std::vector<uint32_t>{100, 110}));
+  EXPECT_EQ(this->bench_.lock().get_unchanged_drop_count(), 1u);
+  EXPECT_EQ(this->bench_.lock().get_deadband_drop_count(), 2u);
+}
+
+TEST_F(FilterTest, ThrottledReportIsDispatchedAfterMinInterval) {
+  this->bench_.lock().add_datapoint_filter(8, false, 0, 1000);
+  ASSERT_TRUE(this->bench_.start());
+  this->report(1);
+  this->report(2);
+  this->report(3);
+  EXPECT_EQ(this->values_, std::vector<uint32_t>{1});
+  EXPECT_EQ(this->bench_.lock().get_throttled_count(), 2u);
+  // Only the latest value is dispatched, once the interval passed on the lock's clock
+  this->bench_.run_for(1000);
+  EXPECT_EQ(this->values_, (std::vector<uint32_t>{1, 3}));
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+TEST(HarnessTest, HandshakeCompletesOnVirtualTime) {
+  TuyaDoorLockHarness bench;
+  const uint64_t started = bench.clock().now_us();
+  ASSERT_TRUE(bench.start());
+  ASSERT_EQ(bench.mcu().count_received(TuyaDoorLockCommandType::PRODUCT_QUERY), 1u);
+  // 7 bytes of query and 38 bytes of answer at 9600 baud, plus the MCU's reply delay
+  const uint64_t elapsed = bench.clock().now_us() - started;
+  EXPECT_GE(elapsed, (7 + 38) * bench.uart().byte_time_us() + 5000);
+  EXPECT_LT(elapsed, 100000u);
+}
+
+TEST(HarnessTest, SameScriptReplaysSameTiming) {
+  uint64_t done_at[2];
+  for (auto &at : done_at) {
+    TuyaDoorLockHarness bench;
+    ASSERT_TRUE(bench.start());
+    at = bench.clock().now_us();
+  }
+  EXPECT_EQ(done_at[0], done_at[1]);
+}
+
+TEST(HarnessTest, ReportIsDispatchedAndAcked) {
+  TuyaDoorLockHarness bench;
+  std::vector<uint32_t> values;
+  bench.lock().register_listener(8, [&](const TuyaDoorLockDatapoint &dp) { values.push_back(dp.value_uint); });
+  ASSERT_TRUE(bench.start());
+
+  bench.mcu().report(encode_int_datapoint(8, 87));
+  ASSERT_TRUE(bench.run_until([&] { return bench.mcu().get_unacked_count() == 0; }, 1000));
+  EXPECT_EQ(values, std::vector<uint32_t>{87});
+  ASSERT_EQ(bench.mcu().count_received(TuyaDoorLockCommandType::DATAPOINT_REPORT), 1u);
+  EXPECT_EQ(bench.mcu().get_received().back().payload, std::vector<uint8_t>{0x00});
+}
+
+TEST(HarnessTest, ReadsOnlyBytesThatArrived) {
+  TuyaDoorLockHarness bench;
+  ASSERT_TRUE(bench.start());
+  const std::vector<uint8_t> frame = encode_mcu_frame(0x05, encode_bool_datapoint(1, true));
+  bench.uart().inject(frame);
+  EXPECT_EQ(bench.uart().available(), 0);
+  bench.clock().advance_us(3 * bench.uart().byte_time_us());
+  EXPECT_EQ(bench.uart().available(), 3);
+  bench.clock().advance_us(frame.size() * bench.uart().byte_time_us());
+  EXPECT_EQ(bench.uart().available(), (int) frame.size());
+}
+
+TEST(HarnessTest, FullFifoBlocksWriter) {
+  TuyaDoorLockVirtualClock clock;
+  TuyaDoorLockFakeUART uart(&clock, 9600, 16);
+  const std::vector<uint8_t> data(20, 0xAA);
+  const uint64_t started = clock.now_us();
+  uart.write_array(data.data(), data.size());
+  // The first byte goes straight into the shift register and 16 fill the FIFO, the last 3 wait for room
+  EXPECT_EQ(clock.now_us() - started, 3 * uart.byte_time_us());
+  EXPECT_EQ(uart.get_max_blocked_us(), 3 * uart.byte_time_us());
+}
+
+TEST(HarnessTest, LostQueryIsRetried) {
+  TuyaDoorLockHarness bench;
+  bench.mcu().drop_next(TuyaDoorLockCommandType::PRODUCT_QUERY);
+  ASSERT_TRUE(bench.start());
+  EXPECT_EQ(bench.mcu().get_dropped_count(), 1u);
+  EXPECT_EQ(bench.lock().get_retry_count(), 1u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
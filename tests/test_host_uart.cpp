@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <thread>
+
+#include "host_uart.h"
+#include "mcu_emulator.h"
+#include "pty.h"
+#include "shim.h"
+#include "tuya_door_lock.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+// The ports register with the process wide event loop and are never closed, so they are leaked on purpose
+class HostUARTTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    std::string path;
+    this->tty_ = open_pty(&path);
+    ASSERT_GE(this->tty_, 0);
+    this->uart_ = new TuyaDoorLockHostUART();  // NOLINT
+    this->uart_->set_device(path);
+    this->uart_->setup();
+    ASSERT_FALSE(this->uart_->is_failed());
+  }
+
+  // Runs the event loop until the port has data, like the main loop would
+  int wait_available() {
+    for (int i = 0; i < 100; i++) {
+      TuyaDoorLockHostEventLoop::get_instance()->loop();
+      const int available = this->uart_->available();
+      if (available > 0)
+        return available;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return 0;
+  }
+
+  // Main loop iterations for ms, until done returns true
+  bool pump(uint32_t ms, const std::function<bool()> &done) {
+    for (uint32_t i = 0; i < ms; i++) {
+      TuyaDoorLockHostEventLoop::get_instance()->loop();
+      this->uart_->loop();
+      this->uart_->available();
+      if (done())
+        return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+
+  int tty_{-1};
+  TuyaDoorLockHostUART *uart_{nullptr};
+};
+
+TEST_F(HostUARTTest, ReadsOnlyAfterEventLoopReportsData) {
+  const std::vector<uint8_t> sent = {0x55, 0xAA, 0x03, 0x00};
+  ASSERT_EQ(write(this->tty_, sent.data(), sent.size()), (ssize_t) sent.size());
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(this->uart_->available(), 0);
+
+  ASSERT_EQ(this->wait_available(), (int) sent.size());
+  std::vector<uint8_t> received(sent.size());
+  ASSERT_TRUE(this->uart_->read_array(received.data(), received.size()));
+  EXPECT_EQ(received, sent);
+  EXPECT_EQ(this->uart_->available(), 0);
+}
+
+TEST_F(HostUARTTest, WritesReachTheTty) {
+  const std::vector<uint8_t> sent(300, 0x5A);
+  this->uart_->write_array(sent.data(), sent.size());
+  this->uart_->flush();
+  std::vector<uint8_t> received(sent.size());
+  ASSERT_TRUE(read_exactly(this->tty_, received.data(), received.size(), 1000));
+  EXPECT_EQ(received, sent);
+}
+
+TEST_F(HostUARTTest, LockDispatchesFramesFromTheTty) {
+  TuyaDoorLock lock;
+  lock.set_uart_parent(this->uart_);
+  std::vector<uint32_t> values;
+  lock.register_listener(1, [&](const TuyaDoorLockDatapoint &dp) { values.push_back(dp.value_uint); });
+  lock.setup();
+
+  const std::vector<uint8_t> frame =
+      encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_int_datapoint(1, 1234));
+  ASSERT_EQ(write(this->tty_, frame.data(), frame.size()), (ssize_t) frame.size());
+  ASSERT_GT(this->wait_available(), 0);
+  lock.loop();
+  EXPECT_EQ(values, std::vector<uint32_t>{1234});
+}
+
+TEST_F(HostUARTTest, HangupClosesPortAndWarnsOnce) {
+  const size_t warnings = shim::logged_warnings;
+  // Like unplugging the adapter, reads on the port fail with EIO from now on
+  close(this->tty_);
+  ASSERT_TRUE(this->pump(1000, [this] { return !this->uart_->is_open(); }));
+  this->pump(100, [] { return false; });
+  EXPECT_EQ(shim::logged_warnings - warnings, 1u);
+  EXPECT_EQ(this->uart_->available(), 0);
+}
+
+TEST_F(HostUARTTest, ReopensOnceDeviceIsBack) {
+  // The device path is a link that can be pointed at a new pty, like udev recreating the adapter's node
+  char dir[] = "/tmp/tuya_door_lock_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  const std::string link = std::string(dir) + "/ttyUSB0";
+  std::string path;
+  int tty = open_pty(&path);
+  ASSERT_EQ(symlink(path.c_str(), link.c_str()), 0);
+  this->uart_ = new TuyaDoorLockHostUART();  // NOLINT
+  this->uart_->set_device(link);
+  this->uart_->setup();
+  ASSERT_TRUE(this->uart_->is_open());
+
+  close(tty);
+  ASSERT_TRUE(this->pump(1000, [this] { return !this->uart_->is_open(); }));
+  tty = open_pty(&path);
+  unlink(link.c_str());
+  ASSERT_EQ(symlink(path.c_str(), link.c_str()), 0);
+  ASSERT_TRUE(this->pump(3000, [this] { return this->uart_->is_open(); }));
+
+  const std::vector<uint8_t> sent = {0x55, 0xAA, 0x03};
+  ASSERT_EQ(write(tty, sent.data(), sent.size()), (ssize_t) sent.size());
+  ASSERT_EQ(this->wait_available(), (int) sent.size());
+  unlink(link.c_str());
+  rmdir(dir);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
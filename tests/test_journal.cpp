@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class JournalTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->bench_.lock().set_journal_size(4);
+    ASSERT_TRUE(this->bench_.start());
+  }
+
+  void report(const std::vector<uint8_t> &records) {
+    this->bench_.mcu().report(records);
+    this->bench_.run_until([this] { return this->bench_.mcu().get_unacked_count() == 0; }, 1000);
+  }
+
+  TuyaDoorLockHarness bench_;
+};
+
+TEST_F(JournalTest, LongValuesAreMarkedTruncated) {
+  const std::vector<uint8_t> long_raw = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12};
+  this->report(encode_raw_datapoint(21, {1, 2, 3}));
+  this->report(encode_raw_datapoint(21, long_raw));
+  this->report(encode_string_datapoint(22, "a long string value"));
+
+  std::vector<TuyaDoorLockJournalEntry> changes;
+  ASSERT_TRUE(this->bench_.lock().read_changes_since(0, changes));
+  ASSERT_EQ(changes.size(), 3u);
+  EXPECT_FALSE(changes[0].truncated);
+  EXPECT_TRUE(changes[1].truncated);
+  EXPECT_EQ(changes[1].datapoint.len, long_raw.size());
+  EXPECT_TRUE(changes[2].truncated);
+
+  TuyaDoorLockDatapoint datapoint{};
+  ASSERT_TRUE(this->bench_.lock().get_datapoint(21, datapoint));
+  EXPECT_EQ(datapoint.value_raw, long_raw);
+  ASSERT_TRUE(this->bench_.lock().get_datapoint(22, datapoint));
+  EXPECT_EQ(datapoint.value_string, "a long string value");
+  EXPECT_FALSE(this->bench_.lock().get_datapoint(23, datapoint));
+}
+
+TEST_F(JournalTest, TimestampsFollowLockClock) {
+  this->report(encode_int_datapoint(8, 1));
+  const uint32_t first = this->bench_.clock().millis();
+  this->bench_.run_for(5000);
+  this->report(encode_int_datapoint(8, 2));
+
+  std::vector<TuyaDoorLockJournalEntry> changes;
+  ASSERT_TRUE(this->bench_.lock().read_changes_since(0, changes));
+  ASSERT_EQ(changes.size(), 2u);
+  EXPECT_LE(changes[0].timestamp, first);
+  EXPECT_GE(changes[1].timestamp - changes[0].timestamp, 5000u);
+}
+
+TEST_F(JournalTest, OverwrittenChangesNeedResync) {
+  for (uint32_t value = 1; value <= 6; value++)
+    this->report(encode_int_datapoint(8, value));
+  std::vector<TuyaDoorLockJournalEntry> changes;
+  EXPECT_FALSE(this->bench_.lock().read_changes_since(1, changes));
+  ASSERT_TRUE(this->bench_.lock().read_changes_since(2, changes));
+  ASSERT_EQ(changes.size(), 4u);
+  EXPECT_EQ(changes.back().datapoint.value, 6u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
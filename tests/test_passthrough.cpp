@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+#include "shim.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class PassthroughTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->bench_.lock().set_passthrough_uart(&this->module_);
+    this->requests_before_ = shim::high_frequency_requests;
+    this->bench_.lock().setup();
+  }
+
+  std::vector<uint8_t> module_received() {
+    std::vector<uint8_t> bytes;
+    this->module_.deliver([&](uint8_t c, uint64_t) { bytes.push_back(c); });
+    return bytes;
+  }
+
+  TuyaDoorLockHarness bench_;
+  TuyaDoorLockFakeUART module_{&this->bench_.clock()};
+  size_t requests_before_{0};
+};
+
+TEST_F(PassthroughTest, RequestsHighFrequencyLoop) {
+  EXPECT_EQ(shim::high_frequency_requests, this->requests_before_ + 1);
+}
+
+TEST_F(PassthroughTest, LeavesTheHandshakeToTheModule) {
+  this->bench_.run_for(1000);
+  EXPECT_TRUE(this->bench_.mcu().get_received().empty());
+  EXPECT_TRUE(this->bench_.lock().command_queue_.empty());
+  EXPECT_EQ(this->bench_.lock().get_init_state(), TuyaDoorLockInitState::INIT_LISTEN_ENABLE_PIN);
+  // The MCU answering the module's product query
+  this->bench_.mcu().send(TuyaDoorLockCommandType::PRODUCT_QUERY, {'{', '}'});
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->bench_.lock().get_init_state(), TuyaDoorLockInitState::INIT_DONE);
+  EXPECT_TRUE(this->bench_.mcu().get_received().empty());
+}
+
+TEST_F(PassthroughTest, ForwardsMcuFramesAndDecodesThem) {
+  std::vector<bool> values;
+  this->bench_.lock().register_listener(1, [&](const TuyaDoorLockDatapoint &dp) { values.push_back(dp.value_bool); });
+  const std::vector<uint8_t> report = encode_bool_datapoint(1, true);
+  this->bench_.mcu().send(TuyaDoorLockCommandType::DATAPOINT_REPORT, report);
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->module_received(),
+            encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, report));
+  EXPECT_EQ(values, std::vector<bool>{true});
+}
+
+TEST_F(PassthroughTest, ForwardsModuleFramesAndDecodesThem) {
+  std::vector<uint32_t> values;
+  this->bench_.lock().register_listener(2, [&](const TuyaDoorLockDatapoint &dp) { values.push_back(dp.value_uint); });
+  this->module_.inject(
+      encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::MODULE_SEND_COMMAND, encode_int_datapoint(2, 42)));
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::MODULE_SEND_COMMAND), 1u);
+  EXPECT_EQ(values, std::vector<uint32_t>{42});
+}
+
+TEST_F(PassthroughTest, ModuleWritesArePublishedInTheSnapshot) {
+  this->module_.inject(
+      encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::MODULE_SEND_COMMAND, encode_int_datapoint(2, 42)));
+  this->bench_.run_for(50);
+  TuyaDoorLockSnapshot snapshot;
+  ASSERT_TRUE(this->bench_.lock().read_snapshot(snapshot));
+  ASSERT_EQ(snapshot.count, 1);
+  EXPECT_EQ(snapshot.datapoints[0].id, 2);
+  EXPECT_EQ(snapshot.datapoints[0].value, 42u);
+  EXPECT_EQ(snapshot.sequence, this->bench_.lock().get_journal_sequence());
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "protocol.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+
+static std::vector<TuyaDoorLockParseResult> feed_all(TuyaDoorLockFrameParser &parser,
+                                                     const std::vector<uint8_t> &bytes) {
+  std::vector<TuyaDoorLockParseResult> results;
+  for (uint8_t c : bytes)
+    results.push_back(parser.feed(c));
+  return results;
+}
+
+static std::vector<uint8_t> frame(uint8_t command, const std::vector<uint8_t> &payload) {
+  std::vector<uint8_t> out;
+  encode_frame(0x03, command, payload.data(), payload.size(), out);
+  return out;
+}
+
+TEST(FrameParserTest, IdleAgainOnceFrameIsComplete) {
+  TuyaDoorLockFrameParser parser;
+  EXPECT_TRUE(parser.is_idle());
+  const std::vector<uint8_t> bytes = frame(0x05, {0x01, 0x02});
+  feed_all(parser, std::vector<uint8_t>(bytes.begin(), bytes.end() - 1));
+  EXPECT_FALSE(parser.is_idle());
+  EXPECT_EQ(parser.feed(bytes.back()), TuyaDoorLockParseResult::FRAME);
+  EXPECT_TRUE(parser.is_idle());
+}
+
+TEST(FrameParserTest, ParsesFrameFields) {
+  TuyaDoorLockFrameParser parser;
+  const std::vector<uint8_t> bytes = frame(0x07, {0x10, 0x01, 0x00, 0x01, 0x01});
+  const std::vector<TuyaDoorLockParseResult> results = feed_all(parser, bytes);
+  for (size_t i = 0; i + 1 < results.size(); i++)
+    EXPECT_EQ(results[i], TuyaDoorLockParseResult::INCOMPLETE) << "byte " << i;
+  ASSERT_EQ(results.back(), TuyaDoorLockParseResult::FRAME);
+  const TuyaDoorLockFrame parsed = parser.get_frame();
+  EXPECT_EQ(parsed.version, 0x03);
+  EXPECT_EQ(parsed.command, 0x07);
+  ASSERT_EQ(parsed.len, 5u);
+  EXPECT_EQ(std::vector<uint8_t>(parsed.data, parsed.data + parsed.len),
+            std::vector<uint8_t>({0x10, 0x01, 0x00, 0x01, 0x01}));
+}
+
+TEST(FrameParserTest, ParsesEmptyAndLongPayloads) {
+  TuyaDoorLockFrameParser parser;
+  EXPECT_EQ(feed_all(parser, frame(0x00, {})).back(), TuyaDoorLockParseResult::FRAME);
+  EXPECT_EQ(parser.get_frame().len, 0u);
+
+  // Length above 255 uses both length bytes
+  std::vector<uint8_t> payload(300);
+  for (size_t i = 0; i < payload.size(); i++)
+    payload[i] = (uint8_t) i;
+  EXPECT_EQ(feed_all(parser, frame(0x07, payload)).back(), TuyaDoorLockParseResult::FRAME);
+  const TuyaDoorLockFrame parsed = parser.get_frame();
+  EXPECT_EQ(std::vector<uint8_t>(parsed.data, parsed.data + parsed.len), payload);
+}
+
+TEST(FrameParserTest, ChecksumMismatchResets) {
+  TuyaDoorLockFrameParser parser;
+  std::vector<uint8_t> bytes = frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x01});
+  const uint8_t expected = bytes.back();
+  bytes.back() ^= 0xFF;
+  EXPECT_EQ(feed_all(parser, bytes).back(), TuyaDoorLockParseResult::BAD_CHECKSUM);
+  EXPECT_EQ(parser.get_received_checksum(), (uint8_t) (expected ^ 0xFF));
+  EXPECT_EQ(parser.get_calculated_checksum(), expected);
+  EXPECT_TRUE(parser.is_idle());
+
+  // The next frame parses normally
+  EXPECT_EQ(feed_all(parser, frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x00})).back(), TuyaDoorLockParseResult::FRAME);
+}
+
+TEST(FrameParserTest, CorruptPayloadFailsChecksum) {
+  TuyaDoorLockFrameParser parser;
+  std::vector<uint8_t> bytes = frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x01});
+  bytes[8] ^= 0x01;
+  EXPECT_EQ(feed_all(parser, bytes).back(), TuyaDoorLockParseResult::BAD_CHECKSUM);
+}
+
+TEST(FrameParserTest, ResyncsAfterGarbage) {
+  TuyaDoorLockFrameParser parser;
+  const std::vector<uint8_t> good = frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x01});
+  std::vector<uint8_t> bytes = {0x00, 0xAA, 0x12, 0x55, 0x13, 0xFF};
+  bytes.insert(bytes.end(), good.begin(), good.end());
+  const std::vector<TuyaDoorLockParseResult> results = feed_all(parser, bytes);
+  for (size_t i = 0; i < 6; i++) {
+    // The stray 0x55 is taken as a frame start until the next byte
+    const TuyaDoorLockParseResult expected =
+        i == 3 ? TuyaDoorLockParseResult::INCOMPLETE : TuyaDoorLockParseResult::BAD_HEADER;
+    EXPECT_EQ(results[i], expected) << "byte " << i;
+  }
+  EXPECT_EQ(results.back(), TuyaDoorLockParseResult::FRAME);
+  EXPECT_EQ(parser.get_frame().command, 0x07);
+}
+
+TEST(FrameParserTest, RepeatedHeaderStartsNextFrame) {
+  TuyaDoorLockFrameParser parser;
+  std::vector<uint8_t> bytes = {0x55};
+  const std::vector<uint8_t> good = frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x01});
+  bytes.insert(bytes.end(), good.begin(), good.end());
+  const std::vector<TuyaDoorLockParseResult> results = feed_all(parser, bytes);
+  EXPECT_EQ(results[1], TuyaDoorLockParseResult::BAD_HEADER);
+  EXPECT_EQ(results[2], TuyaDoorLockParseResult::INCOMPLETE);
+  EXPECT_EQ(results.back(), TuyaDoorLockParseResult::FRAME);
+}
+
+TEST(FrameParserTest, TruncatedFrameIsDroppedByReset) {
+  TuyaDoorLockFrameParser parser;
+  const std::vector<uint8_t> bytes = frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x01});
+  feed_all(parser, std::vector<uint8_t>(bytes.begin(), bytes.begin() + 7));
+  EXPECT_FALSE(parser.is_idle());
+  parser.reset();
+  EXPECT_TRUE(parser.is_idle());
+  EXPECT_EQ(feed_all(parser, bytes).back(), TuyaDoorLockParseResult::FRAME);
+}
+
+TEST(FrameParserTest, BackToBackFrames) {
+  TuyaDoorLockFrameParser parser;
+  std::vector<uint8_t> bytes = frame(0x07, {0x01, 0x01, 0x00, 0x01, 0x01});
+  const std::vector<uint8_t> second = frame(0x1C, {0x18, 0x0A, 0x13});
+  bytes.insert(bytes.end(), second.begin(), second.end());
+  size_t frames = 0;
+  std::vector<uint8_t> commands;
+  for (uint8_t c : bytes) {
+    if (parser.feed(c) == TuyaDoorLockParseResult::FRAME) {
+      frames++;
+      commands.push_back(parser.get_frame().command);
+    }
+  }
+  EXPECT_EQ(frames, 2u);
+  EXPECT_EQ(commands, std::vector<uint8_t>({0x07, 0x1C}));
+}
+
+TEST(DecodeDatapointTest, DecodesEachType) {
+  std::vector<uint8_t> buffer;
+  const uint8_t int_value[] = {0x00, 0x00, 0x01, 0x2C};
+  encode_datapoint(2, TuyaDoorLockDatapointType::INTEGER, int_value, sizeof(int_value), buffer);
+  const uint8_t raw_value[] = {0xDE, 0xAD, 0xBE};
+  encode_datapoint(3, TuyaDoorLockDatapointType::RAW, raw_value, sizeof(raw_value), buffer);
+
+  TuyaDoorLockDatapoint datapoint{};
+  size_t consumed = 0;
+  ASSERT_EQ(decode_datapoint(buffer.data(), buffer.size(), datapoint, consumed), TuyaDoorLockDecodeResult::OK);
+  EXPECT_EQ(datapoint.id, 2);
+  EXPECT_EQ(datapoint.value_int, 300);
+  EXPECT_EQ(consumed, 8u);
+  ASSERT_EQ(decode_datapoint(buffer.data() + consumed, buffer.size() - consumed, datapoint, consumed),
+            TuyaDoorLockDecodeResult::OK);
+  EXPECT_EQ(datapoint.id, 3);
+  EXPECT_EQ(datapoint.value_raw, std::vector<uint8_t>({0xDE, 0xAD, 0xBE}));
+}
+
+TEST(DecodeDatapointTest, RejectsTruncatedAndBadLength) {
+  TuyaDoorLockDatapoint datapoint{};
+  size_t consumed = 0;
+  const uint8_t truncated[] = {0x01, 0x01, 0x00, 0x01};
+  EXPECT_EQ(decode_datapoint(truncated, sizeof(truncated), datapoint, consumed), TuyaDoorLockDecodeResult::TRUNCATED);
+  const uint8_t bad_length[] = {0x01, 0x01, 0x00, 0x02, 0x01, 0x00};
+  EXPECT_EQ(decode_datapoint(bad_length, sizeof(bad_length), datapoint, consumed),
+            TuyaDoorLockDecodeResult::BAD_LENGTH);
+  const uint8_t unknown[] = {0x01, 0x09, 0x00, 0x01, 0x01};
+  EXPECT_EQ(decode_datapoint(unknown, sizeof(unknown), datapoint, consumed), TuyaDoorLockDecodeResult::UNKNOWN_TYPE);
+}
+
+}  // namespace tuya_door_lock
+}  // namespace esphome
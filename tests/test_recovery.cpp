@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class RecoveryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // A silent MCU, until a test lets it answer again
+    this->bench_.mcu().on_command(TuyaDoorLockCommandType::PRODUCT_QUERY, nullptr);
+    this->bench_.lock().setup();
+  }
+
+  bool run_until_failed() {
+    return this->bench_.run_until([this] { return this->bench_.lock().init_failed_; }, 30000);
+  }
+
+  TuyaDoorLockHarness bench_;
+};
+
+TEST_F(RecoveryTest, MaxRetriesCountsEveryAttempt) {
+  ASSERT_TRUE(this->run_until_failed());
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::PRODUCT_QUERY), 5u);
+  EXPECT_TRUE(this->bench_.lock().is_degraded());
+}
+
+TEST_F(RecoveryTest, FramesDoNotProbeBeforeBackoff) {
+  ASSERT_TRUE(this->run_until_failed());
+  const size_t queries = this->bench_.mcu().count_received(TuyaDoorLockCommandType::PRODUCT_QUERY);
+  const uint32_t backoff = this->bench_.lock().recovery_backoff_;
+  // The MCU keeps reporting without answering our query
+  for (uint32_t at = 100; at < backoff - 200; at += 100)
+    this->bench_.mcu().send(TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_bool_datapoint(1, true), at);
+  this->bench_.run_for(backoff - 100);
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::PRODUCT_QUERY), queries);
+  EXPECT_EQ(this->bench_.lock().recovery_attempts_, 0u);
+  this->bench_.run_for(200);
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::PRODUCT_QUERY), queries + 1);
+  EXPECT_EQ(this->bench_.lock().recovery_attempts_, 1u);
+}
+
+TEST_F(RecoveryTest, RecoversAndKeepsDegradedTime) {
+  ASSERT_TRUE(this->run_until_failed());
+  this->bench_.run_for(1000);
+  this->bench_.mcu().on_command(TuyaDoorLockCommandType::PRODUCT_QUERY,
+                                [](TuyaDoorLockMcuEmulator &mcu, const TuyaDoorLockEmulatedFrame &) {
+                                  mcu.send(TuyaDoorLockCommandType::PRODUCT_QUERY, {'{', '}'});
+                                });
+  ASSERT_TRUE(this->bench_.run_until([this] { return !this->bench_.lock().is_degraded(); }, 20000));
+  const uint32_t degraded = this->bench_.lock().get_degraded_time();
+  EXPECT_GE(degraded, 1000u);
+  this->bench_.run_for(1000);
+  EXPECT_EQ(this->bench_.lock().get_degraded_time(), degraded);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class RetransmitTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->bench_.lock().register_listener(
+        1, [this](const TuyaDoorLockDatapoint &dp) { this->dispatched_.push_back(dp.value_bool); });
+    this->bench_.lock().set_retransmit_window(1000);
+    ASSERT_TRUE(this->bench_.start());
+    this->bench_.mcu().set_report_retransmit(300, 3);
+  }
+
+  // Injects the same report when at_ms since the first one arrived, the lock sees it on the next loop iteration
+  void inject_report_at(uint32_t at_ms) {
+    const std::vector<uint8_t> frame =
+        encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_bool_datapoint(1, true));
+    const uint64_t airtime = frame.size() * this->bench_.uart().byte_time_us();
+    if (this->first_at_us_ == 0) {
+      this->first_at_us_ = this->bench_.clock().now_us() + airtime;
+    } else {
+      const uint64_t send_at = this->first_at_us_ + at_ms * 1000 - airtime;
+      ASSERT_TRUE(this->bench_.run_until([&] { return this->bench_.clock().now_us() >= send_at; }, 5000));
+    }
+    this->bench_.uart().inject(frame);
+    this->bench_.run_for(50);
+  }
+
+  bool run_until_acked() {
+    return this->bench_.run_until([this] { return this->bench_.mcu().get_unacked_count() == 0; }, 2000);
+  }
+
+  TuyaDoorLockHarness bench_;
+  std::vector<bool> dispatched_;
+  uint64_t first_at_us_{0};
+};
+
+TEST_F(RetransmitTest, LostAckIsAckedAgainButDispatchedOnce) {
+  this->bench_.mcu().drop_next(TuyaDoorLockCommandType::DATAPOINT_REPORT);
+  this->bench_.mcu().report(encode_bool_datapoint(1, true));
+  ASSERT_TRUE(this->run_until_acked());
+  EXPECT_EQ(this->bench_.mcu().get_resent_count(), 1u);
+  EXPECT_EQ(this->bench_.mcu().get_dropped_count(), 1u);
+  EXPECT_EQ(this->dispatched_, std::vector<bool>{true});
+  EXPECT_EQ(this->bench_.lock().get_retransmit_count(), 1u);
+}
+
+TEST_F(RetransmitTest, EveryResendIsAckedWhileAcksKeepGettingLost) {
+  this->bench_.mcu().drop_next(TuyaDoorLockCommandType::DATAPOINT_REPORT, 2);
+  this->bench_.mcu().report(encode_bool_datapoint(1, true));
+  ASSERT_TRUE(this->run_until_acked());
+  EXPECT_EQ(this->bench_.mcu().get_resent_count(), 2u);
+  EXPECT_EQ(this->dispatched_, std::vector<bool>{true});
+  EXPECT_EQ(this->bench_.lock().get_retransmit_count(), 2u);
+}
+
+TEST_F(RetransmitTest, SameReportAfterWindowIsDispatched) {
+  this->bench_.lock().set_retransmit_window(1000);
+  this->bench_.mcu().report(encode_bool_datapoint(1, true));
+  ASSERT_TRUE(this->run_until_acked());
+  this->bench_.run_for(1500);
+  this->bench_.mcu().report(encode_bool_datapoint(1, true));
+  ASSERT_TRUE(this->run_until_acked());
+  EXPECT_EQ(this->dispatched_, (std::vector<bool>{true, true}));
+  EXPECT_EQ(this->bench_.lock().get_retransmit_count(), 0u);
+}
+
+TEST_F(RetransmitTest, SameReportJustInsideWindowIsDroppedJustOutsideDispatched) {
+  this->inject_report_at(0);
+  this->inject_report_at(990);
+  EXPECT_EQ(this->dispatched_, std::vector<bool>{true});
+  // The window counts from the first copy, the repeat at 990ms does not extend it
+  this->inject_report_at(1010);
+  EXPECT_EQ(this->dispatched_, (std::vector<bool>{true, true}));
+  EXPECT_EQ(this->bench_.lock().get_retransmit_count(), 1u);
+}
+
+TEST(RetransmitDefaultTest, IdenticalReportsAreAllDispatched) {
+  TuyaDoorLockHarness bench;
+  size_t dispatched = 0;
+  bench.lock().register_listener(1, [&](const TuyaDoorLockDatapoint &) { dispatched++; });
+  ASSERT_TRUE(bench.start());
+  for (int i = 0; i < 3; i++) {
+    bench.mcu().report(encode_bool_datapoint(1, true));
+    bench.run_for(100);
+  }
+  EXPECT_EQ(dispatched, 3u);
+  EXPECT_EQ(bench.lock().get_retransmit_count(), 0u);
+}
+
+TEST(RetransmitClockTest, ReportAtTimeZeroIsRemembered) {
+  // millis() wraps to 0 when the first report is read, which used to mark its slot empty
+  const uint64_t wrap = (uint64_t(1) << 32) * 1000;
+  TuyaDoorLockVirtualClock clock(wrap - 200000);
+  TuyaDoorLockHarness bench(&clock);
+  size_t dispatched = 0;
+  bench.lock().register_listener(1, [&](const TuyaDoorLockDatapoint &) { dispatched++; });
+  bench.lock().set_retransmit_window(2000);
+  ASSERT_TRUE(bench.start());
+  const std::vector<uint8_t> frame = encode_mcu_frame(0x05, encode_bool_datapoint(1, true));
+  // Loop iterations run on whole milliseconds, the first one after the frame arrived is at the wrap
+  const uint64_t airtime = (frame.size() * bench.uart().byte_time_us() + 999) / 1000 * 1000;
+  ASSERT_TRUE(bench.run_until([&] { return clock.now_us() == wrap - airtime; }, 1000));
+  bench.uart().inject(frame);
+  bench.run_for(100);
+  ASSERT_EQ(dispatched, 1u);
+  ASSERT_TRUE(bench.lock().recent_frames_[0].valid);
+  ASSERT_EQ(bench.lock().recent_frames_[0].received_at, 0u);
+  bench.uart().inject(frame);
+  bench.run_for(100);
+  EXPECT_EQ(dispatched, 1u);
+  EXPECT_EQ(bench.lock().get_retransmit_count(), 1u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
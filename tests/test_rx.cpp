@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class RxTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->bench_.lock().register_listener(1, [this](const TuyaDoorLockDatapoint &dp) {
+      this->values_.push_back(dp.value_bool);
+    });
+    ASSERT_TRUE(this->bench_.start());
+    this->report_ =
+        encode_mcu_frame((uint8_t) TuyaDoorLockCommandType::DATAPOINT_REPORT, encode_bool_datapoint(1, true));
+  }
+
+  TuyaDoorLockHarness bench_;
+  std::vector<bool> values_;
+  std::vector<uint8_t> report_;
+};
+
+TEST_F(RxTest, FrameSplitAcrossReads) {
+  const std::vector<uint8_t> &bytes = this->report_;
+  this->bench_.uart().inject(std::vector<uint8_t>(bytes.begin(), bytes.begin() + 3));
+  this->bench_.run_for(50);
+  this->bench_.uart().inject(std::vector<uint8_t>(bytes.begin() + 3, bytes.begin() + 8));
+  this->bench_.run_for(50);
+  EXPECT_TRUE(this->values_.empty());
+  this->bench_.uart().inject(std::vector<uint8_t>(bytes.begin() + 8, bytes.end()));
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->values_, std::vector<bool>{true});
+}
+
+TEST_F(RxTest, PartialFrameTimesOut) {
+  const std::vector<uint8_t> &bytes = this->report_;
+  this->bench_.uart().inject(std::vector<uint8_t>(bytes.begin(), bytes.begin() + 6));
+  this->bench_.run_for(500);
+  EXPECT_TRUE(this->bench_.lock().is_rx_idle_());
+  this->bench_.uart().inject(bytes);
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->values_, std::vector<bool>{true});
+}
+
+TEST_F(RxTest, ResyncsAfterGarbage) {
+  this->bench_.mcu().send_raw({0x00, 0xAA, 0x55, 0x13, 0x55});
+  this->bench_.mcu().send_raw(this->report_);
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->values_, std::vector<bool>{true});
+}
+
+TEST_F(RxTest, BadChecksumIsNotAcked) {
+  std::vector<uint8_t> corrupt = this->report_;
+  corrupt.back() ^= 0xFF;
+  const size_t acks = this->bench_.mcu().count_received(TuyaDoorLockCommandType::DATAPOINT_REPORT);
+  this->bench_.mcu().send_raw(corrupt);
+  this->bench_.run_for(50);
+  EXPECT_TRUE(this->values_.empty());
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::DATAPOINT_REPORT), acks);
+
+  this->bench_.mcu().send_raw(this->report_);
+  this->bench_.run_for(50);
+  EXPECT_EQ(this->values_, std::vector<bool>{true});
+  EXPECT_EQ(this->bench_.mcu().count_received(TuyaDoorLockCommandType::DATAPOINT_REPORT), acks + 1);
+}
+
+TEST_F(RxTest, MultiDatapointFrameCommitsOnceAfterAllDatapoints) {
+  std::vector<std::string> events;
+  this->bench_.lock().register_listener(2, [&](const TuyaDoorLockDatapoint &) { events.push_back("dp2"); });
+  this->bench_.lock().register_listener(3, [&](const TuyaDoorLockDatapoint &) { events.push_back("dp3"); });
+  this->bench_.lock().add_on_frame_commit_callback([&] {
+    // What entities read back at commit time must already be the frame's values
+    TuyaDoorLockDatapoint dp3;
+    ASSERT_TRUE(this->bench_.lock().get_datapoint(3, dp3));
+    events.push_back("commit dp3=" + std::to_string(dp3.value_uint));
+  });
+
+  std::vector<uint8_t> records = encode_bool_datapoint(1, true);
+  for (const std::vector<uint8_t> &record : {encode_int_datapoint(2, 7), encode_int_datapoint(3, 42)})
+    records.insert(records.end(), record.begin(), record.end());
+  this->bench_.mcu().report(records);
+  this->bench_.run_for(100);
+  EXPECT_EQ(events, (std::vector<std::string>{"dp2", "dp3", "commit dp3=42"}));
+  EXPECT_EQ(this->values_, std::vector<bool>{true});
+
+  // A frame without datapoints does not commit
+  this->bench_.mcu().send(TuyaDoorLockCommandType::WIFI_STATE, {});
+  this->bench_.run_for(100);
+  EXPECT_EQ(events.size(), 3u);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+class WakeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->bench_.lock().set_en_binary_sensor(&this->en_);
+    this->en_.publish_state(false);
+    ASSERT_TRUE(this->bench_.start());
+    this->reports_before_ = this->bench_.mcu().count_received(TuyaDoorLockCommandType::WIFI_STATE);
+  }
+
+  size_t cloud_reports() {
+    return this->bench_.mcu().count_received(TuyaDoorLockCommandType::WIFI_STATE) - this->reports_before_;
+  }
+
+  TuyaDoorLockHarness bench_;
+  binary_sensor::BinarySensor en_;
+  size_t reports_before_{0};
+};
+
+TEST_F(WakeTest, ReportsCloudConnectionOnEveryWake) {
+  this->en_.publish_state(true);
+  this->bench_.run_for(1200);
+  EXPECT_EQ(this->cloud_reports(), 0u);
+  this->bench_.run_for(1900);
+  EXPECT_EQ(this->cloud_reports(), 2u);
+
+  this->en_.publish_state(false);
+  this->bench_.run_for(1000);
+  this->en_.publish_state(true);
+  this->bench_.run_for(3100);
+  EXPECT_EQ(this->cloud_reports(), 4u);
+}
+
+TEST_F(WakeTest, WakeInsideReportWindowStartsOver) {
+  this->en_.publish_state(true);
+  this->bench_.run_for(500);
+  this->en_.publish_state(false);
+  this->bench_.run_for(100);
+  this->en_.publish_state(true);
+  // 1.25s after the first rising edge, but not yet after the second
+  this->bench_.run_for(1000);
+  EXPECT_EQ(this->cloud_reports(), 0u);
+  this->bench_.run_for(300);
+  EXPECT_EQ(this->cloud_reports(), 1u);
+  this->bench_.run_for(2000);
+  EXPECT_EQ(this->cloud_reports(), 2u);
+}
+
+TEST(WakeAtInitTest, ReportsWhenEnIsHighOnceInitialized) {
+  TuyaDoorLockHarness bench;
+  binary_sensor::BinarySensor en;
+  bench.lock().set_en_binary_sensor(&en);
+  en.publish_state(true);
+  ASSERT_TRUE(bench.start());
+  const size_t before = bench.mcu().count_received(TuyaDoorLockCommandType::WIFI_STATE);
+  bench.run_for(3100);
+  EXPECT_EQ(bench.mcu().count_received(TuyaDoorLockCommandType::WIFI_STATE) - before, 2u);
+}
+
+static const uint8_t QUERY_A = 0x30;
+static const uint8_t QUERY_B = 0x31;
+
+class SequenceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(this->bench_.start());
+    this->bench_.run_for(50);
+  }
+
+  // Sends command and records what its sequence resumed with: the reply's first payload byte, or -1 for no reply
+  void send_and_await(uint8_t command, uint32_t timeout) {
+    this->bench_.lock().send_and_await(
+        TuyaDoorLockCommand{.cmd = (TuyaDoorLockCommandType) command, .payload = {}},
+        [this, command](const TuyaDoorLockFrame *frame) {
+          this->resumed_.emplace_back(command, frame == nullptr ? -1 : frame->data[0]);
+        },
+        timeout);
+  }
+
+  // The MCU answers command with payload {value}, delay_ms after receiving it
+  void answer(uint8_t command, uint8_t value, uint32_t delay_ms) {
+    this->bench_.mcu().on_command(command, [command, value, delay_ms](TuyaDoorLockMcuEmulator &mcu,
+                                                                     const TuyaDoorLockEmulatedFrame &) {
+      mcu.send(command, {value}, delay_ms);
+    });
+  }
+
+  TuyaDoorLockHarness bench_;
+  std::vector<std::pair<uint8_t, int>> resumed_;
+};
+
+TEST_F(SequenceTest, ResumesOnResponse) {
+  this->answer(QUERY_A, 7, 200);
+  this->send_and_await(QUERY_A, 1000);
+  this->bench_.run_for(150);
+  EXPECT_TRUE(this->resumed_.empty());
+  this->bench_.run_for(200);
+  EXPECT_EQ(this->resumed_, (std::vector<std::pair<uint8_t, int>>{{QUERY_A, 7}}));
+  // Done, a late second answer does not resume it again
+  this->bench_.mcu().send(QUERY_A, {8});
+  this->bench_.run_for(100);
+  EXPECT_EQ(this->resumed_.size(), 1u);
+}
+
+TEST_F(SequenceTest, ResumesOnTimeoutCountedFromTheCall) {
+  this->bench_.mcu().on_command(QUERY_A, nullptr);
+  this->send_and_await(QUERY_A, 300);
+  // A slow component holds the main loop before the sequence gets to start
+  this->bench_.clock().advance_us(200000);
+  this->bench_.run_for(90);
+  EXPECT_TRUE(this->resumed_.empty());
+  this->bench_.run_for(20);
+  EXPECT_EQ(this->resumed_, (std::vector<std::pair<uint8_t, int>>{{QUERY_A, -1}}));
+}
+
+TEST_F(SequenceTest, ConcurrentSequencesResumeOnTheirOwnResponses) {
+  this->answer(QUERY_A, 1, 400);
+  this->answer(QUERY_B, 2, 50);
+  this->send_and_await(QUERY_A, 1000);
+  this->send_and_await(QUERY_B, 1000);
+  this->bench_.run_for(300);
+  EXPECT_EQ(this->resumed_, (std::vector<std::pair<uint8_t, int>>{{QUERY_B, 2}}));
+  this->bench_.run_for(300);
+  EXPECT_EQ(this->resumed_, (std::vector<std::pair<uint8_t, int>>{{QUERY_B, 2}, {QUERY_A, 1}}));
+}
+
+TEST_F(SequenceTest, ConcurrentSequencesTimeOutIndependently) {
+  this->bench_.mcu().on_command(QUERY_A, nullptr);
+  this->answer(QUERY_B, 2, 300);
+  this->send_and_await(QUERY_A, 200);
+  this->send_and_await(QUERY_B, 1000);
+  this->bench_.run_for(250);
+  EXPECT_EQ(this->resumed_, (std::vector<std::pair<uint8_t, int>>{{QUERY_A, -1}}));
+  this->bench_.run_for(200);
+  EXPECT_EQ(this->resumed_, (std::vector<std::pair<uint8_t, int>>{{QUERY_A, -1}, {QUERY_B, 2}}));
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "harness.h"
+
+namespace esphome {
+namespace tuya_door_lock {
+namespace testing {
+
+static const uint8_t CUSTOM_COMMAND = 0x30;
+static const uint8_t BULK_COMMAND = 0x31;
+static const uint8_t OTHER_COMMAND = 0x32;
+static const size_t SCHEDULED_LOCKS = 3;
+static const size_t BULK_FRAMES = 12;
+// Two bulk frames fit in the scheduler's budget of a loop iteration, three do not
+static const size_t BULK_PAYLOAD = 50;
+static const size_t TX_BUDGET = TuyaDoorLockFakeUART::HARDWARE_FIFO_SIZE;
+
+class TxTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    this->bench_.lock().register_command_handler(CUSTOM_COMMAND, nullptr, true);
+    this->bench_.lock().register_command_handler(OTHER_COMMAND, nullptr, true);
+    ASSERT_TRUE(this->bench_.start());
+    this->bench_.run_for(50);
+  }
+
+  // Queues a command expecting a response, with payload_len bytes of payload
+  void send_custom(size_t payload_len) {
+    this->bench_.lock().send_and_await(
+        TuyaDoorLockCommand{.cmd = (TuyaDoorLockCommandType) CUSTOM_COMMAND,
+                            .payload = std::vector<uint8_t>(payload_len, 0x11)},
+        [this](const TuyaDoorLockFrame *frame) { this->answered_ = frame != nullptr; }, 2000);
+  }
+
+  // Queues an empty command expecting a response, answered is set when the response arrives
+  void send_empty(uint8_t command, bool *answered) {
+    this->bench_.lock().send_and_await(
+        TuyaDoorLockCommand{.cmd = (TuyaDoorLockCommandType) command, .payload = {}},
+        [answered](const TuyaDoorLockFrame *frame) { *answered = frame != nullptr; }, 10000);
+  }
+
+  TuyaDoorLockPendingResponse *pending(uint8_t command) {
+    for (auto &pending : this->bench_.lock().pending_responses_) {
+      if (pending.command.cmd == (TuyaDoorLockCommandType) command)
+        return &pending;
+    }
+    return nullptr;
+  }
+
+  bool is_awaiting(uint8_t command) {
+    TuyaDoorLockPendingResponse *pending = this->pending(command);
+    return pending != nullptr && pending->state == TuyaDoorLockPendingState::AWAITING;
+  }
+
+  TuyaDoorLockHarness bench_;
+  bool answered_{false};
+};
+
+TEST_F(TxTest, ReplyRightAfterDrainIsNoCollision) {
+  this->bench_.set_loop_interval_us(16000);
+  this->send_custom(4);
+  ASSERT_TRUE(this->bench_.run_until([this] { return this->bench_.uart().tx_in_flight() > 0; }, 100));
+  // The MCU answers as soon as our frame drained, and all of it arrives before the next loop iteration
+  this->bench_.clock().advance_to_us(this->bench_.uart().get_tx_line_free_at());
+  this->bench_.uart().inject(encode_mcu_frame(CUSTOM_COMMAND, {}));
+  this->bench_.clock().advance_to_us(this->bench_.uart().get_rx_line_free_at());
+  this->bench_.step();
+  EXPECT_TRUE(this->answered_);
+  EXPECT_EQ(this->bench_.lock().get_collision_count(), 0u);
+}
+
+TEST_F(TxTest, FrameDuringOursIsCollision) {
+  this->send_custom(100);
+  ASSERT_TRUE(this->bench_.run_until([this] { return this->bench_.uart().tx_in_flight() > 0; }, 100));
+  this->bench_.run_for(20);
+  this->bench_.mcu().send_raw(encode_mcu_frame(0x05, encode_bool_datapoint(1, true)));
+  this->bench_.run_for(200);
+  EXPECT_EQ(this->bench_.lock().get_collision_count(), 1u);
+}
+
+TEST_F(TxTest, ResponseTimeoutStartsWhenFrameDrained) {
+  this->bench_.set_loop_interval_us(16000);
+  this->send_custom(4);
+  auto &pending = this->bench_.lock().pending_responses_;
+  ASSERT_TRUE(this->bench_.run_until(
+      [&] { return !pending.empty() && pending[0].state == TuyaDoorLockPendingState::AWAITING; }, 200));
+  // Noticed up to a loop interval later, stamped with when the last byte left the wire
+  EXPECT_NEAR(pending[0].since, this->bench_.uart().get_tx_line_free_at() / 1000, 1);
+  EXPECT_EQ(this->bench_.lock().last_command_timestamp_, pending[0].since);
+}
+
+TEST_F(TxTest, ReplyWhileTransmittingRecordsRtt) {
+  this->send_custom(100);
+  ASSERT_TRUE(this->bench_.run_until([this] { return this->bench_.uart().tx_in_flight() > 0; }, 100));
+  this->bench_.mcu().send_raw(encode_mcu_frame(CUSTOM_COMMAND, {}));
+  ASSERT_TRUE(this->bench_.run_until([this] { return this->answered_; }, 500));
+  const TuyaDoorLockRttStats *stats = nullptr;
+  for (auto &other : this->bench_.lock().rtt_stats_) {
+    if (other.cmd == (TuyaDoorLockCommandType) CUSTOM_COMMAND)
+      stats = &other;
+  }
+  ASSERT_NE(stats, nullptr);
+  EXPECT_EQ(stats->count, 1);
+  EXPECT_EQ(stats->samples[0], 0);
+}
+
+TEST_F(TxTest, TwoCommandsInFlightAreAnsweredIndependently) {
+  bool custom = false, other = false;
+  this->send_empty(CUSTOM_COMMAND, &custom);
+  this->send_empty(OTHER_COMMAND, &other);
+  ASSERT_TRUE(this->bench_.run_until(
+      [&] { return this->is_awaiting(CUSTOM_COMMAND) && this->is_awaiting(OTHER_COMMAND); }, 100));
+  // Answered in the opposite order
+  this->bench_.mcu().send(OTHER_COMMAND, {});
+  ASSERT_TRUE(this->bench_.run_until([&] { return other; }, 100));
+  EXPECT_FALSE(custom);
+  EXPECT_EQ(this->pending(OTHER_COMMAND), nullptr);
+  EXPECT_TRUE(this->is_awaiting(CUSTOM_COMMAND));
+  this->bench_.mcu().send(CUSTOM_COMMAND, {});
+  ASSERT_TRUE(this->bench_.run_until([&] { return custom; }, 100));
+  EXPECT_TRUE(this->bench_.lock().pending_responses_.empty());
+}
+
+TEST_F(TxTest, LateResponseClearsItsOwnEntry) {
+  bool custom = false, other = false;
+  this->send_empty(CUSTOM_COMMAND, &custom);
+  // The first attempt times out, the command is waiting for its retry or being retried
+  ASSERT_TRUE(this->bench_.run_until(
+      [&] { return this->pending(CUSTOM_COMMAND) != nullptr && this->pending(CUSTOM_COMMAND)->retries == 1; }, 1000));
+  this->send_empty(OTHER_COMMAND, &other);
+  ASSERT_TRUE(this->bench_.run_until([&] { return this->is_awaiting(OTHER_COMMAND); }, 1000));
+  ASSERT_NE(this->pending(CUSTOM_COMMAND), nullptr);
+  this->bench_.mcu().send(CUSTOM_COMMAND, {});
+  ASSERT_TRUE(this->bench_.run_until([&] { return custom; }, 100));
+  EXPECT_EQ(this->pending(CUSTOM_COMMAND), nullptr);
+  EXPECT_TRUE(this->is_awaiting(OTHER_COMMAND));
+  EXPECT_FALSE(other);
+}
+
+TEST_F(TxTest, ResponseToCommandNotPendingIsIgnored) {
+  bool other = false;
+  this->send_empty(OTHER_COMMAND, &other);
+  ASSERT_TRUE(this->bench_.run_until([&] { return this->is_awaiting(OTHER_COMMAND); }, 100));
+  const TuyaDoorLockPendingResponse before = *this->pending(OTHER_COMMAND);
+  this->bench_.mcu().send(CUSTOM_COMMAND, {});
+  this->bench_.run_for(20);
+  EXPECT_FALSE(other);
+  ASSERT_EQ(this->bench_.lock().pending_responses_.size(), 1u);
+  EXPECT_TRUE(this->is_awaiting(OTHER_COMMAND));
+  EXPECT_EQ(this->pending(OTHER_COMMAND)->since, before.since);
+  EXPECT_EQ(this->pending(OTHER_COMMAND)->retries, 0);
+  for (auto &stats : this->bench_.lock().rtt_stats_)
+    EXPECT_NE(stats.cmd, (TuyaDoorLockCommandType) CUSTOM_COMMAND);
+}
+
+// Three locks on one main loop and one clock, each with more to send than its share of the per iteration budget
+class TxSchedulerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (size_t i = 0; i < SCHEDULED_LOCKS; i++) {
+      // Fast enough for every frame to drain within a loop interval, so each lock is ready to send every iteration
+      this->benches_.emplace_back(new TuyaDoorLockHarness(&this->clock_, 115200));
+      TuyaDoorLockHarness &bench = *this->benches_.back();
+      bench.set_loop_interval_us(16000);
+      ASSERT_TRUE(bench.start());
+    }
+    for (size_t i = 0; i < 20; i++)
+      this->step();
+    for (auto &bench : this->benches_)
+      ASSERT_TRUE(bench->lock().command_queue_.empty());
+  }
+
+  void queue_bulk() {
+    for (auto &bench : this->benches_) {
+      for (size_t i = 0; i < BULK_FRAMES; i++) {
+        bench->lock().command_queue_.push_back(TuyaDoorLockCommand{
+            .cmd = (TuyaDoorLockCommandType) BULK_COMMAND, .payload = std::vector<uint8_t>(BULK_PAYLOAD, 0x22)});
+      }
+    }
+  }
+
+  // One main loop iteration, in App.loop() order: the MCUs, the scheduler, then every lock. Records which locks sent
+  // a frame, in the order they did, and returns the bytes written by all of them
+  size_t step() {
+    for (auto &bench : this->benches_)
+      bench->poll_mcu();
+    TuyaDoorLockTxScheduler::get_instance()->loop();
+    size_t written = 0;
+    for (size_t i = 0; i < this->benches_.size(); i++) {
+      TuyaDoorLockHarness &bench = *this->benches_[i];
+      const size_t queued = bench.lock().command_queue_.size();
+      const size_t before = bench.uart().get_written_bytes();
+      bench.lock().loop();
+      if (bench.lock().command_queue_.size() < queued)
+        this->sent_by_.push_back(i);
+      written += bench.uart().get_written_bytes() - before;
+    }
+    this->clock_.advance_us(16000);
+    return written;
+  }
+
+  bool all_sent() {
+    for (auto &bench : this->benches_) {
+      if (!bench->lock().command_queue_.empty())
+        return false;
+    }
+    return true;
+  }
+
+  TuyaDoorLockVirtualClock clock_;
+  std::vector<std::unique_ptr<TuyaDoorLockHarness>> benches_;
+  std::vector<size_t> sent_by_;
+};
+
+TEST_F(TxSchedulerTest, LocksTakeTurnsWithinTheBudget) {
+  const uint32_t deferred = TuyaDoorLockTxScheduler::get_instance()->get_deferred_count();
+  this->queue_bulk();
+  this->sent_by_.clear();
+  size_t iterations = 0;
+  while (!this->all_sent()) {
+    ASSERT_LT(iterations++, 2 * SCHEDULED_LOCKS * BULK_FRAMES);
+    EXPECT_LE(this->step(), TX_BUDGET) << "iteration " << iterations;
+  }
+  // A lock that was denied goes first in the next iteration, so frames go out round robin
+  ASSERT_EQ(this->sent_by_.size(), SCHEDULED_LOCKS * BULK_FRAMES);
+  for (size_t i = 0; i < this->sent_by_.size(); i++)
+    EXPECT_EQ(this->sent_by_[i], i % SCHEDULED_LOCKS) << "frame " << i;
+  EXPECT_GT(TuyaDoorLockTxScheduler::get_instance()->get_deferred_count(), deferred);
+}
+
+}  // namespace testing
+}  // namespace tuya_door_lock
+}  // namespace esphome